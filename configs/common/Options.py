@@ -560,6 +560,31 @@ def addCommonOptions(parser):
         action="store_true",
         help="take a checkpoint at end of run",
     )
+    parser.add_argument(
+        "--mem-checkpoint",
+        default="gzip",
+        choices=["gzip", "chunked"],
+        help="format of the memory in the checkpoints, chunked compresses "
+        "on all host cores and leaves out the zero pages",
+    )
+    parser.add_argument(
+        "--mem-checkpoint-level",
+        type=int,
+        default=1,
+        help="zlib level of the chunked format, 0 to keep the chunks "
+        "uncompressed so that they can be restored with mmap",
+    )
+    parser.add_argument(
+        "--mem-checkpoint-mmap-restore",
+        action="store_true",
+        help="restore the uncompressed chunks by mapping the files",
+    )
+    parser.add_argument(
+        "--mem-checkpoint-incremental",
+        action="store_true",
+        help="only write the memory changed since the checkpoint last "
+        "taken or restored (implies --mem-checkpoint=chunked)",
+    )
     parser.add_argument(
         "--work-begin-checkpoint-count",
         action="store",
@@ -677,6 +702,43 @@ def addCommonOptions(parser):
         default=None,
         help="Override vendor string returned by CPUID instruction in X86.",
     )
+    parser.add_argument(
+        "--event-queue",
+        default="list",
+        choices=["list", "calendar"],
+        help="How the event queues keep their events, the calendar queue "
+        "is faster with many pending events (same results)",
+    )
+    parser.add_argument(
+        "--pdes",
+        action="store_true",
+        help="Simulate each cpu on its own thread, the caches, crossbars "
+        "and devices on one more (needs a timing cpu)",
+    )
+    parser.add_argument(
+        "--pdes-cut",
+        default="cpu",
+        choices=["cpu", "l2"],
+        help="With --pdes, where the threads of the cpus stop: before their "
+        "L1 caches, the same run every time, or before the L2 crossbar, "
+        "with a lookahead many cycles long (needs --l2cache)",
+    )
+    parser.add_argument(
+        "--pdes-lookahead",
+        type=int,
+        default=0,
+        action="store",
+        help="Latency in ticks of the bridges of the cpu threads with "
+        "--pdes, taken out of the cache latencies, 0 for one cpu cycle "
+        "(half the L2 tag latency with --pdes-cut=l2). The threads "
+        "synchronize every lookahead - 1 ticks",
+    )
+    parser.add_argument(
+        "--pdes-check",
+        action="store_true",
+        help="With --pdes, print a digest of the accesses of each cpu at "
+        "exit, the same in every run of the same configuration",
+    )
 
 
 def addSEOptions(parser):
@@ -896,6 +958,13 @@ def addFSOptions(parser):
         help="Enable page walk cache (translation cache / "
                 "page structure cache). Only works for X86 FS"
         )
+    parser.add_argument(
+        "--pwc-pml5-size",
+        type=int,
+        default=2,
+        action="store",
+        help="Size of PML5 cache in entries (only used with LA57)"
+    )
     parser.add_argument(
         "--pwc-pml4-size",
         type=int,
@@ -917,3 +986,231 @@ def addFSOptions(parser):
         action="store",
         help="Size of PDE cache in entries"
     )
+    parser.add_argument(
+        "--pwc-pml5-assoc",
+        type=int,
+        default=0,
+        action="store",
+        help="Associativity of PML5 cache (0 means fully associative)"
+    )
+    parser.add_argument(
+        "--pwc-pml4-assoc",
+        type=int,
+        default=0,
+        action="store",
+        help="Associativity of PML4 cache (0 means fully associative)"
+    )
+    parser.add_argument(
+        "--pwc-pdp-assoc",
+        type=int,
+        default=0,
+        action="store",
+        help="Associativity of PDP cache (0 means fully associative)"
+    )
+    parser.add_argument(
+        "--pwc-pde-assoc",
+        type=int,
+        default=0,
+        action="store",
+        help="Associativity of PDE cache (0 means fully associative)"
+    )
+    parser.add_argument(
+        "--pwc-replacement-policy",
+        default=None,
+        choices=ObjectList.rp_list.get_names(),
+        help="Replacement policy of the pwc (exact LRU if not set)"
+    )
+    parser.add_argument(
+        "--pwc-parallel-probe",
+        default=False,
+        action="store_true",
+        help="Probe all pwc levels in one step and use the deepest hit"
+    )
+    parser.add_argument(
+        "--pwc-lookup-latency",
+        type=int,
+        default=0,
+        action="store",
+        help="Latency of a pwc lookup in cycles (per level probed, or "
+        "once if parallel)"
+    )
+    parser.add_argument(
+        "--pwc-organization",
+        default="split",
+        choices=["split", "unified"],
+        help="Split per-level pwc, or a unified one where all levels "
+        "share capacity"
+    )
+    parser.add_argument(
+        "--pwc-unified-size",
+        type=int,
+        default=56,
+        action="store",
+        help="Size of the unified pwc in entries"
+    )
+    parser.add_argument(
+        "--pwc-unified-assoc",
+        type=int,
+        default=0,
+        action="store",
+        help="Associativity of the unified pwc (0 means fully associative)"
+    )
+    parser.add_argument(
+        "--pwc-huge-page-fill",
+        default="normal",
+        choices=["normal", "bypass", "prioritise"],
+        help="Whether walks ending at a 2M/1G page fill the pwc as 4K "
+        "walks do, not at all (bypass), or ahead of 4K walks (prioritise)"
+    )
+    parser.add_argument(
+        "--pwc-lookup-ports",
+        type=int,
+        default=0,
+        action="store",
+        help="Pwc probes per cycle, further walks wait for a free port "
+        "(0 means unlimited)"
+    )
+    parser.add_argument(
+        "--pwc-fill-ports",
+        type=int,
+        default=0,
+        action="store",
+        help="Pwc fills per cycle, further fills are visible once they "
+        "get a port (0 means unlimited)"
+    )
+    parser.add_argument(
+        "--pwc-shared-size",
+        type=int,
+        default=0,
+        action="store",
+        help="Size in entries of a second level pwc shared by all cpus "
+        "(0 means no shared pwc)"
+    )
+    parser.add_argument(
+        "--pwc-shared-assoc",
+        type=int,
+        default=8,
+        action="store",
+        help="Associativity of the shared pwc (0 means fully associative)"
+    )
+    parser.add_argument(
+        "--pwc-shared-latency",
+        type=int,
+        default=8,
+        action="store",
+        help="Latency of a shared pwc access in cycles"
+    )
+    parser.add_argument(
+        "--pwc-shared-ports",
+        type=int,
+        default=0,
+        action="store",
+        help="Shared pwc lookups per cycle (0 means unlimited)"
+    )
+    parser.add_argument(
+        "--pwc-shared-inclusion",
+        default="non_inclusive",
+        choices=["non_inclusive", "inclusive", "exclusive"],
+        help="Inclusion policy of the shared pwc"
+    )
+    parser.add_argument(
+        "--nested-paging",
+        action="store_true",
+        help="Model nested (2D) walks through a host page table"
+    )
+    parser.add_argument(
+        "--nested-tlb-size",
+        type=int,
+        default=32,
+        action="store",
+        help="Size of the nested TLB of nested walks (0 means none)"
+    )
+    parser.add_argument(
+        "--host-pwc-pml4-size",
+        type=int,
+        default=2,
+        action="store",
+        help="Size of the host PML4 cache of nested walks"
+    )
+    parser.add_argument(
+        "--host-pwc-pdp-size",
+        type=int,
+        default=4,
+        action="store",
+        help="Size of the host PDP cache of nested walks"
+    )
+    parser.add_argument(
+        "--host-pwc-pde-size",
+        type=int,
+        default=16,
+        action="store",
+        help="Size of the host PDE cache of nested walks"
+    )
+    parser.add_argument(
+        "--restore-pwc-state",
+        action="store_true",
+        help="Restore the pwc entries from the checkpoint given with "
+        "--checkpoint-restore, instead of starting with empty pwcs"
+    )
+    parser.add_argument(
+        "--walker-line-fill-tlb",
+        action="store_true",
+        help="Also install the other PTEs of the line read by a walk into "
+        "the TLB"
+    )
+    parser.add_argument(
+        "--walker-line-fill-pwc",
+        action="store_true",
+        help="Also install the other PDEs of the line read by a walk into "
+        "the PDE cache"
+    )
+    parser.add_argument(
+        "--walker-prefetch-degree",
+        type=int,
+        default=0,
+        action="store",
+        help="Number of strides the translation prefetcher walks ahead "
+        "(0 disables it)"
+    )
+    parser.add_argument(
+        "--walker-num-walkers",
+        type=int,
+        default=1,
+        action="store",
+        help="Number of page walks that can be in progress at the same time"
+    )
+    parser.add_argument(
+        "--walk-profile",
+        action="store_true",
+        help="Profile the reuse distance of the pwc entries and TLB pages, "
+        "to get their hit rate for every size in one run"
+    )
+    parser.add_argument(
+        "--walk-profile-max-distance",
+        type=int,
+        default=1024,
+        action="store",
+        help="Largest pwc or TLB size the walk profile gives the hit rate of"
+    )
+    parser.add_argument(
+        "--stlb-size",
+        type=int,
+        default=0,
+        action="store",
+        help="Size of a second level TLB behind the itb and dtb of each "
+        "cpu (0 means no STLB)"
+    )
+    parser.add_argument(
+        "--stlb-assoc",
+        type=int,
+        default=12,
+        action="store",
+        help="Associativity of the STLB (0 means fully associative)"
+    )
+    parser.add_argument(
+        "--stlb-latency",
+        type=int,
+        default=8,
+        action="store",
+        help="Latency of an STLB lookup in cycles"
+    )
@@ -90,6 +90,240 @@ def setCPUClass(options):
     return (TmpClass, test_mem_mode, CPUClass)
 
 
+def pwcArgs(options):
+    """Shiming: Returns the pwc cpu params given on the command line"""
+    kwargs = {
+        name: getattr(options, name)
+        for name in BaseCPU.pwcParams()
+        if name != "pwc_replacement_policy"
+    }
+    if options.pwc_replacement_policy:
+        kwargs["pwc_replacement_policy"] = ObjectList.rp_list.get(
+            options.pwc_replacement_policy
+        )()
+    return kwargs
+
+
+def addSharedPwc(system, options):
+    """Shiming: Adds the pwc shared by all cpus to system, if asked for,
+    and sets up the translation of the cpus"""
+    if not options.enable_pwc or not options.pwc_shared_size:
+        setupMmus(system, system.cpu, options)
+        return
+    kwargs = {}
+    if options.pwc_replacement_policy:
+        kwargs["replacement_policy"] = ObjectList.rp_list.get(
+            options.pwc_replacement_policy
+        )()
+    system.shared_pwc = X86SharedPwc(
+        size=options.pwc_shared_size,
+        assoc=options.pwc_shared_assoc,
+        latency=options.pwc_shared_latency,
+        lookup_ports=options.pwc_shared_ports,
+        inclusion=options.pwc_shared_inclusion,
+        restore_state=options.restore_pwc_state,
+        **kwargs
+    )
+    setupMmus(system, system.cpu, options)
+
+
+def setupMmus(system, cpus, options):
+    """Shiming: Puts the shared pwc of system (if any) behind the cpus, gives
+    them an STLB if asked for, and sets up their walkers"""
+    if not buildEnv["USE_X86_ISA"]:
+        return
+    for cpu in cpus:
+        if hasattr(system, "shared_pwc"):
+            cpu.mmu.pwc_shared = system.shared_pwc
+        cpu.mmu.restore_pwc_state = options.restore_pwc_state
+        if options.nested_paging:
+            cpu.mmu.nested_paging = True
+            cpu.mmu.nested_tlb_size = options.nested_tlb_size
+            cpu.mmu.host_pwc_pml4_size = options.host_pwc_pml4_size
+            cpu.mmu.host_pwc_pdp_size = options.host_pwc_pdp_size
+            cpu.mmu.host_pwc_pde_size = options.host_pwc_pde_size
+        if options.stlb_size:
+            cpu.mmu.stlb = X86STLB(
+                size=options.stlb_size,
+                assoc=options.stlb_assoc,
+                latency=options.stlb_latency,
+            )
+        for walker in (cpu.mmu.itb.walker, cpu.mmu.dtb.walker):
+            walker.line_fill_tlb = options.walker_line_fill_tlb
+            walker.line_fill_pwc = options.walker_line_fill_pwc
+            walker.prefetch_degree = options.walker_prefetch_degree
+            walker.num_walkers = options.walker_num_walkers
+            if not options.ruby:
+                walker.cache_levels = int(options.caches) + int(
+                    options.l2cache
+                )
+        if options.walk_profile:
+            # One per MMU: both walkers share its pwc
+            cpu.mmu.profiler = X86WalkProfiler(
+                max_distance=options.walk_profile_max_distance
+            )
+
+
+def setupMemCheckpoints(testsys, options):
+    """Shiming: the format of the memory in the checkpoints of testsys"""
+    incremental = options.mem_checkpoint_incremental
+    testsys.mem_checkpoint_format = (
+        "chunked" if incremental else options.mem_checkpoint
+    )
+    testsys.mem_checkpoint_level = options.mem_checkpoint_level
+    testsys.mem_checkpoint_mmap_restore = options.mem_checkpoint_mmap_restore
+    testsys.mem_checkpoint_incremental = incremental
+
+
+def _eventqOf(obj):
+    """The event queue obj runs on, set on it or on an ancestor"""
+    while obj is not None:
+        index = obj._values.get("eventq_index")
+        if index is not None and not m5.proxy.isproxy(index):
+            return int(index)
+        obj = obj._parent
+    return 0
+
+
+def setupPdes(root, testsys, options):
+    """Shiming: Runs each cpu of testsys on its own event queue (thread),
+    with its MMU, TLBs, walkers and interrupt controller, and everything
+    else on queue 0. Each port between the two goes through a
+    QuantumBridge, whose latency is the lookahead of the quantum. The
+    lookahead is not added to the accesses, it is taken out of the
+    latencies of what is on the other side of the bridges.
+
+    With --pdes-cut=cpu, the caches and crossbars stay on queue 0 even when
+    they are children of a cpu, and the bridges are between the cpus and
+    their L1 and walker caches, which take the lookahead out of the latency
+    of their cpu side. The responses reach the cpus when they would without
+    the bridges, and a run gives the same result whatever the interleaving
+    of the threads. What is left is that the caches see the requests of the
+    cpus one lookahead late, and the cpus the snoops of their caches
+    (LL/SC). But the lookahead is at most half the tag latency of the L1s,
+    and the threads synchronize about every cycle.
+
+    With --pdes-cut=l2, the L1 and walker caches of a cpu run on its queue
+    too, and coherent bridges are between them and the L2 crossbar (see
+    QuantumBridge.py). The L2 takes the lookahead out of the latency of its
+    cpu side, half its tag latency by default, so that its hits and misses
+    take as long as without the bridges. A line that another L1 responds
+    with takes three lookaheads longer, a cache sends one request per
+    lookahead, and the runs differ with the interleaving of the threads.
+
+    With both, the pio and interrupt latencies of the local APIC take out
+    the lookahead, the cpus get the interrupt messages one lookahead
+    late."""
+    if not options.pdes:
+        return
+    if options.fast_forward or options.standard_switch or (
+        options.repeat_switch
+    ):
+        fatal("--pdes does not support switching cpus")
+    if type(testsys.cpu[0]).memory_mode() != "timing":
+        fatal("--pdes needs a cpu in timing mode")
+    if getattr(options, "pwc_shared_size", 0):
+        fatal("--pdes does not support a pwc shared by the cpus")
+    # The cpus of SE mode run the system calls on the processes, the page
+    # tables and the physical page allocator they share
+    if isinstance(testsys.workload, SEWorkload):
+        fatal("--pdes needs full system mode")
+    cut_l2 = options.pdes_cut == "l2"
+    if cut_l2 and not options.l2cache:
+        fatal("--pdes-cut=l2 needs --l2cache")
+    if cut_l2 and options.pdes_check:
+        fatal("--pdes-check needs --pdes-cut=cpu, the only deterministic cut")
+
+    from m5.params import Clock
+
+    m5.ticks.fixGlobalFrequency()
+    lookahead = options.pdes_lookahead
+    if not lookahead:
+        lookahead = Clock(options.cpu_clock).getValue()
+        # The L1 caches can take one cycle out of their latencies, the L2
+        # half its tag latency (a hit crosses twice)
+        if cut_l2:
+            lookahead *= int(testsys.l2.tag_latency) // 2
+    if lookahead < 2:
+        fatal("--pdes needs a lookahead of at least 2 ticks")
+    if cut_l2:
+        testsys.l2.cpu_side_lookahead = "%dt" % lookahead
+
+    apics = []
+    for i, cpu in enumerate(testsys.cpu):
+        cpu.eventq_index = i + 1
+        if not cut_l2:
+            for obj in cpu.descendants():
+                if isinstance(obj, (BaseCache, BaseXBar)):
+                    obj.eventq_index = 0
+
+        bridges = []
+        for obj in cpu.descendants():
+            if _eventqOf(obj) != i + 1:
+                continue
+            for name, ref in sorted(obj._port_refs.items()):
+                for port in getattr(ref, "elements", [ref]):
+                    peer = port.peer
+                    if peer is None or m5.proxy.isproxy(peer):
+                        continue
+                    peer_eventq = _eventqOf(peer.simobj)
+                    if peer_eventq == i + 1:
+                        continue
+                    coherent = False
+                    if obj.type == "X86LocalApic":
+                        if obj not in apics:
+                            apics.append(obj)
+                    elif not cut_l2 and isinstance(peer.simobj, BaseCache):
+                        peer.simobj.cpu_side_lookahead = "%dt" % lookahead
+                    elif (
+                        cut_l2
+                        and isinstance(obj, BaseCache)
+                        and peer.simobj is testsys.tol2bus
+                    ):
+                        coherent = True
+                    else:
+                        fatal(
+                            "--pdes has no latency to take the lookahead "
+                            "out of between %s and %s" % (port, peer)
+                        )
+                    # The in side of the bridge is the requestor
+                    if port.role == "GEM5 REQUESTOR":
+                        in_eventq, out_eventq = i + 1, peer_eventq
+                    else:
+                        in_eventq, out_eventq = peer_eventq, i + 1
+                    bridge = QuantumBridge(
+                        in_eventq_index=in_eventq,
+                        eventq_index=out_eventq,
+                        latency="%dt" % lookahead,
+                        check_determinism=options.pdes_check,
+                        coherent=coherent,
+                    )
+                    bridges.append(bridge)
+                    port.splice(bridge.in_port, bridge.out_port)
+        cpu.pdes_bridges = bridges
+
+    for apic in apics:
+        # The pio and interrupt responses cross two bridges, the interrupt
+        # messages sent one
+        pio_latency = apic.pio_latency.getValue() - 2 * lookahead
+        int_latency = apic.int_latency.getValue() - lookahead
+        if pio_latency < 0:
+            fatal("The pio latency of %s is shorter than the lookahead" % apic)
+        # The long lookahead of the l2 cut is more than the 1ns of an
+        # interrupt message
+        if int_latency < 0:
+            warn(
+                "The interrupt messages of %s take %d ticks longer"
+                % (apic, -int_latency)
+            )
+            int_latency = 0
+        apic.pio_latency = "%dt" % pio_latency
+        apic.int_latency = "%dt" % int_latency
+
+    # The largest quantum the lookahead allows
+    root.sim_quantum = lookahead - 1
+
+
 def setMemClass(options):
     """Returns a memory controller class."""
 
@@ -510,10 +744,7 @@ def run(options, root, testsys, cpu_class):
     if cpu_class:
         # Shiming: Initialize pwc arguments
         switch_cpus = [cpu_class(switched_out=True, cpu_id=(i), \
-                        enable_pwc=testsys.cpu[i].enable_pwc, \
-                        pwc_pml4_size=testsys.cpu[i].pwc_pml4_size, \
-                        pwc_pdp_size=testsys.cpu[i].pwc_pdp_size, \
-                        pwc_pde_size=testsys.cpu[i].pwc_pde_size)
+                        **testsys.cpu[i].pwcArgs())
                        for i in range(np)]
 
         for i in range(np):
@@ -547,6 +778,7 @@ def run(options, root, testsys, cpu_class):
         if options.elastic_trace_en:
             CpuConfig.config_etrace(cpu_class, switch_cpus, options)
 
+        setupMmus(testsys, switch_cpus, options)
         testsys.switch_cpus = switch_cpus
         switch_cpu_list = [(testsys.cpu[i], switch_cpus[i]) for i in range(np)]
 
@@ -561,10 +793,7 @@ def run(options, root, testsys, cpu_class):
 
         # Shiming: Initialize pwc settings
         repeat_switch_cpus = [switch_class(switched_out=True, cpu_id=(i), \
-                                enable_pwc=testsys.cpu[i].enable_pwc, \
-                                pwc_pml4_size=testsys.cpu[i].pwc_pml4_size, \
-                                pwc_pdp_size=testsys.cpu[i].pwc_pdp_size, \
-                                pwc_pde_size=testsys.cpu[i].pwc_pde_size) \
+                                **testsys.cpu[i].pwcArgs()) \
                             for i in range(np)]
 
         for i in range(np):
@@ -581,6 +810,7 @@ def run(options, root, testsys, cpu_class):
 
             repeat_switch_cpus[i].createThreads()
 
+        setupMmus(testsys, repeat_switch_cpus, options)
         testsys.repeat_switch_cpus = repeat_switch_cpus
 
         if cpu_class:
@@ -595,17 +825,11 @@ def run(options, root, testsys, cpu_class):
     if options.standard_switch:
         # Shiming: Initialize pwc settings
         switch_cpus = [TimingSimpleCPU(switched_out=True, cpu_id=(i), \
-                        enable_pwc=testsys.cpu[i].enable_pwc, \
-                        pwc_pml4_size=testsys.cpu[i].pwc_pml4_size, \
-                        pwc_pdp_size=testsys.cpu[i].pwc_pdp_size, \
-                        pwc_pde_size=testsys.cpu[i].pwc_pde_size) \
+                        **testsys.cpu[i].pwcArgs()) \
                        for i in range(np)]
         # Shiming: Initialize pwc settings
         switch_cpus_1 = [DerivO3CPU(switched_out=True, cpu_id=(i), \
-                        enable_pwc=testsys.cpu[i].enable_pwc, \
-                        pwc_pml4_size=testsys.cpu[i].pwc_pml4_size, \
-                        pwc_pdp_size=testsys.cpu[i].pwc_pdp_size, \
-                        pwc_pde_size=testsys.cpu[i].pwc_pde_size) \
+                        **testsys.cpu[i].pwcArgs()) \
                         for i in range(np)]
 
         for i in range(np):
@@ -651,7 +875,9 @@ def run(options, root, testsys, cpu_class):
             switch_cpus[i].createThreads()
             switch_cpus_1[i].createThreads()
 
+        setupMmus(testsys, switch_cpus, options)
         testsys.switch_cpus = switch_cpus
+        setupMmus(testsys, switch_cpus_1, options)
         testsys.switch_cpus_1 = switch_cpus_1
         switch_cpu_list = [(testsys.cpu[i], switch_cpus[i]) for i in range(np)]
         switch_cpu_list1 = [
@@ -689,6 +915,9 @@ def run(options, root, testsys, cpu_class):
     checkpoint_dir = None
     if options.checkpoint_restore:
         cpt_starttick, checkpoint_dir = findCptDir(options, cptdir, testsys)
+    root.event_queue = options.event_queue
+    setupMemCheckpoints(testsys, options)
+    setupPdes(root, testsys, options)
     root.apply_config(options.param)
     m5.instantiate(checkpoint_dir)
 
@@ -0,0 +1,134 @@
+# 2023 Feb
+# Shiming Li
+# shiming.li@it.uu.se
+#
+# Uppsala Architecture Research Team (UART)
+# Uppsala University
+
+# Host time microbenchmark of the tag lookups of the classic caches. A
+# traffic generator sends random reads through three levels of caches,
+# over a footprint larger than the last level so that every level looks
+# up, misses and replaces blocks. The host time of the run is printed at
+# the end, and the lookups of each level are in stats.txt
+# (system.l<N>.overallAccesses). Run the same command with two builds, or
+# with and without --packed-tags, to compare them.
+#
+# Example:
+#   build/X86/gem5.opt configs/example/cache_lookup_bench.py \
+#       --tags=set_assoc --assoc=16 --packed-tags
+
+import argparse
+import time
+
+import m5
+from m5.objects import *
+
+parser = argparse.ArgumentParser(
+    formatter_class=argparse.ArgumentDefaultsHelpFormatter
+)
+parser.add_argument(
+    "--tags",
+    choices=["set_assoc", "skewed", "sector", "compressed"],
+    default="set_assoc",
+    help="Tags of all the caches",
+)
+parser.add_argument(
+    "--assoc", type=int, default=8, help="Associativity of all the caches"
+)
+parser.add_argument(
+    "--packed-tags",
+    action="store_true",
+    help="Compare the packed tags of a set at once (set_assoc tags only)",
+)
+parser.add_argument(
+    "--duration",
+    default="10ms",
+    help="Simulated time of the traffic",
+)
+parser.add_argument(
+    "--footprint",
+    default="64MiB",
+    help="Range of the random addresses",
+)
+
+args = parser.parse_args()
+
+
+def tags():
+    if args.tags == "skewed":
+        return BaseSetAssoc(indexing_policy=SkewedAssociative())
+    if args.tags == "sector":
+        return SectorTags()
+    if args.tags == "compressed":
+        return CompressedTags()
+    return BaseSetAssoc(packed_tags=args.packed_tags)
+
+
+def cache(size, latency):
+    c = Cache(
+        size=size,
+        assoc=args.assoc,
+        tag_latency=latency,
+        data_latency=latency,
+        response_latency=latency,
+        mshrs=32,
+        tgts_per_mshr=8,
+        tags=tags(),
+    )
+    if args.tags == "compressed":
+        c.compressor = BDI()
+    return c
+
+
+system = System(membus=SystemXBar())
+system.clk_domain = SrcClockDomain(
+    clock="2GHz", voltage_domain=VoltageDomain(voltage="1V")
+)
+system.mem_ranges = [AddrRange(args.footprint)]
+system.mmap_using_noreserve = True
+system.mem_mode = "timing"
+
+system.tgen = PyTrafficGen()
+system.l1 = cache("32KiB", 2)
+system.l2 = cache("256KiB", 10)
+system.l3 = cache("2MiB", 20)
+system.l2bus = L2XBar()
+system.l3bus = L2XBar()
+
+system.tgen.port = system.l1.cpu_side
+system.l1.mem_side = system.l2bus.cpu_side_ports
+system.l2bus.mem_side_ports = system.l2.cpu_side
+system.l2.mem_side = system.l3bus.cpu_side_ports
+system.l3bus.mem_side_ports = system.l3.cpu_side
+system.l3.mem_side = system.membus.cpu_side_ports
+
+# The memory is not what is measured, keep it simple and fast
+system.mem = SimpleMemory(range=system.mem_ranges[0], latency="50ns")
+system.mem.port = system.membus.mem_side_ports
+system.system_port = system.membus.cpu_side_ports
+
+root = Root(full_system=False, system=system)
+m5.instantiate()
+
+duration = int(m5.ticks.fromSeconds(m5.util.convert.toLatency(args.duration)))
+end = int(m5.util.convert.toMemorySize(args.footprint))
+
+
+def traffic():
+    # One read per ns at most, as fast as the caches take them
+    yield system.tgen.createRandom(duration, 0, end, 64, 1000, 1000, 100, 0)
+    yield system.tgen.createExit(0)
+
+
+system.tgen.start(traffic())
+
+start = time.time()
+exit_event = m5.simulate()
+host_seconds = time.time() - start
+
+m5.stats.dump()
+print(f"Exiting @ tick {m5.curTick()} because {exit_event.getCause()}")
+print(
+    f"tags={args.tags} assoc={args.assoc} packed_tags={args.packed_tags}"
+)
+print(f"host seconds: {host_seconds:.3f}")
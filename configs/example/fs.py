@@ -147,11 +147,9 @@ def build_test_system(np):
     # Shiming: Initialize pwc settings
     test_sys.cpu = [TestCPUClass(clk_domain=test_sys.cpu_clk_domain, \
                         cpu_id=i, \
-                        enable_pwc=args.enable_pwc, \
-                        pwc_pml4_size=args.pwc_pml4_size, \
-                        pwc_pdp_size=args.pwc_pdp_size, \
-                        pwc_pde_size=args.pwc_pde_size)
+                        **Simulation.pwcArgs(args))
                     for i in range(np)]
+    Simulation.addSharedPwc(test_sys, args)
 
     if args.ruby:
         bootmem = getattr(test_sys, "_bootmem", None)
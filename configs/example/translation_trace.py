@@ -0,0 +1,170 @@
+# 2023 Feb
+# Shiming Li
+# shiming.li@it.uu.se
+#
+# Uppsala Architecture Research Team (UART)
+# Uppsala University
+
+# Replay a virtual address trace through TLB and pwc configurations, without
+# a CPU (see src/arch/x86/trace_player.hh). Every combination of the
+# comma separated sizes below gets its own player and X86MMU, all of them
+# replay the same trace in one run. The stats of each player are dumped
+# under system.player<N> (system.player if there is only one), those of its
+# TLBs, walkers and pwc under system.player<N>.mmu. The configuration of
+# each player is printed first.
+#
+# Example:
+#   build/X86/gem5.opt configs/example/translation_trace.py \
+#       --trace=addrs.bin --tlb-sizes=64,128 --pwc-pde-sizes=16,32,64
+
+import argparse
+import itertools
+
+import m5
+from m5.objects import *
+
+
+def sizes(arg):
+    return [int(x) for x in arg.split(",")]
+
+
+parser = argparse.ArgumentParser(
+    formatter_class=argparse.ArgumentDefaultsHelpFormatter
+)
+parser.add_argument("--trace", required=True, help="Trace to replay")
+parser.add_argument(
+    "--trace-format",
+    choices=["binary", "protobuf"],
+    default="binary",
+    help="binary: little endian 64-bit virtual addresses, protobuf: "
+    "gem5 packet trace",
+)
+parser.add_argument(
+    "--protobuf-virtual-addresses",
+    action="store_true",
+    help="The protobuf trace holds virtual addresses (the packet traces "
+    "of gem5 hold physical ones, and are rejected otherwise)",
+)
+parser.add_argument(
+    "--mem-mode",
+    choices=["timing", "atomic"],
+    default="timing",
+    help="timing: translate one access at a time, with the walk and pwc "
+    "latencies, atomic: count the hits and misses only",
+)
+parser.add_argument(
+    "--max-accesses",
+    type=int,
+    default=0,
+    help="Stop each player after this many accesses (0 for all)",
+)
+parser.add_argument(
+    "--la57", action="store_true", help="Walk a 5-level page table"
+)
+parser.add_argument(
+    "--page-size", default="4KiB", help="Page size: 4KiB, 2MiB or 1GiB"
+)
+parser.add_argument(
+    "--walk-read-latency",
+    type=int,
+    default=30,
+    help="Latency of a page table read, in cycles",
+)
+parser.add_argument(
+    "--tlb-sizes", type=sizes, default=[64], help="DTB sizes"
+)
+parser.add_argument(
+    "--tlb-assoc",
+    type=int,
+    default=0,
+    help="DTB associativity (0: fully associative)",
+)
+parser.add_argument("--no-pwc", action="store_true", help="Walk without a pwc")
+parser.add_argument(
+    "--pwc-pml4-sizes", type=sizes, default=[8], help="PML4 cache sizes"
+)
+parser.add_argument(
+    "--pwc-pdp-sizes", type=sizes, default=[16], help="PDP cache sizes"
+)
+parser.add_argument(
+    "--pwc-pde-sizes", type=sizes, default=[32], help="PDE cache sizes"
+)
+parser.add_argument(
+    "--pwc-assoc",
+    type=int,
+    default=0,
+    help="Associativity of all pwc levels (0: fully associative)",
+)
+parser.add_argument(
+    "--pwc-parallel-probe",
+    action="store_true",
+    help="Probe all pwc levels in one step",
+)
+parser.add_argument(
+    "--pwc-lookup-latency",
+    type=int,
+    default=0,
+    help="Latency of a pwc lookup, in cycles",
+)
+
+parser.add_argument(
+    "--pwc-huge-page-fill",
+    choices=["normal", "bypass", "prioritise"],
+    default="normal",
+    help="How walks ending at a 2M/1G page fill the pwc",
+)
+
+args = parser.parse_args()
+
+# Shiming: The real TLBs only walk the page table in full system mode
+system = System(mem_mode=args.mem_mode)
+system.clk_domain = SrcClockDomain(
+    clock="1GHz", voltage_domain=VoltageDomain()
+)
+root = Root(full_system=True, system=system)
+
+configs = list(
+    itertools.product(
+        args.tlb_sizes,
+        args.pwc_pml4_sizes,
+        args.pwc_pdp_sizes,
+        args.pwc_pde_sizes,
+    )
+)
+players = []
+for i, (tlb, pml4, pdp, pde) in enumerate(configs):
+    print(
+        f"player{i}: tlb_size={tlb} pwc_pml4_size={pml4} "
+        f"pwc_pdp_size={pdp} pwc_pde_size={pde}"
+    )
+    mmu = X86MMU(
+        enable_pwc=not args.no_pwc,
+        pwc_pml4_size=pml4,
+        pwc_pml4_assoc=args.pwc_assoc,
+        pwc_pdp_size=pdp,
+        pwc_pdp_assoc=args.pwc_assoc,
+        pwc_pde_size=pde,
+        pwc_pde_assoc=args.pwc_assoc,
+        pwc_parallel_probe=args.pwc_parallel_probe,
+        pwc_lookup_latency=args.pwc_lookup_latency,
+        pwc_huge_page_fill=args.pwc_huge_page_fill,
+    )
+    mmu.dtb.size = tlb
+    mmu.dtb.assoc = args.tlb_assoc
+    player = X86TranslationTracePlayer(
+        mmu=mmu,
+        trace_file=args.trace,
+        trace_format=args.trace_format,
+        protobuf_virtual_addresses=args.protobuf_virtual_addresses,
+        max_accesses=args.max_accesses,
+        la57=args.la57,
+        page_size=args.page_size,
+        walk_read_latency=args.walk_read_latency,
+    )
+    mmu.connectWalkerPorts(player.walker_ports, player.walker_ports)
+    players.append(player)
+system.player = players
+
+m5.instantiate()
+exit_event = m5.simulate()
+print(f"Exiting @ tick {m5.curTick()} because {exit_event.getCause()}")
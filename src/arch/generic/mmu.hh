@@ -109,7 +109,8 @@ class BaseMMU : public SimObject
 
     virtual void flushAll();
 
-    void demapPage(Addr vaddr, uint64_t asn);
+    // Shiming: virtual, so that MMUs can demap their pwc too
+    virtual void demapPage(Addr vaddr, uint64_t asn);
 
     virtual Fault
     translateAtomic(const RequestPtr &req, ThreadContext *tc,
@@ -0,0 +1,268 @@
+/**
+ * 2023 Feb
+ * Shiming Li
+ * shiming.li@it.uu.se
+ *
+ * Uppsala Architecture Research Team (UART)
+ * Uppsala University
+ *
+ * The entries of the page walk caches, see translation_cache_store.hh.
+ */
+
+#include "arch/generic/translation_cache_store.hh"
+
+#include "base/bitfield.hh"
+#include "base/intmath.hh"
+#include "base/logging.hh"
+
+namespace gem5
+{
+    TranslationCacheStore::TranslationCacheStore(std::string _name,
+            uint32_t _size, uint32_t _assoc, replacement_policy::Base *_rp)
+            : myName(_name), size(_size), lruSeq(0),
+                assoc((_assoc == 0 || _assoc > _size) ? _size : _assoc),
+                replacementPolicy(_rp), tc(_size) {
+        fatal_if(size == 0, "%s: translation cache must have a non-zero "
+                "size", name());
+        fatal_if(size % assoc != 0, "%s: size (%d) must be a multiple of "
+                "the associativity (%d)", name(), size, assoc);
+        numSets = size / assoc;
+        fatal_if(!isPowerOf2(numSets), "%s: number of sets (%d) must be a "
+                "power of 2", name(), numSets);
+        setBits = floorLog2(numSets);
+        fullyAssoc = (numSets == 1);
+
+        sets.resize(numSets);
+        for (uint32_t x = 0; x < size; x++) {
+            uint32_t set = x / assoc;
+            tc[x].setPosition(set, x % assoc);
+            if (replacementPolicy) {
+                tc[x].replacementData = replacementPolicy->instantiateEntry();
+            }
+            sets[set].push_back(&tc[x]);
+        }
+    }
+
+    uint8_t TranslationCacheStore::addLevel(EvictedCallback evicted,
+            statistics::Average *occupancy_stat) {
+        occupancy.push_back(0);
+        occupancyStats.push_back(occupancy_stat);
+        evictedCallbacks.push_back(evicted);
+        return occupancy.size() - 1;
+    }
+
+    void TranslationCacheStore::updateOccupancy(uint8_t level, int delta) {
+        occupancy[level] += delta;
+        *occupancyStats[level] = occupancy[level];
+    }
+
+    uint32_t TranslationCacheStore::getSet(Addr idx,
+            unsigned shift) const {
+        if (fullyAssoc) {
+            return 0;
+        }
+        // XOR-fold the vpn bits above the index so that regular strides
+        //  do not all map to the same set. Shiming: Only the index picks
+        //  the set, the ASID, root and level are left to the tag compare,
+        //  so that a demap of an index probes a single set.
+        Addr vpn = idx >> shift;
+        return (vpn ^ (vpn >> setBits)) & (numSets - 1);
+    }
+
+    Addr TranslationCacheStore::trieKey(Addr idx, uint16_t asid,
+            uint8_t level) {
+        // Indices have at least their 19 low bits masked out (21 on x86,
+        //  and in RISC-V Sv39)
+        assert(mbits(idx, 18, 0) == 0 && level < (1 << 3));
+        return idx | ((Addr)level << 16) | asid;
+    }
+
+    TranslationCacheEntry* TranslationCacheStore::find(Addr idx,
+            uint16_t asid, Addr root, uint8_t level, unsigned shift) {
+        if (fullyAssoc) {
+            for (TranslationCacheEntry *entry =
+                    trie.lookup(trieKey(idx, asid, level));
+                    entry; entry = entry->sameKey) {
+                if (entry->root == root) {
+                    return entry;
+                }
+            }
+            return nullptr;
+        }
+        for (ReplaceableEntry *way :
+                sets[getSet(idx, shift)]) {
+            TranslationCacheEntry *entry =
+                static_cast<TranslationCacheEntry *>(way);
+            if (entry->valid && entry->index == idx && entry->asid == asid
+                    && entry->root == root && entry->level == level) {
+                return entry;
+            }
+        }
+        return nullptr;
+    }
+
+    TranslationCacheEntry* TranslationCacheStore::fill(Addr idx,
+            uint16_t asid, Addr root, uint8_t level, unsigned shift,
+            uint64_t ptentry, bool &evicted) {
+        const ReplacementCandidates &candidates =
+            sets[getSet(idx, shift)];
+        TranslationCacheEntry *newEntry = nullptr;
+        for (ReplaceableEntry *way : candidates) {
+            TranslationCacheEntry *entry =
+                static_cast<TranslationCacheEntry *>(way);
+            if (!entry->valid) {
+                newEntry = entry;
+                break;
+            }
+        }
+
+        evicted = !newEntry;
+        if (!newEntry) {
+            if (replacementPolicy) {
+                newEntry = static_cast<TranslationCacheEntry *>(
+                        replacementPolicy->getVictim(candidates));
+            } else {
+                newEntry = static_cast<TranslationCacheEntry *>(candidates[0]);
+                for (ReplaceableEntry *way : candidates) {
+                    TranslationCacheEntry *entry =
+                        static_cast<TranslationCacheEntry *>(way);
+                    if (entry->lruSeq < newEntry->lruSeq) {
+                        newEntry = entry;
+                    }
+                }
+            }
+            if (evictedCallbacks[newEntry->level]) {
+                evictedCallbacks[newEntry->level](*newEntry);
+            }
+            invalidate(newEntry);
+        }
+
+        newEntry->valid = true;
+        newEntry->nextStepEntry = ptentry;
+        newEntry->index = idx;
+        newEntry->asid = asid;
+        newEntry->root = root;
+        newEntry->level = level;
+        newEntry->users = 0;
+        if (replacementPolicy) {
+            replacementPolicy->reset(newEntry->replacementData);
+        }
+        newEntry->lruSeq = nextSeq();
+        if (fullyAssoc) {
+            // After the eviction, which may have emptied the node
+            Addr key = trieKey(idx, asid, level);
+            TranslationCacheEntry *head = trie.lookup(key);
+            if (head) {
+                newEntry->trieHandle = head->trieHandle;
+                newEntry->sameKey = head->sameKey;
+                head->sameKey = newEntry;
+            } else {
+                newEntry->trieHandle = trie.insert(key,
+                        TranslationCacheEntryTrie::MaxBits, newEntry);
+                newEntry->sameKey = nullptr;
+            }
+        }
+        updateOccupancy(level, 1);
+        return newEntry;
+    }
+
+    void TranslationCacheStore::touch(TranslationCacheEntry *entry) {
+        if (replacementPolicy) {
+            replacementPolicy->touch(entry->replacementData);
+        }
+        entry->lruSeq = nextSeq();
+    }
+
+    void TranslationCacheStore::demote(TranslationCacheEntry *entry) {
+        assert(entry->valid);
+        // Shiming: Filled and reset, now the next probable victim of the
+        //  policy, but still valid so that a touch promotes it again
+        if (replacementPolicy) {
+            replacementPolicy->demote(entry->replacementData);
+        }
+        entry->lruSeq = 0;
+    }
+
+    void TranslationCacheStore::invalidate(TranslationCacheEntry *entry) {
+        assert(entry->valid);
+        if (fullyAssoc) {
+            TranslationCacheEntryTrie::Handle node = entry->trieHandle;
+            assert(node);
+            if (node->value != entry) {
+                TranslationCacheEntry *prev = node->value;
+                while (prev->sameKey != entry) {
+                    prev = prev->sameKey;
+                }
+                prev->sameKey = entry->sameKey;
+            } else if (entry->sameKey) {
+                node->value = entry->sameKey;
+            } else {
+                trie.remove(node);
+            }
+            entry->trieHandle = NULL;
+            entry->sameKey = nullptr;
+        }
+        if (replacementPolicy) {
+            replacementPolicy->invalidate(entry->replacementData);
+        }
+        entry->valid = false;
+        updateOccupancy(entry->level, -1);
+    }
+
+    unsigned TranslationCacheStore::invalidateLevel(uint8_t level,
+            bool match_asid, uint16_t asid) {
+        unsigned count = 0;
+        for (unsigned i = 0; i < size; i++) {
+            if (tc[i].valid && tc[i].level == level
+                    && (!match_asid || tc[i].asid == asid)) {
+                invalidate(&tc[i]);
+                count++;
+            }
+        }
+        return count;
+    }
+
+    unsigned TranslationCacheStore::invalidateIndex(uint8_t level,
+            Addr idx, unsigned shift, bool match_asid, uint16_t asid) {
+        unsigned count = 0;
+        for (ReplaceableEntry *way : sets[getSet(idx, shift)]) {
+            TranslationCacheEntry *entry =
+                static_cast<TranslationCacheEntry *>(way);
+            if (entry->valid && entry->level == level
+                    && entry->index == idx
+                    && (!match_asid || entry->asid == asid)) {
+                invalidate(entry);
+                count++;
+            }
+        }
+        return count;
+    }
+
+    unsigned TranslationCacheStore::dropUser(uint8_t level, unsigned user,
+            bool match_asid, uint16_t asid) {
+        unsigned count = 0;
+        for (unsigned i = 0; i < size; i++) {
+            if (tc[i].valid && tc[i].level == level
+                    && (!match_asid || tc[i].asid == asid)
+                    && bits(tc[i].users, user)) {
+                tc[i].users = insertBits(tc[i].users, user, 0);
+                if (!tc[i].users) {
+                    invalidate(&tc[i]);
+                    count++;
+                }
+            }
+        }
+        return count;
+    }
+
+    std::vector<const TranslationCacheEntry *>
+            TranslationCacheStore::levelEntries(uint8_t level) const {
+        std::vector<const TranslationCacheEntry *> entries;
+        for (unsigned i = 0; i < size; i++) {
+            if (tc[i].valid && tc[i].level == level) {
+                entries.push_back(&tc[i]);
+            }
+        }
+        return entries;
+    }
+} // namespace gem5
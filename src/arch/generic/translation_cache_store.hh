@@ -0,0 +1,201 @@
+/**
+ * 2023 Feb
+ * Shiming Li
+ * shiming.li@it.uu.se
+ *
+ * Uppsala Architecture Research Team (UART)
+ * Uppsala University
+ *
+ * The entries of the page walk caches, shared by the ISAs. An entry maps
+ *  the virtual index of a walk level, in an address space (ASID and page
+ *  table root), to the non-leaf PTE the walk reads there. How the index
+ *  is taken from an address, and what the PTE means, is left to the ISA
+ *  (see arch/x86/translation_cache.hh and arch/riscv/translation_cache.hh).
+ */
+
+#ifndef __ARCH_GENERIC_TRANSLATION_CACHE_STORE_HH__
+#define __ARCH_GENERIC_TRANSLATION_CACHE_STORE_HH__
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "base/trie.hh"
+#include "base/types.hh"
+#include "mem/cache/replacement_policies/base.hh"
+#include "mem/cache/replacement_policies/replaceable_entry.hh"
+#include "sim/stats.hh"
+
+namespace gem5
+{
+
+    // Declare here first, and define later. Need it for declaring Trie
+    struct TranslationCacheEntry;
+
+    typedef Trie<Addr, TranslationCacheEntry> TranslationCacheEntryTrie;
+
+    /**
+     * An entry is a ReplaceableEntry so that the set-associative organization
+     *  can hand its ways to any of the replacement policies of the classic
+     *  caches.
+     */
+    struct TranslationCacheEntry : public ReplaceableEntry
+    {
+        bool valid = false;
+        Addr index = 0;
+        // Address space identifier: the PCID on x86 (0 when CR4.PCIDE is
+        //  clear), the ASID on RISC-V
+        uint16_t asid = 0;
+        // Level (translation cache) owning the entry in a shared store
+        uint8_t level = 0;
+        // Page table root (CR3, satp.ppn) of the walk that filled the
+        //  entry, part of the tag so that address spaces with the same
+        //  identifier coexist
+        Addr root = 0;
+        // The raw PTE, for the walk to continue from
+        uint64_t nextStepEntry = 0;
+        // Victim selection of the built-in LRU (no replacement policy
+        //  given), and recency order in checkpoints
+        uint64_t lruSeq = 0;
+        // Upper levels (one per core) that filled or hit the entry, only
+        //  kept in a shared level, see X86ISA::BaseTranslationCache::flush()
+        uint64_t users = 0;
+        // Order of the walk that filled the entry, or last filled it again,
+        //  among all the fills. Compared to the flushes of the upper levels
+        //  in a shared level, see X86ISA::BaseTranslationCache::flush()
+        uint64_t fillSeq = 0;
+        // Only used in the fully associative organization. The trie key
+        //  has no room for the root, so the entries that only differ in
+        //  root hang off the same trie node.
+        TranslationCacheEntryTrie::Handle trieHandle = nullptr;
+        TranslationCacheEntry *sameKey = nullptr;
+    };
+
+    /**
+     * The entries of one or more translation caches, organized as
+     *  numSets x assoc. A store is either private to one translation cache
+     *  (split pwc) or shared by all levels (unified pwc), in which case the
+     *  levels compete for capacity and entries are also tagged with their
+     *  level. Entries are tagged (index, asid, root, level), the set only
+     *  depends on the index.
+     */
+    class TranslationCacheStore
+    {
+        public:
+            typedef std::function<void(const TranslationCacheEntry &)>
+                EvictedCallback;
+
+        private:
+            std::string myName;
+
+            uint32_t size;
+            uint64_t lruSeq;
+
+            /**
+             * A single set means fully associative, in which case lookups go
+             *  through the trie instead of scanning the (only) set.
+             */
+            uint32_t assoc;
+            uint32_t numSets;
+            unsigned setBits;
+            bool fullyAssoc;
+
+            /**
+             * Victim selection. If null, an exact LRU based on lruSeq is
+             *  used, which matches the original fully associative cache.
+             */
+            replacement_policy::Base *replacementPolicy;
+
+            std::vector<TranslationCacheEntry> tc;
+            /** Ways of each set, kept as replacement candidates */
+            std::vector<ReplacementCandidates> sets;
+
+            TranslationCacheEntryTrie trie;
+
+            /** Valid entries of each level, and where to report them */
+            std::vector<unsigned> occupancy;
+            std::vector<statistics::Average *> occupancyStats;
+            /** Told about the evictions of each level, if set */
+            std::vector<EvictedCallback> evictedCallbacks;
+
+        private:
+            uint64_t nextSeq() { return ++lruSeq; }
+
+            /**
+             * Hash an index into a set. shift drops the low bits that are
+             *  masked out of the index of the level.
+             */
+            uint32_t getSet(Addr idx, unsigned shift) const;
+            /** Key of the trie: the ASID and level go in the low bits */
+            static Addr trieKey(Addr idx, uint16_t asid, uint8_t level);
+            void updateOccupancy(uint8_t level, int delta);
+
+        public:
+            /**
+             * @param _assoc Number of ways per set. 0 (or _size) means
+             *  fully associative.
+             * @param _rp Replacement policy, possibly shared with other
+             *  stores. nullptr selects the built-in exact LRU.
+             */
+            TranslationCacheStore(std::string _name, uint32_t _size,
+                uint32_t _assoc, replacement_policy::Base *_rp);
+
+            /**
+             * Register a level using this store.
+             * @param evicted Told about the entries of the level that are
+             *  evicted to make room for others, may be empty.
+             * @param occupancy_stat Updated whenever the number of valid
+             *  entries of the level changes.
+             * @return The level tag of its entries.
+             */
+            uint8_t addLevel(EvictedCallback evicted,
+                    statistics::Average *occupancy_stat);
+
+            /**
+             * The entry tagged with idx, asid, root and level, if any.
+             * @param idx The virtual address bits above shift, the bits
+             *  below are 0 (at least 19 of them).
+             */
+            TranslationCacheEntry* find(Addr idx, uint16_t asid, Addr root,
+                    uint8_t level, unsigned shift);
+            /**
+             * Fill a way of the set of idx. Returns the entry and whether a
+             *  valid entry had to be evicted for it.
+             */
+            TranslationCacheEntry* fill(Addr idx, uint16_t asid, Addr root,
+                    uint8_t level, unsigned shift, uint64_t ptentry,
+                    bool &evicted);
+            void touch(TranslationCacheEntry *entry);
+            /** Make entry the next victim of its set */
+            void demote(TranslationCacheEntry *entry);
+            void invalidate(TranslationCacheEntry *entry);
+            /**
+             * Invalidate the entries of a level (and ASID, if given).
+             * @return The number of entries invalidated.
+             */
+            unsigned invalidateLevel(uint8_t level, bool match_asid=false,
+                    uint16_t asid=0);
+            /**
+             * Invalidate the entries of a level with index idx (and ASID,
+             *  if given). Only the set of idx is probed.
+             * @return The number of entries invalidated.
+             */
+            unsigned invalidateIndex(uint8_t level, Addr idx,
+                    unsigned shift, bool match_asid=false, uint16_t asid=0);
+            /**
+             * Forget that an upper level uses the entries of a level (and
+             *  ASID, if given), and invalidate the ones nobody uses anymore.
+             * @return The number of entries invalidated.
+             */
+            unsigned dropUser(uint8_t level, unsigned user,
+                    bool match_asid=false, uint16_t asid=0);
+            /** The valid entries of a level, for checkpointing */
+            std::vector<const TranslationCacheEntry *> levelEntries(
+                    uint8_t level) const;
+
+            std::string name() const { return myName; }
+    };
+
+} // namespace gem5
+
+#endif // __ARCH_GENERIC_TRANSLATION_CACHE_STORE_HH__
@@ -53,6 +53,18 @@ class RiscvMMU(BaseMMU):
     pma_checker = Param.PMAChecker(PMAChecker(), "PMA Checker")
     pmp = Param.PMP(PMP(), "Physical Memory Protection Unit")
 
+    # Shiming: caches of the non-leaf PTEs of the walkers, as the x86 pwc
+    enable_pwc = Param.Bool(False, "Cache the non-leaf PTEs of page walks "
+                                    "(page walk cache)")
+    pwc_level2_size = Param.Unsigned(16, "Size of the cache of root "
+                                    "(level 2, 1GiB region) PTEs")
+    pwc_level1_size = Param.Unsigned(32, "Size of the cache of level 1 "
+                                    "(2MiB region) PTEs")
+    pwc_level2_assoc = Param.Unsigned(0, "Associativity of the cache of "
+                                     "root PTEs (0 for fully associative)")
+    pwc_level1_assoc = Param.Unsigned(0, "Associativity of the cache of "
+                                     "level 1 PTEs (0 for fully associative)")
+
     @classmethod
     def walkerPorts(cls):
         return ["mmu.itb.walker.port", "mmu.dtb.walker.port"]
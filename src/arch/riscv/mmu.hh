@@ -41,8 +41,10 @@
 #include "arch/generic/mmu.hh"
 #include "arch/riscv/isa.hh"
 #include "arch/riscv/page_size.hh"
+#include "arch/riscv/pagetable_walker.hh"
 #include "arch/riscv/pma_checker.hh"
 #include "arch/riscv/tlb.hh"
+#include "arch/riscv/translation_cache.hh"
 
 #include "params/RiscvMMU.hh"
 
@@ -55,10 +57,50 @@ class MMU : public BaseMMU
 {
   public:
     PMAChecker *pma;
+    // Shiming: cache of the non-leaf PTEs, shared by both walkers
+    PageStructureCache *pwc;
 
     MMU(const RiscvMMUParams &p)
-      : BaseMMU(p), pma(p.pma_checker)
-    {}
+      : BaseMMU(p), pma(p.pma_checker), pwc(nullptr)
+    {
+      enablePwc = p.enable_pwc;
+      if (enablePwc) {
+        pwc = new PageStructureCache(name(), p.pwc_level2_size,
+            p.pwc_level2_assoc, p.pwc_level1_size, p.pwc_level1_assoc);
+        static_cast<TLB*>(itb)->getWalker()->setPwc(pwc);
+        static_cast<TLB*>(dtb)->getWalker()->setPwc(pwc);
+      }
+    }
+
+    ~MMU()
+    {
+      delete pwc;
+    }
+
+    // Shiming: called by flushAll()
+    void
+    flushPwc() override
+    {
+      pwc->flushAll();
+    }
+
+    /**
+     * Shiming: SFENCE.VMA. Like the TLBs, a vaddr or asid of 0 means any
+     *  (x0 as rs1 or rs2).
+     */
+    void
+    demapPage(Addr vaddr, uint64_t asn) override
+    {
+      BaseMMU::demapPage(vaddr, asn);
+      if (enablePwc) {
+        asn &= 0xFFFF;
+        if (vaddr == 0 && asn == 0) {
+          pwc->flushAll();
+        } else {
+          pwc->demap(vaddr, asn);
+        }
+      }
+    }
 
     TranslationGenPtr
     translateFunctional(Addr start, Addr size, ThreadContext *tc,
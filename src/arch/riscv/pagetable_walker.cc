@@ -388,6 +388,11 @@ Walker::WalkerState::stepWalk(PacketPtr &write)
                     Addr idx = (entry.vaddr >> shift) & LEVEL_MASK;
                     nextRead = (pte.ppn << PageShift) + (idx * sizeof(pte));
                     nextState = Translate;
+                    // Shiming: cache the PTE of the level just walked
+                    if (walker->pwc && !functional) {
+                        walker->pwc->cacheOf(level + 1).insert(entry.vaddr,
+                                satp.asid, satp.ppn, pte);
+                    }
                 }
             }
         }
@@ -458,6 +463,26 @@ Walker::WalkerState::setupWalk(Addr vaddr)
     Addr topAddr = (satp.ppn << PageShift) + (idx * sizeof(PTESv39));
     level = 2;
 
+    // Shiming: start below the deepest cached non-leaf PTE, if any
+    if (walker->pwc && !functional) {
+        for (int cached = 1; cached <= 2; cached++) {
+            const TranslationCacheEntry *hit =
+                walker->pwc->cacheOf(cached).lookup(vaddr, satp.asid,
+                        satp.ppn);
+            if (hit) {
+                PTESv39 cached_pte = hit->nextStepEntry;
+                level = cached - 1;
+                shift = PageShift + LEVEL_BITS * level;
+                idx = (vaddr >> shift) & LEVEL_MASK;
+                topAddr = (cached_pte.ppn << PageShift) +
+                    (idx * sizeof(PTESv39));
+                DPRINTF(PageTableWalker, "Level%d PTE cached: %#x\n",
+                        cached, cached_pte);
+                break;
+            }
+        }
+    }
+
     DPRINTF(PageTableWalker, "Performing table walk for address %#x\n", vaddr);
     DPRINTF(PageTableWalker, "Loading level%d PTE from %#x\n", level, topAddr);
 
@@ -46,6 +46,7 @@
 #include "arch/riscv/pma_checker.hh"
 #include "arch/riscv/pmp.hh"
 #include "arch/riscv/tlb.hh"
+#include "arch/riscv/translation_cache.hh"
 #include "base/types.hh"
 #include "mem/packet.hh"
 #include "params/RiscvPagetableWalker.hh"
@@ -209,9 +210,17 @@ namespace RiscvISA
             pmp(params.pmp),
             requestorId(sys->getRequestorId(this)),
             numSquashable(params.num_squash_per_cycle),
-            startWalkWrapperEvent([this]{ startWalkWrapper(); }, name())
+            startWalkWrapperEvent([this]{ startWalkWrapper(); }, name()),
+            pwc(nullptr)
         {
         }
+
+        // Shiming: cache of the non-leaf PTEs, shared with the other
+        //  walker of the MMU. nullptr if disabled.
+      private:
+        PageStructureCache *pwc;
+      public:
+        void setPwc(PageStructureCache *_pwc) { pwc = _pwc; }
     };
 
 } // namespace RiscvISA
@@ -0,0 +1,133 @@
+/**
+ * 2023 Feb
+ * Shiming Li
+ * shiming.li@it.uu.se
+ *
+ * Uppsala Architecture Research Team (UART)
+ * Uppsala University
+ *
+ * Caches of the non-leaf PTEs of the RISC-V walker, see
+ *  translation_cache.hh.
+ */
+
+#include "arch/riscv/translation_cache.hh"
+
+#include "arch/riscv/page_size.hh"
+#include "base/bitfield.hh"
+#include "base/logging.hh"
+
+namespace gem5
+{
+namespace RiscvISA
+{
+    TranslationCache::TranslationCache(std::string _name, unsigned _size,
+            unsigned _assoc, unsigned _shift)
+            : myName(_name), shift(_shift),
+                store(_name, _size, _assoc, nullptr) {
+        // Nothing to tell about evictions, there is no shared level
+        level = store.addLevel(nullptr, &stats.occupancy);
+        stats.hit.name(name() + ".hit");
+        stats.miss.name(name() + ".miss");
+        stats.insert.name(name() + ".insert");
+        stats.evict.name(name() + ".evict");
+        stats.flush.name(name() + ".flush");
+        stats.demapped.name(name() + ".demapped");
+        stats.occupancy.name(name() + ".occupancy");
+    }
+
+    Addr TranslationCache::indexOf(Addr va) const {
+        return mbits(va, VADDR_BITS - 1, shift);
+    }
+
+    const TranslationCacheEntry *TranslationCache::lookup(Addr va,
+            uint16_t asid, Addr root) {
+        Addr idx = indexOf(va);
+        TranslationCacheEntry *entry = store.find(idx, asid, root, level,
+                shift);
+        if (!entry && asid != 0) {
+            entry = store.find(idx, 0, root, level, shift);
+            if (entry && !PTESv39(entry->nextStepEntry).g) {
+                entry = nullptr;
+            }
+        }
+        if (entry) {
+            store.touch(entry);
+            stats.hit++;
+        } else {
+            stats.miss++;
+        }
+        return entry;
+    }
+
+    void TranslationCache::insert(Addr va, uint16_t asid, Addr root,
+            PTESv39 pte) {
+        Addr idx = indexOf(va);
+        if (pte.g) {
+            asid = 0;
+        }
+        // If somebody beat us to it, just refresh that entry
+        TranslationCacheEntry *entry = store.find(idx, asid, root, level,
+                shift);
+        if (entry) {
+            entry->nextStepEntry = pte;
+            store.touch(entry);
+        } else {
+            bool evicted;
+            store.fill(idx, asid, root, level, shift, pte, evicted);
+            if (evicted) {
+                stats.evict++;
+            }
+        }
+        stats.insert++;
+    }
+
+    void TranslationCache::flushAll() {
+        store.invalidateLevel(level);
+        stats.flush++;
+    }
+
+    void TranslationCache::demap(Addr va, uint16_t asid) {
+        // The global entries are tagged with ASID 0, which a fence of one
+        //  ASID never matches
+        if (va == 0) {
+            stats.demapped += store.invalidateLevel(level, asid != 0,
+                    asid);
+        } else {
+            stats.demapped += store.invalidateIndex(level, indexOf(va),
+                    shift, asid != 0, asid);
+        }
+    }
+
+    PageStructureCache::PageStructureCache(std::string ownerName,
+            unsigned level2_size, unsigned level2_assoc,
+            unsigned level1_size, unsigned level1_assoc)
+            : level2Cache(ownerName + ".level2Cache", level2_size,
+                    level2_assoc, PageShift + LEVEL_BITS * 2),
+                level1Cache(ownerName + ".level1Cache", level1_size,
+                    level1_assoc, PageShift + LEVEL_BITS) {
+    }
+
+    TranslationCache &PageStructureCache::cacheOf(int level) {
+        switch (level) {
+            case 2:
+                return level2Cache;
+            case 1:
+                return level1Cache;
+            default:
+                panic("No page structure cache for level %d", level);
+        }
+    }
+
+    void PageStructureCache::flushAll() {
+        level2Cache.flushAll();
+        level1Cache.flushAll();
+    }
+
+    void PageStructureCache::demap(Addr va, uint16_t asid) {
+        // The spec only asks an address specific fence to order the leaf
+        //  PTEs of va, dropping the non-leaf ones that map it is safe too
+        level2Cache.demap(va, asid);
+        level1Cache.demap(va, asid);
+    }
+} // namespace RiscvISA
+} // namespace gem5
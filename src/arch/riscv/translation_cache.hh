@@ -0,0 +1,104 @@
+/**
+ * 2023 Feb
+ * Shiming Li
+ * shiming.li@it.uu.se
+ *
+ * Uppsala Architecture Research Team (UART)
+ * Uppsala University
+ *
+ * Caches of the non-leaf PTEs of the RISC-V page table walker, the
+ *  counterpart of the x86 page structure caches (see
+ *  arch/x86/translation_cache.hh), so that walker designs can be compared
+ *  across ISAs. Both keep their entries in a TranslationCacheStore (see
+ *  arch/generic/translation_cache_store.hh).
+ *
+ * Only Sv39 is walked, so there are two levels: the root (level 2) PTEs,
+ *  which map 1GiB regions, and the level 1 PTEs, which map 2MiB regions.
+ *  Leaf PTEs are never cached here, they go into the TLB.
+ */
+
+#ifndef __ARCH_RISCV_TRANSLATION_CACHE_HH__
+#define __ARCH_RISCV_TRANSLATION_CACHE_HH__
+
+#include <string>
+
+#include "arch/generic/translation_cache_store.hh"
+#include "arch/riscv/pagetable.hh"
+#include "base/types.hh"
+#include "sim/stats.hh"
+
+namespace gem5
+{
+
+namespace RiscvISA
+{
+    /**
+     * The PTEs of one level. An entry is tagged with the virtual address
+     *  bits above the region of its PTE, the ASID and the page table root
+     *  (satp.ppn). Global PTEs (G set) are tagged with ASID 0 whatever the
+     *  ASID of the walk that read them, as all the mappings below them are
+     *  global.
+     */
+    class TranslationCache
+    {
+        private:
+            std::string myName;
+            // Virtual address bits below the index
+            unsigned shift;
+            TranslationCacheStore store;
+            uint8_t level;
+
+            struct TranslationCacheStats
+            {
+                statistics::Scalar hit;
+                statistics::Scalar miss;
+                statistics::Scalar insert;
+                statistics::Scalar evict;
+                statistics::Scalar flush;
+                // Entries dropped by ASID or address specific fences
+                statistics::Scalar demapped;
+                statistics::Average occupancy;
+            } stats;
+
+            Addr indexOf(Addr va) const;
+        public:
+            /**
+             * @param _assoc Number of ways per set, 0 means fully
+             *  associative. Victims are the least recently used.
+             */
+            TranslationCache(std::string _name, unsigned _size,
+                    unsigned _assoc, unsigned _shift);
+
+            /** Global PTEs hit for any ASID */
+            const TranslationCacheEntry *lookup(Addr va, uint16_t asid,
+                    Addr root);
+            void insert(Addr va, uint16_t asid, Addr root, PTESv39 pte);
+            void flushAll();
+            /**
+             * SFENCE.VMA of va and asid, where 0 means any. A fence of one
+             *  ASID leaves the global entries alone.
+             */
+            void demap(Addr va, uint16_t asid);
+            std::string name() const { return myName; }
+    };
+
+    class PageStructureCache
+    {
+        public:
+            TranslationCache level2Cache;
+            TranslationCache level1Cache;
+        public:
+            PageStructureCache(std::string ownerName, unsigned level2_size,
+                    unsigned level2_assoc, unsigned level1_size,
+                    unsigned level1_assoc);
+
+            /** The cache of the PTEs of a walk level (2 or 1) */
+            TranslationCache &cacheOf(int level);
+            void flushAll();
+            void demap(Addr va, uint16_t asid);
+    };
+
+} // namespace RiscvISA
+} // namespace gem5
+
+#endif // __ARCH_RISCV_TRANSLATION_CACHE_HH__
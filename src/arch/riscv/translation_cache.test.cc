@@ -0,0 +1,143 @@
+/**
+ * 2023 Feb
+ * Shiming Li
+ * shiming.li@it.uu.se
+ *
+ * Uppsala Architecture Research Team (UART)
+ * Uppsala University
+ *
+ * SFENCE.VMA of an ASID, of an address, or of both, drops the cached
+ *  non-leaf PTEs it covers, and a fence of an ASID keeps the global ones.
+ */
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "arch/riscv/translation_cache.hh"
+#include "sim/cur_tick.hh"
+#include "sim/root.hh"
+
+using namespace gem5;
+using namespace gem5::RiscvISA;
+
+// The stats look names up through the Root, which is not linked in
+Root *Root::_root = nullptr;
+
+namespace
+{
+
+const Addr Va = 0x3f80200000;
+const Addr OtherVa = 0x40000000;
+const Addr SatpPpn = 0x80123;
+
+PTESv39
+nonLeaf(bool global)
+{
+    PTESv39 pte = 0;
+    pte.v = 1;
+    pte.ppn = 0x80456;
+    pte.g = global;
+    return pte;
+}
+
+class SfenceTest : public testing::TestWithParam<unsigned>
+{
+  protected:
+    /**
+     * The stats stay registered by their address and name, so every
+     *  test gets caches of its own, never freed
+     */
+    SfenceTest()
+        : pwc(*new PageStructureCache(unique("pwc"), 4, GetParam(), 8,
+                 GetParam()))
+    {
+        Gem5Internal::_curTickPtr = &tick;
+    }
+
+    static std::string
+    unique(const std::string &name)
+    {
+        static unsigned tests = 0;
+        return name + std::to_string(tests++);
+    }
+
+    bool
+    hit(Addr va, uint16_t asid)
+    {
+        return pwc.level1Cache.lookup(va, asid, SatpPpn) != nullptr;
+    }
+
+    Tick tick = 0;
+    PageStructureCache &pwc;
+};
+
+} // anonymous namespace
+
+/** Entries only hit for their ASID and root, global ones for any ASID */
+TEST_P(SfenceTest, Tags)
+{
+    pwc.level1Cache.insert(Va, 1, SatpPpn, nonLeaf(false));
+    pwc.level1Cache.insert(OtherVa, 1, SatpPpn, nonLeaf(true));
+
+    EXPECT_TRUE(hit(Va, 1));
+    EXPECT_FALSE(hit(Va, 2));
+    EXPECT_EQ(pwc.level1Cache.lookup(Va, 1, SatpPpn + 1), nullptr);
+    EXPECT_TRUE(hit(OtherVa, 1));
+    EXPECT_TRUE(hit(OtherVa, 2));
+}
+
+/** A fence of an ASID drops its entries, except the global ones */
+TEST_P(SfenceTest, ByAsid)
+{
+    pwc.level1Cache.insert(Va, 1, SatpPpn, nonLeaf(false));
+    pwc.level1Cache.insert(Va, 2, SatpPpn, nonLeaf(false));
+    pwc.level1Cache.insert(OtherVa, 1, SatpPpn, nonLeaf(true));
+
+    pwc.demap(0, 1);
+    EXPECT_FALSE(hit(Va, 1));
+    EXPECT_TRUE(hit(Va, 2));
+    EXPECT_TRUE(hit(OtherVa, 1));
+    EXPECT_TRUE(hit(OtherVa, 3));
+}
+
+/**
+ * A fence of an address drops its entries of any ASID, global ones
+ *  included, unless an ASID is given too
+ */
+TEST_P(SfenceTest, ByAddress)
+{
+    pwc.level1Cache.insert(Va, 1, SatpPpn, nonLeaf(false));
+    pwc.level1Cache.insert(Va, 2, SatpPpn, nonLeaf(false));
+    pwc.level1Cache.insert(OtherVa, 1, SatpPpn, nonLeaf(true));
+
+    pwc.demap(Va, 0);
+    EXPECT_FALSE(hit(Va, 1));
+    EXPECT_FALSE(hit(Va, 2));
+    EXPECT_TRUE(hit(OtherVa, 1));
+
+    pwc.level1Cache.insert(Va, 1, SatpPpn, nonLeaf(false));
+    pwc.level1Cache.insert(Va, 2, SatpPpn, nonLeaf(false));
+    pwc.demap(Va, 2);
+    EXPECT_TRUE(hit(Va, 1));
+    EXPECT_FALSE(hit(Va, 2));
+    pwc.demap(OtherVa, 1);
+    EXPECT_TRUE(hit(OtherVa, 1));
+
+    pwc.demap(OtherVa, 0);
+    EXPECT_FALSE(hit(OtherVa, 1));
+}
+
+/** A fence of an address also drops the root PTE that maps it */
+TEST_P(SfenceTest, BothLevels)
+{
+    pwc.level2Cache.insert(Va, 1, SatpPpn, nonLeaf(false));
+    pwc.level1Cache.insert(Va, 1, SatpPpn, nonLeaf(false));
+
+    pwc.demap(Va + 0x1000, 0);
+    EXPECT_EQ(pwc.level2Cache.lookup(Va, 1, SatpPpn), nullptr);
+    EXPECT_FALSE(hit(Va, 1));
+}
+
+INSTANTIATE_TEST_SUITE_P(FullyAndSetAssociative, SfenceTest,
+        testing::Values(0u, 2u));
@@ -50,28 +50,19 @@ class X86AtomicSimpleCPU(BaseAtomicSimpleCPU, X86CPU):
         super().__init__(**kwargs)
         # Shiming: So you have to say "self".mmu to make it work...
         #  or the classes's mmu is never initialized
-        self.mmu = X86MMU(enable_pwc=self.enable_pwc,
-                pwc_pml4_size=self.pwc_pml4_size,
-                pwc_pdp_size=self.pwc_pdp_size,
-                pwc_pde_size=self.pwc_pde_size)
+        self.mmu = X86MMU(**self.pwcArgs())
 
 
 class X86NonCachingSimpleCPU(BaseNonCachingSimpleCPU, X86CPU):
     def __init__(self, **kwargs):
         super().__init__(**kwargs)
-        self.mmu = X86MMU(enable_pwc=self.enable_pwc,
-                pwc_pml4_size=self.pwc_pml4_size,
-                pwc_pdp_size=self.pwc_pdp_size,
-                pwc_pde_size=self.pwc_pde_size)
+        self.mmu = X86MMU(**self.pwcArgs())
 
 
 class X86TimingSimpleCPU(BaseTimingSimpleCPU, X86CPU):
     def __init__(self, **kwargs):
         super().__init__(**kwargs)
-        self.mmu = X86MMU(enable_pwc=self.enable_pwc,
-                pwc_pml4_size=self.pwc_pml4_size,
-                pwc_pdp_size=self.pwc_pdp_size,
-                pwc_pde_size=self.pwc_pde_size)
+        self.mmu = X86MMU(**self.pwcArgs())
 
 
 class X86IntMultDiv(IntMultDiv):
@@ -105,10 +96,7 @@ class DefaultX86FUPool(FUPool):
 class X86O3CPU(BaseO3CPU, X86CPU):
     def __init__(self, **kwargs):
         super().__init__(**kwargs)
-        self.mmu = X86MMU(enable_pwc=self.enable_pwc,
-                pwc_pml4_size=self.pwc_pml4_size,
-                pwc_pdp_size=self.pwc_pdp_size,
-                pwc_pde_size=self.pwc_pde_size)
+        self.mmu = X86MMU(**self.pwcArgs())
 
     needsTSO = True
 
@@ -54,3 +54,6 @@ class X86ISA(BaseISA):
     vendor_string = Param.String(
         "HygonGenuine", "Vendor string for CPUID instruction"
     )
+    la57 = Param.Bool(
+        False, "Advertise five-level paging (CPUID.(EAX=07H):ECX.LA57)"
+    )
@@ -37,9 +37,56 @@
 
 # Shiming: To add params
 from m5.params import *
+from m5.proxy import *
+from m5.SimObject import SimObject
 
 from m5.objects.BaseMMU import BaseMMU
-from m5.objects.X86TLB import X86TLB
+from m5.objects.ClockedObject import ClockedObject
+from m5.objects.ReplacementPolicies import BaseReplacementPolicy
+from m5.objects.X86ISA import X86ISA
+from m5.objects.X86TLB import X86TLB, X86STLB
+
+
+# Shiming: split (Intel-like) per-level caches, or a single store shared by
+#  all levels
+class X86PwcOrganization(ScopedEnum):
+    vals = ["split", "unified"]
+
+
+# Shiming: how walks that end at a 2M/1G page fill the pwc levels above
+#  their leaf, see PageStructureCache::HugePageFill
+class X86PwcHugePageFill(ScopedEnum):
+    vals = ["normal", "bypass", "prioritise"]
+
+
+# Shiming: what a shared pwc holds with respect to the pwcs in front of it
+class X86PwcInclusion(ScopedEnum):
+    vals = ["non_inclusive", "inclusive", "exclusive"]
+
+
+class X86SharedPwc(ClockedObject):
+    type = "X86SharedPwc"
+    cxx_class = "gem5::X86ISA::SharedPageStructureCache"
+    cxx_header = "arch/x86/shared_pwc.hh"
+
+    size = Param.Unsigned(256, "Shared pwc size in number of entries")
+    assoc = Param.Unsigned(8, "Shared pwc associativity "
+                                    "(0 means fully associative)")
+    replacement_policy = Param.BaseReplacementPolicy(NULL,
+        "Replacement policy of the shared pwc. Exact LRU if not set")
+    latency = Param.Cycles(8, "Latency of a shared pwc access (in cycles "
+                                    "of its clock domain)")
+    inclusion = Param.X86PwcInclusion("non_inclusive",
+        "Whether the shared pwc holds all (inclusive), none (exclusive, "
+        "victims only) or any of the entries of the pwcs in front of it")
+    lookup_ports = Param.Unsigned(0, "Lookups per cycle, further probes "
+                                    "wait for a free port (0 means "
+                                    "unlimited)")
+    restore_state = Param.Bool(False, "Restore the entries from the "
+                                    "checkpoint (if any), instead of "
+                                    "starting empty. Their recency order "
+                                    "is only kept with the built-in LRU "
+                                    "(no replacement_policy)")
 
 
 class X86MMU(BaseMMU):
@@ -53,9 +100,74 @@ class X86MMU(BaseMMU):
     #  (i.e. pwc/page structure cache)
     enable_pwc = Param.Bool(False, "Use translation cache "
                                     "(aka pwc/page structure cache)")
+    pwc_pml5_size = Param.Unsigned(2, "PML5 cache size in number of entries "
+                                    "(only used with LA57)")
     pwc_pml4_size = Param.Unsigned(8, "PML4 cache size in number of entries")
     pwc_pdp_size = Param.Unsigned(16, "PDP cache size in number of entries")
     pwc_pde_size = Param.Unsigned(32, "PDE cache size in number of entries")
+    # Set-associative organization of each level. 0 keeps the level fully
+    #  associative. Sets are indexed with a hash of the vpn.
+    pwc_pml5_assoc = Param.Unsigned(0, "PML5 cache associativity "
+                                    "(0 means fully associative)")
+    pwc_pml4_assoc = Param.Unsigned(0, "PML4 cache associativity "
+                                    "(0 means fully associative)")
+    pwc_pdp_assoc = Param.Unsigned(0, "PDP cache associativity "
+                                    "(0 means fully associative)")
+    pwc_pde_assoc = Param.Unsigned(0, "PDE cache associativity "
+                                    "(0 means fully associative)")
+    pwc_replacement_policy = Param.BaseReplacementPolicy(NULL,
+        "Replacement policy of all pwc levels. Exact LRU if not set. Note "
+        "that TreePLRURP needs num_leaves equal to the associativity")
+    pwc_parallel_probe = Param.Bool(False, "Probe all pwc levels in one "
+                                    "step and use the deepest hit")
+    pwc_lookup_latency = Param.Cycles(0, "Latency of a pwc lookup (per "
+                                    "level probed, or once if parallel)")
+    pwc_organization = Param.X86PwcOrganization("split",
+        "Split per-level pwc, or a unified one where levels share capacity")
+    pwc_unified_size = Param.Unsigned(56, "Unified pwc size in number of "
+                                    "entries")
+    pwc_unified_assoc = Param.Unsigned(0, "Unified pwc associativity "
+                                    "(0 means fully associative)")
+    pwc_huge_page_fill = Param.X86PwcHugePageFill("normal",
+        "Whether walks ending at a 2M/1G page fill the pwc as 4K walks do, "
+        "not at all (bypass), or ahead of 4K walks (prioritise)")
+    pwc_lookup_ports = Param.Unsigned(0, "Pwc probes per cycle, further "
+                                    "walks wait for a free port (0 means "
+                                    "unlimited)")
+    pwc_fill_ports = Param.Unsigned(0, "Pwc fills per cycle, further "
+                                    "fills are visible once they get a "
+                                    "port (0 means unlimited)")
+    pwc_shared = Param.X86SharedPwc(NULL, "Second level pwc shared with "
+                                    "other mmus, probed on pwc misses")
+    restore_pwc_state = Param.Bool(False, "Restore the pwc entries from "
+                                    "the checkpoint (if any), instead of "
+                                    "starting with an empty pwc. Their "
+                                    "recency order is only kept with the "
+                                    "built-in LRU (no "
+                                    "pwc_replacement_policy)")
+    # Shiming: nested (2D) walks through a modeled host page table, which
+    #  maps guest physical addresses to the same host physical ones
+    nested_paging = Param.Bool(False, "Translate every guest physical "
+                                    "address of a walk through a host "
+                                    "(EPT) page table")
+    nested_tlb_size = Param.Unsigned(32, "Nested TLB size, caching guest "
+                                    "to host physical translations (0 "
+                                    "means none)")
+    nested_tlb_assoc = Param.Unsigned(0, "Nested TLB associativity "
+                                    "(0 means fully associative)")
+    host_pwc_pml4_size = Param.Unsigned(2, "Host PML4 cache size (only "
+                                    "used with enable_pwc)")
+    host_pwc_pdp_size = Param.Unsigned(4, "Host PDP cache size (only "
+                                    "used with enable_pwc)")
+    host_pwc_pde_size = Param.Unsigned(16, "Host PDE cache size (only "
+                                    "used with enable_pwc)")
+    host_table_base = Param.Addr(0, "Start of the physical memory window "
+                                    "the host page table is read from")
+    host_table_size = Param.MemorySize("16MiB", "Size of the host page "
+                                    "table window")
+    # Shiming: second level TLB behind itb and dtb
+    stlb = Param.X86STLB(NULL, "Second level TLB, probed on itb/dtb misses "
+                               "before walking")
 
     @classmethod
     def walkerPorts(cls):
@@ -64,3 +176,37 @@ class X86MMU(BaseMMU):
     def connectWalkerPorts(self, iport, dport):
         self.itb.walker.port = iport
         self.dtb.walker.port = dport
+
+
+# Shiming: replay a virtual address trace through an X86MMU, without a CPU,
+#  see arch/x86/trace_player.hh
+class X86TraceFormat(ScopedEnum):
+    # binary: little endian 64-bit virtual addresses, no header
+    # protobuf: gem5 packet trace (proto/packet.proto)
+    vals = ["binary", "protobuf"]
+
+
+class X86TranslationTracePlayer(ClockedObject):
+    type = "X86TranslationTracePlayer"
+    cxx_class = "gem5::X86ISA::TranslationTracePlayer"
+    cxx_header = "arch/x86/trace_player.hh"
+
+    system = Param.System(Parent.any, "System of the player, in full "
+                                    "system mode")
+    mmu = Param.X86MMU(X86MMU(), "MMU the trace is translated by, its "
+                                    "walker ports go to walker_ports")
+    isa = Param.X86ISA(X86ISA(), "ISA holding the paging registers")
+    walker_ports = VectorResponsePort("Page table reads and writes of "
+                                    "the walkers")
+
+    trace_file = Param.String("Virtual address trace to replay")
+    trace_format = Param.X86TraceFormat("binary", "Format of the trace")
+    protobuf_virtual_addresses = Param.Bool(False, "The protobuf trace "
+                                    "holds virtual addresses (the packet "
+                                    "traces of gem5 hold physical ones)")
+    max_accesses = Param.UInt64(0, "Stop after this many accesses (0 "
+                                    "replays the whole trace)")
+    la57 = Param.Bool(False, "Walk a 5-level page table")
+    page_size = Param.MemorySize("4KiB", "Size of all the pages of the "
+                                    "page table (4KiB, 2MiB or 1GiB)")
+    walk_read_latency = Param.Cycles(30, "Latency of a page table read")
@@ -33,11 +33,13 @@
 # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
+from m5.SimObject import SimObject
 from m5.params import *
 from m5.proxy import *
 
 from m5.objects.BaseTLB import BaseTLB
 from m5.objects.ClockedObject import ClockedObject
+from m5.objects.ReplacementPolicies import BaseReplacementPolicy
 
 
 class X86PagetableWalker(ClockedObject):
@@ -50,6 +52,31 @@ class X86PagetableWalker(ClockedObject):
     num_squash_per_cycle = Param.Unsigned(
         4, "Number of outstanding walks that can be squashed per cycle"
     )
+    # Shiming: concurrent walks
+    num_walkers = Param.Unsigned(
+        1, "Number of walks that can be in progress at the same time. "
+        "Walks of the same page are merged, and walks needing the same "
+        "entry share its read"
+    )
+    # Shiming: walk latency breakdown
+    cache_levels = Param.Unsigned(
+        3, "Number of cache levels between the walker and memory, used to "
+        "attribute page table reads to the level that served them (the "
+        "last one is reported as LLC)"
+    )
+    # Shiming: translation prefetching
+    line_fill_tlb = Param.Bool(
+        False, "Also install the other PTEs of the line read by a walk "
+        "into the TLB"
+    )
+    line_fill_pwc = Param.Bool(
+        False, "Also install the other PDEs of the line read by a walk "
+        "into the PDE cache"
+    )
+    prefetch_degree = Param.Unsigned(
+        0, "Number of strides the translation prefetcher walks ahead of "
+        "demand walks (0 disables it)"
+    )
 
 
 class X86TLB(BaseTLB):
@@ -58,7 +85,60 @@ class X86TLB(BaseTLB):
     cxx_header = "arch/x86/tlb.hh"
 
     size = Param.Unsigned(64, "TLB size")
+    # Shiming: set-associative organization, sets are indexed with a hash
+    #  of the page number
+    assoc = Param.Unsigned(0, "TLB associativity (0 means fully "
+                                "associative)")
+    replacement_policy = Param.BaseReplacementPolicy(NULL,
+        "Replacement policy of the TLB. Exact LRU if not set. Note that "
+        "TreePLRURP needs num_leaves equal to the associativity")
+    # Shiming: separate arrays for the large pages, as in recent cores
+    size_2m = Param.Unsigned(0, "Size of the 2M/4M page array (0 means "
+                                "these pages go into the main array)")
+    assoc_2m = Param.Unsigned(0, "Associativity of the 2M/4M page array")
+    size_1g = Param.Unsigned(0, "Size of the 1G page array (0 means "
+                                "these pages go into the main array)")
+    assoc_1g = Param.Unsigned(0, "Associativity of the 1G page array")
     system = Param.System(Parent.any, "system object")
     walker = Param.X86PagetableWalker(
         X86PagetableWalker(), "page table walker"
     )
+
+
+class X86STLB(ClockedObject):
+    type = "X86STLB"
+    cxx_class = "gem5::X86ISA::SecondLevelTLB"
+    cxx_header = "arch/x86/stlb.hh"
+
+    # Shiming: defaults are those of a Skylake core, 4K and 2M pages share
+    #  the main array
+    size = Param.Unsigned(1536, "STLB size")
+    assoc = Param.Unsigned(12, "STLB associativity (0 means fully "
+                                "associative)")
+    size_2m = Param.Unsigned(0, "Size of the 2M/4M page array (0 means "
+                                "these pages go into the main array)")
+    assoc_2m = Param.Unsigned(0, "Associativity of the 2M/4M page array")
+    size_1g = Param.Unsigned(16, "Size of the 1G page array (0 means "
+                                 "these pages go into the main array)")
+    assoc_1g = Param.Unsigned(4, "Associativity of the 1G page array")
+    replacement_policy = Param.BaseReplacementPolicy(NULL,
+        "Replacement policy of the STLB. Exact LRU if not set")
+    latency = Param.Cycles(8, "Latency of an STLB lookup, added to first "
+                              "level TLB misses that hit in the STLB")
+
+
+# Shiming: reuse profile of the pwc and TLB, see walk_profiler.hh
+class X86WalkProfiler(SimObject):
+    type = "X86WalkProfiler"
+    cxx_class = "gem5::X86ISA::WalkProfiler"
+    cxx_header = "arch/x86/walk_profiler.hh"
+
+    mmu = Param.X86MMU(
+        Parent.any, "MMU whose walks and TLB lookups are profiled"
+    )
+    max_distance = Param.Unsigned(
+        1024, "Largest number of entries the profile gives the hit rate of"
+    )
+    bucket_size = Param.Unsigned(
+        1, "Entries per bucket of the distance distributions"
+    )
@@ -173,8 +173,13 @@ namespace X86ISA {
                                      0xefdbfbff, 0x00000209);
                 break;
               case ExtendedFeatures:
-                result = CpuidResult(0x00000000, 0x01800000,
-                                     0x00000000, 0x00000000);
+                {
+                  ISA *isa = dynamic_cast<ISA *>(tc->getIsaPtr());
+                  // ECX bit 16 is LA57
+                  result = CpuidResult(0x00000000, 0x01800000,
+                                       isa->hasLa57() ? 0x00010000 : 0,
+                                       0x00000000);
+                }
                 break;
               default:
                 warn("x86 cpuid family 0x0000: unimplemented function %u",
@@ -149,7 +149,8 @@ RegClass vecPredRegClass(VecPredRegClass, VecPredRegClassName, 1,
 
 } // anonymous namespace
 
-ISA::ISA(const X86ISAParams &p) : BaseISA(p), vendorString(p.vendor_string)
+ISA::ISA(const X86ISAParams &p) : BaseISA(p), vendorString(p.vendor_string),
+    la57(p.la57)
 {
     fatal_if(vendorString.size() != 12,
              "CPUID vendor string must be 12 characters\n");
@@ -313,12 +314,28 @@ ISA::setMiscReg(RegIndex idx, RegVal val)
       case misc_reg::Cr2:
         break;
       case misc_reg::Cr3:
-        static_cast<MMU *>(tc->getMMUPtr())->flushNonGlobal();
+        {
+            CR4 cr4 = regVal[misc_reg::Cr4];
+            bool no_flush = false;
+            uint16_t pcid = 0;
+            if (cr4.pcide) {
+                // Bit 63 of the source keeps the cached translations of
+                // the new PCID. It is not stored in CR3.
+                no_flush = bits(val, 63);
+                newVal = mbits(val, 62, 0);
+                pcid = CR3(newVal).pcid;
+            }
+            static_cast<MMU *>(tc->getMMUPtr())->switchContext(
+                    pcid, no_flush);
+        }
         break;
       case misc_reg::Cr4:
         {
             CR4 toggled = regVal[idx] ^ val;
-            if (toggled.pae || toggled.pse || toggled.pge) {
+            // Shiming: pwc entries are tagged with the PCID while PCIDE=1
+            //  and with 000H otherwise, so PCIDE toggles flush everything.
+            if (toggled.pae || toggled.pse || toggled.pge || toggled.pcide ||
+                    toggled.la57) {
                 tc->getMMUPtr()->flushAll();
             }
         }
@@ -505,5 +522,11 @@ ISA::getVendorString() const
     return vendorString;
 }
 
+bool
+ISA::hasLa57() const
+{
+    return la57;
+}
+
 } // namespace X86ISA
 } // namespace gem5
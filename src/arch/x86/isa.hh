@@ -58,6 +58,8 @@ class ISA : public BaseISA
             SegAttr csAttr, SegAttr ssAttr, RFLAGS rflags);
 
     std::string vendorString;
+    // Five-level paging advertised by CPUID
+    bool la57;
 
   public:
     void clear() override;
@@ -93,6 +95,7 @@ class ISA : public BaseISA
     void setThreadContext(ThreadContext *_tc) override;
 
     std::string getVendorString() const;
+    bool hasLa57() const;
 };
 
 } // namespace X86ISA
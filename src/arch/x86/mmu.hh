@@ -46,6 +46,7 @@
 #include "arch/x86/pagetable_walker.hh"
 
 // Shiming: add pwc
+#include "arch/x86/shared_pwc.hh"
 #include "arch/x86/translation_cache.hh"
 #include "params/X86MMU.hh"
 
@@ -59,15 +60,45 @@ class MMU : public BaseMMU
     // Shiming: pwc related members
   public:
     PageStructureCache* pwc;
+    /** Put the checkpointed pwc entries back, instead of starting cold */
+    const bool restorePwcState;
+    /**
+     * Shiming: host dimension of nested walks, shared by both walkers.
+     *  The host pwc only exists along with the (guest) pwc. Guest TLB
+     *  flushes leave them alone, as EPT caches are only dropped by INVEPT.
+     */
+    PageStructureCache* hostPwc = nullptr;
+    NestedTlb* nestedTlb = nullptr;
   public:
     // Shiming: construct pwc
     MMU(const X86MMUParams &p)
-      : BaseMMU(p)
+      : BaseMMU(p), restorePwcState(p.restore_pwc_state)
     {
+      if (p.stlb) {
+        static_cast<TLB*>(itb)->setStlb(p.stlb);
+        static_cast<TLB*>(dtb)->setStlb(p.stlb);
+      }
       enablePwc = p.enable_pwc;
       if (enablePwc) {
-        pwc = new PageStructureCache(name(), p.pwc_pml4_size,
-            p.pwc_pdp_size, p.pwc_pde_size);
+        pwc = new PageStructureCache(name(),
+            p.pwc_pml5_size, p.pwc_pml5_assoc,
+            p.pwc_pml4_size, p.pwc_pml4_assoc,
+            p.pwc_pdp_size, p.pwc_pdp_assoc,
+            p.pwc_pde_size, p.pwc_pde_assoc,
+            p.pwc_replacement_policy,
+            p.pwc_parallel_probe, p.pwc_lookup_latency,
+            p.pwc_organization == X86PwcOrganization::unified ?
+                PageStructureCache::UNIFIED : PageStructureCache::SPLIT,
+            p.pwc_unified_size, p.pwc_unified_assoc);
+        // The values of X86PwcHugePageFill are in the same order
+        pwc->setHugePageFill(static_cast<PageStructureCache::HugePageFill>(
+            p.pwc_huge_page_fill));
+        // Both walkers are in the clock domain of the cpu
+        pwc->setPorts(p.pwc_lookup_ports, p.pwc_fill_ports,
+            static_cast<TLB*>(dtb)->getWalker());
+        if (p.pwc_shared) {
+            pwc->setNextLevel(&p.pwc_shared->pwc, p.pwc_shared->inclusion);
+        }
 
         static_cast<TLB*>(dtb)->getWalker()->setEnablePwc();
         static_cast<TLB*>(dtb)->getWalker()->setPwc(pwc);
@@ -76,6 +107,23 @@ class MMU : public BaseMMU
       } else {
         pwc = nullptr;
       }
+
+      if (p.nested_paging) {
+        if (enablePwc) {
+          // The host table has 4 levels, its PML5 cache stays empty
+          hostPwc = new PageStructureCache(name() + ".host", 1, 0,
+              p.host_pwc_pml4_size, 0, p.host_pwc_pdp_size, 0,
+              p.host_pwc_pde_size, 0);
+        }
+        if (p.nested_tlb_size) {
+          nestedTlb = new NestedTlb(name() + ".nestedTlb",
+              p.nested_tlb_size, p.nested_tlb_assoc, nullptr);
+        }
+        for (BaseTLB *tlb : {itb, dtb}) {
+          static_cast<TLB*>(tlb)->getWalker()->setNested(hostPwc, nestedTlb,
+              p.host_table_base, p.host_table_size);
+        }
+      }
     }
 
     // Shiming: delete pwc
@@ -83,6 +131,8 @@ class MMU : public BaseMMU
       if (enablePwc) {
         delete pwc;
       }
+      delete hostPwc;
+      delete nestedTlb;
     }
 
     // Shiming:
@@ -95,6 +145,44 @@ class MMU : public BaseMMU
       }
     }
 
+    /**
+     * Shiming: INVLPG and page faults. The pwc is shared by both TLBs, so
+     *  it is demapped here rather than by each TLB.
+     */
+    void
+    demapPage(Addr vaddr, uint64_t asn) override
+    {
+      BaseMMU::demapPage(vaddr, asn);
+      if (enablePwc) {
+        assert(pwc);
+        pwc->demap(vaddr);
+      }
+    }
+
+    /**
+     * Shiming: the pwc is checkpointed in a "pwc" subsection of the MMU.
+     *  Restoring it is optional, and checkpoints without one (older ones,
+     *  or taken without a pwc) leave the pwc cold.
+     */
+    void
+    serialize(CheckpointOut &cp) const override
+    {
+      if (enablePwc) {
+        ScopedCheckpointSection sec(cp, "pwc");
+        pwc->serialize(cp);
+      }
+    }
+
+    void
+    unserialize(CheckpointIn &cp) override
+    {
+      if (enablePwc && restorePwcState &&
+          cp.sectionExists(Serializable::currentSection() + ".pwc")) {
+        ScopedCheckpointSection sec(cp, "pwc");
+        pwc->unserialize(cp);
+      }
+    }
+
     void
     flushNonGlobal()
     {
@@ -104,6 +192,25 @@ class MMU : public BaseMMU
         if (enablePwc) { flushPwc(); }
     }
 
+    /**
+     * Shiming: MOV to CR3. The TLBs still drop all non-global entries, but
+     *  the pwc only drops the entries of the new PCID, and none if bit 63
+     *  of the source was set with CR4.PCIDE=1 ("TLBs, Paging-Structure
+     *  Caches, and Their Invalidation" 5.1). With PCIDE=0 every pwc entry
+     *  has PCID 000H, so this is still a full pwc flush. Only this core's
+     *  pwc is flushed: a shared pwc keeps the entries other cores use.
+     */
+    void
+    switchContext(uint16_t pcid, bool no_flush)
+    {
+        static_cast<TLB*>(itb)->flushNonGlobal();
+        static_cast<TLB*>(dtb)->flushNonGlobal();
+        if (enablePwc && !no_flush) {
+            assert(pwc);
+            pwc->flushPcid(pcid);
+        }
+    }
+
     Walker*
     getDataWalker()
     {
@@ -90,6 +90,9 @@ namespace X86ISA
         bool noExec;
         // A sequence number to keep track of LRU.
         uint64_t lruSeq;
+        // Shiming: installed by a translation prefetch and not used yet.
+        //  Not checkpointed.
+        bool prefetched;
 
         TlbEntryTrie::Handle trieHandle;
 
@@ -124,6 +127,7 @@ namespace X86ISA
         Bitfield<29, 21> longl2;
         Bitfield<38, 30> longl3;
         Bitfield<47, 39> longl4;
+        Bitfield<56, 48> longl5;
 
         Bitfield<20, 12> pael1;
         Bitfield<29, 21> pael2;
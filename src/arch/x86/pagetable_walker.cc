@@ -49,19 +49,24 @@
 
 #include "arch/x86/pagetable_walker.hh"
 
+#include <algorithm>
+#include <cstring>
 #include <memory>
+#include <vector>
 
 #include "arch/x86/faults.hh"
 #include "arch/x86/pagetable.hh"
 #include "arch/x86/regs/misc.hh"
 #include "arch/x86/tlb.hh"
 #include "base/bitfield.hh"
+#include "base/cprintf.hh"
 #include "base/trie.hh"
 #include "cpu/base.hh"
 #include "cpu/thread_context.hh"
 #include "debug/PageTableWalker.hh"
 #include "mem/packet_access.hh"
 #include "mem/request.hh"
+#include "sim/byteswap.hh"
 
 namespace gem5
 {
@@ -72,27 +77,400 @@ Fault
 Walker::start(ThreadContext * _tc, BaseMMU::Translation *_translation,
               const RequestPtr &_req, BaseMMU::Mode _mode)
 {
-    // TODO: in timing mode, instead of blocking when there are other
-    // outstanding requests, see if this request can be coalesced with
-    // another one (i.e. either coalesce or start walk)
     WalkerState * newState = new WalkerState(this, _translation, _req);
     newState->initState(_tc, _mode, sys->isTimingMode());
     if (currStates.size()) {
         assert(newState->isTiming());
         DPRINTF(PageTableWalker, "Walks in progress: %d\n", currStates.size());
-        currStates.push_back(newState);
+        sampleOccupancy();
+        // Shiming: wait for a walk of the same page instead of walking
+        WalkerState *primary = findPrimary(newState);
+        if (primary) {
+            DPRINTF(PageTableWalker, "Coalescing walk for %#x\n",
+                    _req->getVaddr());
+            primary->secondaries.push_back(newState);
+            stats.coalescedWalks++;
+            return NoFault;
+        }
+        enqueue(newState);
+        if (prefetchDegree) {
+            trainPrefetcher(_tc, _req->getVaddr());
+        }
         return NoFault;
     } else {
+        if (newState->isTiming()) {
+            sampleOccupancy();
+        }
         currStates.push_back(newState);
         Fault fault = newState->startWalk();
         if (!newState->isTiming()) {
             currStates.pop_front();
             delete newState;
+        } else if (prefetchDegree) {
+            trainPrefetcher(_tc, _req->getVaddr());
         }
         return fault;
     }
 }
 
+void
+Walker::enqueue(WalkerState *state)
+{
+    if (state->isPrefetch()) {
+        currStates.push_back(state);
+    } else {
+        currStates.insert(demandQueuePos(), state);
+    }
+    // Unless older walks are about to be started
+    if (numBusy() < numWalkers && !startWalkWrapperEvent.scheduled()) {
+        state->startWalk();
+    }
+}
+
+unsigned
+Walker::numBusy() const
+{
+    unsigned busy = 0;
+    for (const WalkerState *state : currStates) {
+        busy += state->started;
+    }
+    return busy;
+}
+
+void
+Walker::sampleOccupancy()
+{
+    Cycles now = curCycle();
+    if (now > occupancyCycle) {
+        unsigned busy = numBusy();
+        stats.busyWalkers.sample(busy, now - occupancyCycle);
+        stats.queuedWalks.sample(currStates.size() - busy,
+                now - occupancyCycle);
+    }
+    occupancyCycle = now;
+}
+
+Walker::WalkerState *
+Walker::findPrimary(const WalkerState *state)
+{
+    Addr vpn = state->req->getVaddr() >> PageShift;
+    for (WalkerState *other : currStates) {
+        // Unstarted prefetches would make it wait behind demand walks
+        if (other->tc == state->tc && !other->squashed
+                && (other->started || !other->isPrefetch())
+                && (other->req->getVaddr() >> PageShift) == vpn) {
+            return other;
+        }
+    }
+    return nullptr;
+}
+
+Walker::WalkerState *
+Walker::findInflightRead(const WalkerState *state, Addr addr,
+        PageWalkState level)
+{
+    for (WalkerState *other : currStates) {
+        if (other != state && other->readInflight && !other->squashed
+                && other->inflightAddr == addr
+                && other->inflightState == level) {
+            return other;
+        }
+    }
+    return nullptr;
+}
+
+void
+Walker::finishSecondary(WalkerState *state)
+{
+    if (state->translation->squashed()) {
+        state->translation->finish(
+            std::make_shared<UnimpFault>("Squashed Inst"),
+            state->req, state->tc, state->mode);
+        delete state;
+        return;
+    }
+
+    CR3 cr3 = state->tc->readMiscRegNoEffect(misc_reg::Cr3);
+    CR4 cr4 = state->tc->readMiscRegNoEffect(misc_reg::Cr4);
+    uint64_t pcid = cr4.pcide ? (uint64_t)cr3.pcid : 0x000;
+    Addr page = state->req->getVaddr() & ~mask(PageShift);
+    if (tlb->cached(tlb->concAddrPcid(page, pcid))) {
+        // Same as the end of a walk, the STLB fills the TLB if needed
+        bool delayedResponse;
+        Fault fault = tlb->translate(state->req, state->tc, NULL,
+                state->mode, delayedResponse, true);
+        assert(!delayedResponse);
+        state->translation->finish(fault, state->req, state->tc,
+                state->mode);
+        delete state;
+    } else {
+        // The walk faulted (or was dropped), walk again to get the fault
+        //  of this access
+        DPRINTF(PageTableWalker, "Walking again for %#x\n",
+                state->req->getVaddr());
+        stats.coalescedRewalks++;
+        enqueue(state);
+    }
+}
+
+std::list<Walker::WalkerState *>::iterator
+Walker::demandQueuePos()
+{
+    for (auto it = currStates.begin(); it != currStates.end(); it++) {
+        if ((*it)->isPrefetch() && !(*it)->wasStarted()) {
+            return it;
+        }
+    }
+    return currStates.end();
+}
+
+void
+Walker::trainPrefetcher(ThreadContext *tc, Addr vaddr)
+{
+    Addr vpn = vaddr >> PageShift;
+    int64_t stride = vpn - pfLastVpn;
+    if (stride != 0 && stride == pfLastStride) {
+        pfConfidence++;
+    } else {
+        pfConfidence = 0;
+    }
+    pfLastVpn = vpn;
+    pfLastStride = stride;
+    // Only prefetch once the same stride was seen twice in a row
+    if (pfConfidence == 0) {
+        return;
+    }
+
+    CR3 cr3 = tc->readMiscRegNoEffect(misc_reg::Cr3);
+    CR4 cr4 = tc->readMiscRegNoEffect(misc_reg::Cr4);
+    uint64_t pcid = cr4.pcide ? (uint64_t)cr3.pcid : 0x000;
+    for (unsigned k = 1; k <= prefetchDegree; k++) {
+        Addr pf_vaddr = (vpn + stride * k) << PageShift;
+        // Do not walk for non canonical addresses
+        if (cr4.la57 ? (Addr)sext<57>(pf_vaddr) != pf_vaddr
+                     : (Addr)sext<48>(pf_vaddr) != pf_vaddr) {
+            break;
+        }
+        if (tlb->cached(tlb->concAddrPcid(pf_vaddr, pcid))) {
+            continue;
+        }
+        unsigned queued = 0;
+        bool already = false;
+        for (WalkerState *state : currStates) {
+            queued += state->isPrefetch();
+            already |= (state->req->getVaddr() >> PageShift)
+                == (pf_vaddr >> PageShift);
+        }
+        if (already) {
+            continue;
+        }
+        if (queued >= prefetchDegree) {
+            stats.prefetchDropped++;
+            break;
+        }
+        startPrefetch(tc, pf_vaddr);
+    }
+}
+
+void
+Walker::startPrefetch(ThreadContext *tc, Addr vaddr)
+{
+    DPRINTF(PageTableWalker, "Prefetching translation of %#x\n", vaddr);
+    RequestPtr req = std::make_shared<Request>(
+        vaddr, 1, 0, requestorId, 0, tc->contextId());
+    WalkerState *newState =
+        new WalkerState(this, &prefetchTranslation, req, false, true);
+    newState->initState(tc, BaseMMU::Read, true);
+    // There is always a demand walk ahead, it starts the queue when done
+    assert(!currStates.empty());
+    enqueue(newState);
+    stats.prefetches++;
+}
+
+void
+Walker::readLine(Addr line_addr, uint8_t *data)
+{
+    RequestPtr request = std::make_shared<Request>(
+        line_addr, sys->cacheLineSize(), Request::PHYSICAL, requestorId);
+    Packet pkt(request, MemCmd::ReadReq);
+    pkt.dataStatic(data);
+    port.sendFunctional(&pkt);
+}
+
+Walker::WalkLevel
+Walker::walkLevel(PageWalkState state)
+{
+    switch (state) {
+      case LongPML5:
+        return PML5Level;
+      case LongPML4:
+        return PML4Level;
+      case LongPDP:
+      case PAEPDP:
+        return PDPLevel;
+      case LongPD:
+      case PAEPD:
+      case PSEPD:
+      case PD:
+        return PDLevel;
+      case LongPTE:
+      case PAEPTE:
+      case PTE:
+        return PTLevel;
+      default:
+        panic("No page table level for walk state %d", state);
+    }
+}
+
+void
+Walker::recordRead(PageWalkState state, Cycles lat, PacketPtr pkt)
+{
+    WalkLevel level = walkLevel(state);
+    stats.levelReads[level]++;
+    stats.levelReadCycles[level] += lat;
+    // Each cache that missed on the way deepened the access
+    unsigned served = std::min<unsigned>(pkt->req->getAccessDepth(),
+            cacheLevels);
+    stats.levelReadServedBy[level][served]++;
+}
+
+Walker::WalkerStats::WalkerStats(statistics::Group *parent,
+        unsigned cache_levels)
+  : statistics::Group(parent),
+    ADD_STAT(lineFillTlb, statistics::units::Count::get(),
+             "PTEs installed into the TLB from the line of a walk"),
+    ADD_STAT(lineFillPwc, statistics::units::Count::get(),
+             "PDEs installed into the pwc from the line of a walk"),
+    ADD_STAT(prefetches, statistics::units::Count::get(),
+             "Translation prefetch walks issued"),
+    ADD_STAT(prefetchFaults, statistics::units::Count::get(),
+             "Translation prefetch walks that faulted (and were dropped)"),
+    ADD_STAT(prefetchDropped, statistics::units::Count::get(),
+             "Translation prefetches not issued because too many are "
+             "queued"),
+    ADD_STAT(coalescedWalks, statistics::units::Count::get(),
+             "Walks that waited for a walk of the same page"),
+    ADD_STAT(coalescedRewalks, statistics::units::Count::get(),
+             "Coalesced walks that walked again, as the walk they waited "
+             "for faulted"),
+    ADD_STAT(sharedReads, statistics::units::Count::get(),
+             "Page table reads that waited for the same read of another "
+             "walk"),
+    ADD_STAT(busyWalkers, statistics::units::Count::get(),
+             "Walks in progress, in cycles"),
+    ADD_STAT(queuedWalks, statistics::units::Count::get(),
+             "Walks waiting for a walker, in cycles"),
+    ADD_STAT(walkLatency, statistics::units::Cycle::get(),
+             "Latency of demand walks"),
+    ADD_STAT(walkReads, statistics::units::Count::get(),
+             "Page table reads (guest and host) per demand walk"),
+    ADD_STAT(levelReads, statistics::units::Count::get(),
+             "Page table reads per page table level"),
+    ADD_STAT(levelReadCycles, statistics::units::Cycle::get(),
+             "Cycles spent on page table reads per page table level"),
+    ADD_STAT(levelReadAvgCycles, statistics::units::Rate<
+                statistics::units::Cycle, statistics::units::Count>::get(),
+             "Average latency of a page table read per page table level"),
+    ADD_STAT(levelReadServedBy, statistics::units::Count::get(),
+             "Page table reads per page table level and per level of the "
+             "memory hierarchy that served them"),
+    ADD_STAT(pwcHitLevel, statistics::units::Count::get(),
+             "Walks per deepest pwc hit (the level of the cached entry)"),
+    ADD_STAT(sizeWalks, statistics::units::Count::get(),
+             "Demand walks per page size of the translation"),
+    ADD_STAT(sizeWalkCycles, statistics::units::Cycle::get(),
+             "Cycles of demand walks per page size of the translation"),
+    ADD_STAT(sizeWalkAvgCycles, statistics::units::Rate<
+                statistics::units::Cycle, statistics::units::Count>::get(),
+             "Average latency of a demand walk per page size"),
+    ADD_STAT(sizePwcHits, statistics::units::Count::get(),
+             "Demand walks that hit in the pwc per page size"),
+    ADD_STAT(hugePwcFillsBypassed, statistics::units::Count::get(),
+             "Pwc fills dropped as the walk ended at a huge page"),
+    ADD_STAT(pwcFillsDemoted, statistics::units::Count::get(),
+             "Pwc fills of 4K walks put in as the next victim"),
+    ADD_STAT(pwcFillsDropped, statistics::units::Count::get(),
+             "Pwc fills dropped as the pwc was flushed or demapped since "
+             "the walk read the entry"),
+    ADD_STAT(hostWalks, statistics::units::Count::get(),
+             "Host walks of nested walks (nested TLB misses)"),
+    ADD_STAT(hostReads, statistics::units::Count::get(),
+             "Host page table reads per host level"),
+    ADD_STAT(hostReadCycles, statistics::units::Cycle::get(),
+             "Cycles spent on host page table reads per host level"),
+    ADD_STAT(hostReadAvgCycles, statistics::units::Rate<
+                statistics::units::Cycle, statistics::units::Count>::get(),
+             "Average latency of a host page table read per host level"),
+    ADD_STAT(hostPwcHitLevel, statistics::units::Count::get(),
+             "Host walks per deepest host pwc hit")
+{
+    busyWalkers.init(8);
+    queuedWalks.init(16);
+
+    walkLatency
+        .init(16)
+        .flags(statistics::pdf | statistics::nozero | statistics::nonan);
+    walkReads
+        .init(6)
+        .flags(statistics::pdf | statistics::nozero | statistics::nonan);
+
+    const char *level_names[] = {"PML5", "PML4", "PDP", "PD", "PT"};
+    levelReads.init(NumWalkLevels);
+    levelReadCycles.init(NumWalkLevels);
+    levelReadServedBy
+        .init(NumWalkLevels, cache_levels + 1)
+        .flags(statistics::total);
+    for (int i = 0; i < NumWalkLevels; i++) {
+        levelReads.subname(i, level_names[i]);
+        levelReadCycles.subname(i, level_names[i]);
+        levelReadServedBy.subname(i, level_names[i]);
+    }
+    levelReadAvgCycles = levelReadCycles / levelReads;
+    for (unsigned i = 0; i < cache_levels; i++) {
+        levelReadServedBy.ysubname(i, i + 1 == cache_levels ?
+                std::string("LLC") : csprintf("L%d", i + 1));
+    }
+    levelReadServedBy.ysubname(cache_levels, "mem");
+
+    pwcHitLevel
+        .init(NumWalkLevels)
+        .flags(statistics::total | statistics::pdf);
+    pwcHitLevel.subname(0, "miss");
+    pwcHitLevel.subname(PML5Level + 1, "PML5");
+    pwcHitLevel.subname(PML4Level + 1, "PML4");
+    pwcHitLevel.subname(PDPLevel + 1, "PDP");
+    pwcHitLevel.subname(PDLevel + 1, "PD");
+
+    const char *size_names[] = {"4K", "2M", "1G"};
+    sizeWalks.init(3);
+    sizeWalkCycles.init(3);
+    sizePwcHits.init(3);
+    for (int i = 0; i < 3; i++) {
+        sizeWalks.subname(i, size_names[i]);
+        sizeWalkCycles.subname(i, size_names[i]);
+        sizePwcHits.subname(i, size_names[i]);
+    }
+    sizeWalkAvgCycles = sizeWalkCycles / sizeWalks;
+
+    const char *host_level_names[] = {"PML4", "PDP", "PD", "PT"};
+    hostReads.init(NumHostLevels);
+    hostReadCycles.init(NumHostLevels);
+    for (int i = 0; i < NumHostLevels; i++) {
+        hostReads.subname(i, host_level_names[i]);
+        hostReadCycles.subname(i, host_level_names[i]);
+    }
+    hostReadAvgCycles = hostReadCycles / hostReads;
+
+    // Indexed by the host level read first
+    hostPwcHitLevel
+        .init(NumHostLevels)
+        .flags(statistics::total | statistics::pdf);
+    hostPwcHitLevel.subname(0, "miss");
+    for (int i = 1; i < NumHostLevels; i++) {
+        hostPwcHitLevel.subname(i, host_level_names[i - 1]);
+    }
+}
+
 Fault
 Walker::startFunctional(ThreadContext * _tc, Addr &addr, unsigned &logBytes,
               BaseMMU::Mode _mode)
@@ -113,18 +491,38 @@ Walker::recvTimingResp(PacketPtr pkt)
     WalkerSenderState * senderState =
         dynamic_cast<WalkerSenderState *>(pkt->popSenderState());
     WalkerState * senderWalk = senderState->senderWalk;
-    bool walkComplete = senderWalk->recvPacket(pkt);
     delete senderState;
+    if (pkt->isRead() && pkt != senderWalk->hostInflight) {
+        recordRead(senderWalk->inflightState,
+                ticksToCycles(curTick() - senderWalk->readSendTick), pkt);
+        // Shiming: the walks waiting for this entry get it too
+        senderWalk->readInflight = false;
+        std::vector<WalkerState *> waiters;
+        waiters.swap(senderWalk->levelWaiters);
+        for (WalkerState *waiter : waiters) {
+            PacketPtr shared = waiter->sharedRead;
+            waiter->sharedRead = NULL;
+            shared->setData(pkt->getConstPtr<uint8_t>());
+            shared->makeResponse();
+            walkResponse(waiter, shared);
+        }
+    }
+    walkResponse(senderWalk, pkt);
+    return true;
+}
+
+void
+Walker::walkResponse(WalkerState *state, PacketPtr pkt)
+{
+    bool walkComplete = state->recvPacket(pkt);
     if (walkComplete) {
-        std::list<WalkerState *>::iterator iter;
-        for (iter = currStates.begin(); iter != currStates.end(); iter++) {
-            WalkerState * walkerState = *(iter);
-            if (walkerState == senderWalk) {
-                iter = currStates.erase(iter);
-                break;
-            }
+        sampleOccupancy();
+        currStates.remove(state);
+        // Shiming: the walks of the same page can finish now
+        for (WalkerState *secondary : state->secondaries) {
+            finishSecondary(secondary);
         }
-        delete senderWalk;
+        delete state;
         // Since we block requests when another is outstanding, we
         // need to check if there is a waiting request to be serviced
         if (currStates.size() && !startWalkWrapperEvent.scheduled())
@@ -132,7 +530,6 @@ Walker::recvTimingResp(PacketPtr pkt)
             // with the responses
             schedule(startWalkWrapperEvent, clockEdge());
     }
-    return true;
 }
 
 void
@@ -178,6 +575,12 @@ Walker::getPort(const std::string &if_name, PortID idx)
         return ClockedObject::getPort(if_name, idx);
 }
 
+void
+Walker::regProbePoints()
+{
+    ppWalk = new ProbePointArg<WalkProbeInfo>(getProbeManager(), "Walk");
+}
+
 // Shiming: pwc-related
 // @{
 void
@@ -191,6 +594,30 @@ Walker::setPwc(PageStructureCache* pwcPtr) {
 }
 // @}
 
+void
+Walker::setNested(PageStructureCache *host_pwc, NestedTlb *nested_tlb,
+        Addr table_base, Addr table_size)
+{
+    fatal_if(table_size < NumHostLevels * PageBytes,
+            "%s: the host table window must hold a page per host level",
+            name());
+    nested = true;
+    hostPwc = host_pwc;
+    nestedTlb = nested_tlb;
+    hostTableBase = table_base;
+    hostTableSize = table_size;
+}
+
+Addr
+Walker::hostEntryAddr(unsigned level, Addr gpa) const
+{
+    // Each level gets a part of the window, the PML4 table first
+    static const unsigned shifts[NumHostLevels] = {39, 30, 21, 12};
+    Addr part = hostTableSize / NumHostLevels;
+    return hostTableBase + level * part +
+        ((gpa >> shifts[level]) * sizeof(uint64_t)) % part;
+}
+
 void
 Walker::WalkerState::initState(ThreadContext * _tc,
         BaseMMU::Mode _mode, bool _isTiming)
@@ -205,38 +632,47 @@ Walker::WalkerState::initState(ThreadContext * _tc,
 void
 Walker::startWalkWrapper()
 {
+    sampleOccupancy();
     unsigned num_squashed = 0;
-    WalkerState *currState = currStates.front();
-    while ((num_squashed < numSquashable) && currState &&
-        currState->translation->squashed()) {
-        currStates.pop_front();
-        num_squashed++;
+    auto iter = currStates.begin();
+    while (iter != currStates.end() && numBusy() < numWalkers) {
+        WalkerState *currState = *iter;
+        if (currState->wasStarted()) {
+            iter++;
+            continue;
+        }
+        if (num_squashed < numSquashable &&
+                currState->translation->squashed()) {
+            iter = currStates.erase(iter);
+            num_squashed++;
 
-        DPRINTF(PageTableWalker, "Squashing table walk for address %#x\n",
-            currState->req->getVaddr());
+            DPRINTF(PageTableWalker, "Squashing table walk for address "
+                "%#x\n", currState->req->getVaddr());
 
-        // finish the translation which will delete the translation object
-        currState->translation->finish(
-            std::make_shared<UnimpFault>("Squashed Inst"),
-            currState->req, currState->tc, currState->mode);
+            // finish the translation which will delete the translation
+            // object
+            currState->translation->finish(
+                std::make_shared<UnimpFault>("Squashed Inst"),
+                currState->req, currState->tc, currState->mode);
 
-        // delete the current request if there are no inflight packets.
-        // if there is something in flight, delete when the packets are
-        // received and inflight is zero.
-        if (currState->numInflight() == 0) {
-            delete currState;
-        } else {
-            currState->squash();
-        }
+            // Shiming: the walks that waited for it go on their own
+            for (WalkerState *secondary : currState->secondaries) {
+                finishSecondary(secondary);
+            }
 
-        // check the next translation request, if it exists
-        if (currStates.size())
-            currState = currStates.front();
-        else
-            currState = NULL;
-    }
-    if (currState && !currState->wasStarted())
+            // delete the current request if there are no inflight packets.
+            // if there is something in flight, delete when the packets are
+            // received and inflight is zero.
+            if (currState->numInflight() == 0) {
+                delete currState;
+            } else {
+                currState->squash();
+            }
+            continue;
+        }
         currState->startWalk();
+        iter++;
+    }
 }
 
 Fault
@@ -249,15 +685,30 @@ Walker::WalkerState::startWalk()
 
     // Shiming: Profile start time
     startTick = curTick();
+    numReads = 0;
 
     setupWalk(req->getVaddr());
+    if (!prefetch) {
+        walker->ppWalk->notify({req->getVaddr(), pwcPcid});
+    }
+    hostDone = false;
     if (timing) {
         nextState = state;
         state = Waiting;
         timingFault = NoFault;
-        sendPackets();
+        if (pwcLookupLat > 0) {
+            // Shiming: the first read waits for the pwc lookup
+            walker->schedule(new EventFunctionWrapper(
+                    [this]{ sendPackets(); }, name() + ".pwcLookup", true),
+                walker->clockEdge(pwcLookupLat));
+        } else {
+            sendPackets();
+        }
     } else {
         do {
+            if (walker->nested) {
+                hostWalkAtomic(read->getAddr());
+            }
             walker->port.sendAtomic(read);
             PacketPtr write = NULL;
             fault = stepWalk(write);
@@ -267,6 +718,9 @@ Walker::WalkerState::startWalk()
             if (write)
                 walker->port.sendAtomic(write);
         } while (read);
+        if (walker->nested && fault == NoFault) {
+            hostWalkAtomic(entry.paddr);
+        }
         state = Ready;
         nextState = Waiting;
     }
@@ -315,6 +769,9 @@ Walker::WalkerState::stepWalk(PacketPtr &write)
     bool doTLBInsert = false;
     bool doEndWalk = false;
     bool badNX = pte.nx && mode == BaseMMU::Execute && enableNX;
+    // Shiming: permissions of the upper levels, for line-filled PTEs
+    bool parentWritable = entry.writable;
+    bool parentUser = entry.user;
 
     // Shiming: in pwc verification mode
     if (walker->enablePwc && !functional && walker->pwcVerifMode
@@ -327,6 +784,25 @@ Walker::WalkerState::stepWalk(PacketPtr &write)
     }
 
     switch(state) {
+      case LongPML5:
+        // Shiming: same as LongPML4, one level up (LA57)
+        DPRINTF(PageTableWalker, "Got long mode PML5 entry %#016x.\n", pte);
+        nextRead = mbits(pte, 51, 12) + vaddr.longl4 * dataSize;
+        doWrite = !pte.a;
+        pte.a = 1;
+        entry.writable = entry.writable && pte.w;
+        entry.user = entry.user && pte.u;
+        if (badNX || !pte.p) {
+            doEndWalk = true;
+            fault = pageFault(pte.p);
+            break;
+        }
+        entry.noExec = entry.noExec || pte.nx;
+        nextState = LongPML4;
+        if (walker->enablePwc && !functional && !skipPwcCaching && !doWrite) {
+            fillPwc(&walker->pwc->pml5Cache, vaddr, pte);
+        }
+        break;
       case LongPML4:
         /** Shiming:
          * cache a pw step if:
@@ -342,18 +818,18 @@ Walker::WalkerState::stepWalk(PacketPtr &write)
         nextRead = mbits(pte, 51, 12) + vaddr.longl3 * dataSize;
         doWrite = !pte.a;
         pte.a = 1;
-        entry.writable = pte.w;
-        entry.user = pte.u;
+        entry.writable = entry.writable && pte.w;
+        entry.user = entry.user && pte.u;
         if (badNX || !pte.p) {
             doEndWalk = true;
             fault = pageFault(pte.p);
             break;
         }
-        entry.noExec = pte.nx;
+        entry.noExec = entry.noExec || pte.nx;
         nextState = LongPDP;
         // Shiming: Cache this step
         if (walker->enablePwc && !functional && !skipPwcCaching && !doWrite) {
-            walker->pwc->pml4Cache.insert(vaddr, pte);
+            fillPwc(&walker->pwc->pml4Cache, vaddr, pte);
         }
         break;
       case LongPDP:
@@ -368,10 +844,23 @@ Walker::WalkerState::stepWalk(PacketPtr &write)
             fault = pageFault(pte.p);
             break;
         }
+        if (pte.ps) {
+            // Shiming: 1 GB page
+            DPRINTF(PageTableWalker, "1GB page\n");
+            entry.logBytes = 30;
+            entry.paddr = mbits(pte, 51, 30);
+            entry.uncacheable = uncacheable;
+            entry.global = pte.g;
+            entry.patBit = bits(pte, 12);
+            entry.vaddr = mbits(entry.vaddr, 63, 30);
+            doTLBInsert = true;
+            doEndWalk = true;
+            break;
+        }
         nextState = LongPD;
         // Shiming: Cache this step
         if (walker->enablePwc && !functional && !skipPwcCaching && !doWrite) {
-            walker->pwc->pdpCache.insert(vaddr, pte);
+            fillPwc(&walker->pwc->pdpCache, vaddr, pte);
         }
         break;
       case LongPD:
@@ -393,7 +882,12 @@ Walker::WalkerState::stepWalk(PacketPtr &write)
             // Shiming: Cache this step
             if (walker->enablePwc && !functional && !skipPwcCaching
                     && !doWrite) {
-                walker->pwc->pdeCache.insert(vaddr, pte);
+                // The walk ends at a 4K page, so the held fills can go in
+                fillPwc(&walker->pwc->pdeCache, vaddr, pte);
+                commitPwcFills(12);
+                if (walker->lineFillPwcEnabled) {
+                    lineFillPwc(BaseTranslationCache::LegacyAcc::NONE);
+                }
             }
             break;
         } else {
@@ -444,7 +938,7 @@ Walker::WalkerState::stepWalk(PacketPtr &write)
         }
         nextState = PAEPD;
         if (walker->enablePwc && !functional && !skipPwcCaching && !doWrite) {
-            walker->pwc->pdpCache.insert(vaddr, pte,
+            fillPwc(&walker->pwc->pdpCache, vaddr, pte,
                     BaseTranslationCache::LegacyAcc::LEGACY_32b_PAE);
         }
         break;
@@ -472,8 +966,13 @@ Walker::WalkerState::stepWalk(PacketPtr &write)
             // Shiming: Cache this step
             if (walker->enablePwc && !functional && !skipPwcCaching
                     && !doWrite) {
-                walker->pwc->pdeCache.insert(vaddr, pte,
+                fillPwc(&walker->pwc->pdeCache, vaddr, pte,
                         BaseTranslationCache::LegacyAcc::LEGACY_32b_PAE);
+                commitPwcFills(12);
+                if (walker->lineFillPwcEnabled) {
+                    lineFillPwc(
+                        BaseTranslationCache::LegacyAcc::LEGACY_32b_PAE);
+                }
             }
             break;
         } else {
@@ -532,8 +1031,9 @@ Walker::WalkerState::stepWalk(PacketPtr &write)
             // Shiming: Cache this step
             if (walker->enablePwc && !functional && !skipPwcCaching
                     && !doWrite) {
-                walker->pwc->pdeCache.insert(vaddr, pte,
+                fillPwc(&walker->pwc->pdeCache, vaddr, pte,
                         BaseTranslationCache::LegacyAcc::LEGACY_32b_NO_PAE);
+                commitPwcFills(12);
             }
             break;
         } else {
@@ -570,8 +1070,9 @@ Walker::WalkerState::stepWalk(PacketPtr &write)
         nextState = PTE;
         // Shiming: Cache this step
         if (walker->enablePwc && !functional && !skipPwcCaching && !doWrite) {
-            walker->pwc->pdeCache.insert(vaddr, pte,
+            fillPwc(&walker->pwc->pdeCache, vaddr, pte,
                     BaseTranslationCache::LegacyAcc::LEGACY_32b_NO_PAE);
+            commitPwcFills(12);
         }
         break;
       case PTE:
@@ -597,20 +1098,32 @@ Walker::WalkerState::stepWalk(PacketPtr &write)
         panic("Unknown page table walker state %d!\n");
     }
     if (doEndWalk) {
+        if (doTLBInsert) {
+            leafLogBytes = entry.logBytes;
+        }
+        // Shiming: a faulting walk fills the pwc as a 4K walk would
+        commitPwcFills(doTLBInsert ? entry.logBytes : 12);
         if (doTLBInsert)
             if (!functional) {
 
                 // Check if PCIDE is set in CR4
                 CR4 cr4 = tc->readMiscRegNoEffect(misc_reg::Cr4);
-                if (cr4.pcide){
-                    CR3 cr3 = tc->readMiscRegNoEffect(misc_reg::Cr3);
-                    walker->tlb->insert(entry.vaddr, entry, cr3.pcid);
-                }
-                else{
-                    // The current PCID is always 000H if PCIDE
-                    // is not set [sec 4.10.1 of Intel's Software
-                    // Developer Manual]
-                    walker->tlb->insert(entry.vaddr, entry, 0x000);
+                CR3 cr3 = tc->readMiscRegNoEffect(misc_reg::Cr3);
+                // The current PCID is always 000H if PCIDE
+                // is not set [sec 4.10.1 of Intel's Software
+                // Developer Manual]
+                uint64_t pcid = cr4.pcide ? (uint64_t)cr3.pcid : 0x000;
+                // Shiming: a prefetch may outlive its address space
+                if (prefetch && mbits((Addr)cr3, 51, 5) != pwcRoot) {
+                    DPRINTF(PageTableWalker, "Dropping stale prefetch.\n");
+                } else {
+                    // Siblings first, so that they do not evict this one
+                    if (walker->lineFillTlbEnabled && entry.logBytes == 12
+                            && dataSize == 8) {
+                        lineFillTlb(parentWritable, parentUser, pcid);
+                    }
+                    entry.prefetched = prefetch;
+                    walker->tlb->insert(entry.vaddr, entry, pcid);
                 }
             }
 
@@ -641,6 +1154,146 @@ Walker::WalkerState::stepWalk(PacketPtr &write)
     return fault;
 }
 
+void
+Walker::WalkerState::lineFillTlb(bool parent_writable, bool parent_user,
+        uint64_t pcid)
+{
+    assert(dataSize == 8 && (state == LongPTE || state == PAEPTE));
+    unsigned line_bytes = walker->sys->cacheLineSize();
+    Addr pte_addr = read->getAddr();
+    Addr line_addr = pte_addr & ~(Addr)(line_bytes - 1);
+    std::vector<uint8_t> line(line_bytes);
+    walker->readLine(line_addr, line.data());
+
+    // The PTEs of a line map consecutive pages
+    Addr first_vaddr = entry.vaddr - ((pte_addr - line_addr) / dataSize
+            << PageShift);
+    for (unsigned i = 0; i < line_bytes / dataSize; i++) {
+        if (line_addr + i * dataSize == pte_addr) {
+            continue;
+        }
+        uint64_t raw;
+        std::memcpy(&raw, &line[i * dataSize], sizeof(raw));
+        PageTableEntry pte = letoh(raw);
+        // Caching it requires the accessed bit, and we do not set it here
+        if (!pte.p || !pte.a) {
+            continue;
+        }
+        TlbEntry sibling = entry;
+        sibling.vaddr = first_vaddr + ((Addr)i << PageShift);
+        sibling.paddr = mbits(pte, 51, 12);
+        sibling.writable = parent_writable && pte.w;
+        sibling.user = parent_user && pte.u;
+        sibling.uncacheable = pte.pcd;
+        sibling.global = pte.g;
+        sibling.patBit = (state == LongPTE) ? bits(pte, 12) : bits(pte, 7);
+        sibling.prefetched = true;
+        walker->tlb->insert(sibling.vaddr, sibling, pcid);
+        walker->stats.lineFillTlb++;
+    }
+}
+
+void
+Walker::WalkerState::lineFillPwc(BaseTranslationCache::LegacyAcc la)
+{
+    assert(dataSize == 8 && (state == LongPD || state == PAEPD));
+    unsigned line_bytes = walker->sys->cacheLineSize();
+    Addr pde_addr = read->getAddr();
+    Addr line_addr = pde_addr & ~(Addr)(line_bytes - 1);
+    std::vector<uint8_t> line(line_bytes);
+    walker->readLine(line_addr, line.data());
+
+    // The PDEs of a line map consecutive 2MB regions
+    Addr first_vaddr = mbits(entry.vaddr, 63, 21)
+        - ((pde_addr - line_addr) / dataSize << 21);
+    for (unsigned i = 0; i < line_bytes / dataSize; i++) {
+        if (line_addr + i * dataSize == pde_addr) {
+            continue;
+        }
+        uint64_t raw;
+        std::memcpy(&raw, &line[i * dataSize], sizeof(raw));
+        PageTableEntry pde = letoh(raw);
+        if (!pde.p || !pde.a || pde.ps) {
+            continue;
+        }
+        insertPwc(&walker->pwc->pdeCache, first_vaddr + ((Addr)i << 21),
+                pde, la, false);
+        walker->stats.lineFillPwc++;
+    }
+}
+
+void
+Walker::WalkerState::insertPwc(BaseTranslationCache *cache, Addr vaddr,
+        PageTableEntry pte, BaseTranslationCache::LegacyAcc la,
+        bool low_priority)
+{
+    // An INVLPG or a flush since the walk read the entry makes it stale
+    PageStructureCache *pwc = walker->pwc;
+    if (pwc->generation() != pwcGeneration) {
+        walker->stats.pwcFillsDropped++;
+        return;
+    }
+    // Fills are off the critical path of the walk, which does not wait
+    //  for them, but the entry only goes in once its fill has a port
+    Tick at = pwc->reserveFill(curTick());
+    if (at <= curTick()) {
+        cache->insert(vaddr, pwcPcid, pwcRoot, pte, la, low_priority);
+        return;
+    }
+    // The walk may be over by then, and the pwc invalidated
+    Walker *w = walker;
+    uint16_t pcid = pwcPcid;
+    Addr root = pwcRoot;
+    uint64_t generation = pwcGeneration;
+    walker->schedule(new EventFunctionWrapper(
+            [w, pwc, generation, cache, vaddr, pcid, root, pte, la,
+                low_priority]
+            {
+                if (pwc->generation() != generation) {
+                    w->stats.pwcFillsDropped++;
+                    return;
+                }
+                cache->insert(vaddr, pcid, root, pte, la, low_priority);
+            }, name() + ".pwcFill", true), at);
+}
+
+void
+Walker::WalkerState::fillPwc(BaseTranslationCache *cache, Addr vaddr,
+        PageTableEntry pte, BaseTranslationCache::LegacyAcc la)
+{
+    if (walker->pwc->getHugePageFill() == PageStructureCache::NORMAL) {
+        insertPwc(cache, vaddr, pte, la, false);
+    } else {
+        pendingPwcFills.push_back({cache, vaddr, pte, la});
+    }
+}
+
+void
+Walker::WalkerState::commitPwcFills(unsigned log_bytes)
+{
+    if (pendingPwcFills.empty()) {
+        return;
+    }
+    PageStructureCache::HugePageFill policy =
+        walker->pwc->getHugePageFill();
+    bool huge = log_bytes > 12;
+    for (const PwcFill &fill : pendingPwcFills) {
+        if (huge && policy == PageStructureCache::BYPASS) {
+            walker->stats.hugePwcFillsBypassed++;
+            continue;
+        }
+        // Huge walks never use the PDE cache, so 4K walks keep it
+        bool low_priority = !huge &&
+            policy == PageStructureCache::PRIORITISE &&
+            fill.cache != &walker->pwc->pdeCache;
+        insertPwc(fill.cache, fill.vaddr, fill.pte, fill.la, low_priority);
+        if (low_priority) {
+            walker->stats.pwcFillsDemoted++;
+        }
+    }
+    pendingPwcFills.clear();
+}
+
 void
 Walker::WalkerState::endWalk()
 {
@@ -648,8 +1301,24 @@ Walker::WalkerState::endWalk()
     delete read;
     read = NULL;
 
-    // Shiming: profile pagewalk penalty
-    walker->tlb->increasePageWalkLat(curTick() - startTick);
+    // Shiming: profile pagewalk penalty, of demand walks only
+    if (!prefetch) {
+        walker->tlb->increasePageWalkLat(curTick() - startTick);
+        if (timing) {
+            Cycles lat = walker->ticksToCycles(curTick() - startTick);
+            walker->stats.walkLatency.sample(lat);
+            walker->stats.walkReads.sample(numReads);
+            if (leafLogBytes) {
+                // 4K, 2M/4M or 1G
+                int size = leafLogBytes < 21 ? 0 : (leafLogBytes < 30 ? 1 : 2);
+                walker->stats.sizeWalks[size]++;
+                walker->stats.sizeWalkCycles[size] += lat;
+                if (hitInPwc) {
+                    walker->stats.sizePwcHits[size]++;
+                }
+            }
+        }
+    }
 }
 
 void
@@ -664,29 +1333,40 @@ Walker::WalkerState::setupWalk(Addr vaddr)
     Addr topAddr;
     // Shiming: pwc related
     hitInPwc = false;
+    pwcLookupLat = Cycles(0);
+    // The current PCID is always 000H if PCIDE is not set
+    pwcPcid = cr4.pcide ? (uint16_t)cr3.pcid : 0;
+    pwcRoot = mbits((Addr)cr3, 51, 5);
+    pwcGeneration = walker->pwc ? walker->pwc->generation() : 0;
+    pendingPwcFills.clear();
+    leafLogBytes = 0;
     if (efer.lma) {
-        // Do long mode.
-        state = LongPML4;
-        topAddr = (cr3.longPdtb << 12) + addr.longl4 * dataSize;
+        // Do long mode, with four or five (LA57) levels.
         enableNX = efer.nxe;
-
-        // Shiming: try to skip steps
-        if (walker->enablePwc && !functional) {
-            TranslationCacheEntry* pwcEntry =
-                    walker->pwc->pdeCache.lookup(addr);
-            pwcHitState = LongPD;
-            if (!pwcEntry) {
-                pwcEntry = walker->pwc->pdpCache.lookup(addr);
-                pwcHitState = LongPDP;
-            }
-            if (!pwcEntry) {
-                pwcEntry = walker->pwc->pml4Cache.lookup(addr);
-                pwcHitState = LongPML4;
+        // The first level starts the permissions of the entry
+        entry.writable = true;
+        entry.user = true;
+        entry.noExec = false;
+        if (cr4.la57) {
+            state = LongPML5;
+            topAddr = (cr3.longPdtb << 12) + addr.longl5 * dataSize;
+            // Shiming: try to skip steps
+            if (walker->enablePwc && !functional) {
+                probePwc(addr, BaseTranslationCache::LegacyAcc::NONE,
+                        {{&walker->pwc->pdeCache, LongPD},
+                         {&walker->pwc->pdpCache, LongPDP},
+                         {&walker->pwc->pml4Cache, LongPML4},
+                         {&walker->pwc->pml5Cache, LongPML5}});
             }
-
-            if (pwcEntry) {
-                hitInPwc = true;
-                nextStepEntry = pwcEntry->nextStepEntry;
+        } else {
+            state = LongPML4;
+            topAddr = (cr3.longPdtb << 12) + addr.longl4 * dataSize;
+            // Shiming: try to skip steps
+            if (walker->enablePwc && !functional) {
+                probePwc(addr, BaseTranslationCache::LegacyAcc::NONE,
+                        {{&walker->pwc->pdeCache, LongPD},
+                         {&walker->pwc->pdpCache, LongPDP},
+                         {&walker->pwc->pml4Cache, LongPML4}});
             }
         }
     } else {
@@ -698,20 +1378,10 @@ Walker::WalkerState::setupWalk(Addr vaddr)
             enableNX = efer.nxe;
             // Shiming: try to skip steps
             if (walker->enablePwc && !functional) {
-                TranslationCacheEntry* pwcEntry =
-                        walker->pwc->pdeCache.lookup(addr,
-                            BaseTranslationCache::LegacyAcc::LEGACY_32b_PAE);
-                pwcHitState = PAEPD;
-                if (!pwcEntry) {
-                    pwcEntry = walker->pwc->pdpCache.lookup(addr,
-                            BaseTranslationCache::LegacyAcc::LEGACY_32b_PAE);
-                    pwcHitState = PAEPDP;
-                }
-
-                if (pwcEntry) {
-                    hitInPwc = true;
-                    nextStepEntry = pwcEntry->nextStepEntry;
-                }
+                probePwc(addr,
+                        BaseTranslationCache::LegacyAcc::LEGACY_32b_PAE,
+                        {{&walker->pwc->pdeCache, PAEPD},
+                         {&walker->pwc->pdpCache, PAEPDP}});
             }
         } else {
             dataSize = 4;
@@ -727,14 +1397,9 @@ Walker::WalkerState::setupWalk(Addr vaddr)
 
             // Shiming: try to skip steps
             if (walker->enablePwc && !functional) {
-                TranslationCacheEntry* pwcEntry =
-                    walker->pwc->pdeCache.lookup(addr,
-                        BaseTranslationCache::LegacyAcc::LEGACY_32b_NO_PAE);
-                pwcHitState = state;
-                if (pwcEntry) {
-                    hitInPwc = true;
-                    nextStepEntry = pwcEntry->nextStepEntry;
-                }
+                probePwc(addr,
+                        BaseTranslationCache::LegacyAcc::LEGACY_32b_NO_PAE,
+                        {{&walker->pwc->pdeCache, state}});
             }
         }
     }
@@ -795,6 +1460,77 @@ Walker::WalkerState::setupWalk(Addr vaddr)
     }
 }
 
+TranslationCacheEntry *
+Walker::WalkerState::lookupPwcLevel(PageStructureCache *pwc,
+        BaseTranslationCache *cache, Addr vaddr,
+        BaseTranslationCache::LegacyAcc la, const BaseTranslationCache *user)
+{
+    if (pwc->isParallelProbe()) {
+        // All levels are looked up in the same step, so only the level
+        //  that is used (the deepest hit) is accounted.
+        TranslationCacheEntry *entry = cache->probe(vaddr, pwcPcid, pwcRoot,
+                la, user);
+        if (entry) {
+            cache->access(entry);
+        }
+        return entry;
+    }
+    return cache->lookup(vaddr, pwcPcid, pwcRoot, la, true, user);
+}
+
+void
+Walker::WalkerState::probePwc(Addr vaddr,
+        BaseTranslationCache::LegacyAcc la,
+        std::initializer_list<PwcLevel> levels)
+{
+    PageStructureCache *pwc = walker->pwc;
+    TranslationCacheEntry *pwcEntry = nullptr;
+    unsigned num_probed = 0;
+    for (const PwcLevel &level : levels) {
+        num_probed++;
+        pwcEntry = lookupPwcLevel(pwc, level.cache, vaddr, la);
+        if (pwcEntry) {
+            pwcHitState = level.state;
+            break;
+        }
+    }
+
+    pwc->recordProbe(pwcEntry != nullptr, pwcPcid);
+    // Shiming: the probe waits for a lookup port first. The times are in
+    //  ticks, a shared pwc may be in another clock domain than the walker
+    Tick start = walker->clockEdge();
+    Tick done = pwc->reserveLookup(start) + pwc->probeTicks(num_probed);
+
+    // Shiming: on a miss in all levels, try the shared pwc (if any) and
+    //  bring the deepest hit back into this one
+    PageStructureCache *shared = pwc->getNextLevel();
+    if (!pwcEntry && shared) {
+        num_probed = 0;
+        for (const PwcLevel &level : levels) {
+            num_probed++;
+            TranslationCacheEntry *sharedEntry = lookupPwcLevel(shared,
+                    level.cache->getNextLevel(), vaddr, la, level.cache);
+            if (sharedEntry) {
+                pwcHitState = level.state;
+                pwcEntry = level.cache->fillFromNextLevel(vaddr, pwcPcid,
+                        pwcRoot, la, sharedEntry);
+                break;
+            }
+        }
+        shared->recordProbe(pwcEntry != nullptr, pwcPcid);
+        done = shared->reserveLookup(done) + shared->probeTicks(num_probed);
+    }
+    pwcLookupLat = walker->ticksToCycles(done - start);
+
+    if (pwcEntry) {
+        hitInPwc = true;
+        nextStepEntry = pwcEntry->nextStepEntry;
+        walker->stats.pwcHitLevel[walker->walkLevel(pwcHitState) + 1]++;
+    } else {
+        walker->stats.pwcHitLevel[0]++;
+    }
+}
+
 bool
 Walker::WalkerState::recvPacket(PacketPtr pkt)
 {
@@ -802,12 +1538,24 @@ Walker::WalkerState::recvPacket(PacketPtr pkt)
     assert(inflight);
     assert(state == Waiting);
     inflight--;
+    bool host_read = pkt == hostInflight;
+    if (host_read) {
+        // Shiming: the walk goes on with the next host read, or with the
+        //  guest read that waited for the host walk
+        hostInflight = NULL;
+        if (!squashed) {
+            recvHostRead(pkt);
+        }
+        delete pkt;
+    }
     if (squashed) {
         // if were were squashed, return true once inflight is zero and
         // this WalkerState will be freed there.
         return (inflight == 0);
     }
-    if (pkt->isRead()) {
+    if (host_read) {
+        sendPackets();
+    } else if (pkt->isRead()) {
         // should not have a pending read it we also had one outstanding
         assert(!read);
 
@@ -824,14 +1572,25 @@ Walker::WalkerState::recvPacket(PacketPtr pkt)
         if (write) {
             writes.push_back(write);
         }
+        // Shiming: the data page of a nested walk goes through the host
+        //  table too
+        if (walker->nested && read == NULL && timingFault == NoFault) {
+            startHostWalk(entry.paddr);
+        }
         sendPackets();
     } else {
         sendPackets();
     }
-    if (inflight == 0 && read == NULL && writes.size() == 0) {
+    if (inflight == 0 && read == NULL && hostRead == NULL &&
+            writes.size() == 0) {
         state = Ready;
         nextState = Waiting;
-        if (timingFault == NoFault) {
+        if (prefetch) {
+            // Shiming: the TLB is filled, nobody else waits for the walk
+            if (timingFault != NoFault) {
+                walker->stats.prefetchFaults++;
+            }
+        } else if (timingFault == NoFault) {
             /*
              * Finish the translation. Now that we know the right entry is
              * in the TLB, this should work with no memory accesses.
@@ -862,17 +1621,55 @@ Walker::WalkerState::sendPackets()
     if (retrying)
         return;
 
+    // Shiming: in a nested walk, the guest read waits for the host walk of
+    //  its (guest physical) address
+    if (read && walker->nested && !hostDone && !hostRead && !hostInflight) {
+        hostDone = !startHostWalk(read->getAddr());
+    }
+    if (hostRead) {
+        PacketPtr pkt = hostRead;
+        hostRead = NULL;
+        inflight++;
+        if (!walker->sendTiming(this, pkt)) {
+            retrying = true;
+            hostRead = pkt;
+            inflight--;
+            return;
+        }
+        hostInflight = pkt;
+        hostSendTick = curTick();
+        numReads++;
+    }
+
     //Reads always have priority
-    if (read) {
+    if (read && (!walker->nested || hostDone)) {
         PacketPtr pkt = read;
         read = NULL;
         inflight++;
-        if (!walker->sendTiming(this, pkt)) {
+        // Shiming: if another walk is reading the same entry (e.g. the
+        //  PML4 or PDP entry of a neighbouring page), wait for its data
+        WalkerState *owner =
+            walker->findInflightRead(this, pkt->getAddr(), nextState);
+        if (owner) {
+            DPRINTF(PageTableWalker, "Sharing the read of %#x\n",
+                    pkt->getAddr());
+            sharedRead = pkt;
+            owner->levelWaiters.push_back(this);
+            walker->stats.sharedReads++;
+        } else if (!walker->sendTiming(this, pkt)) {
             retrying = true;
             read = pkt;
             inflight--;
             return;
+        } else {
+            readInflight = true;
+            inflightAddr = pkt->getAddr();
+            inflightState = nextState;
+            readSendTick = curTick();
+            numReads++;
         }
+        // The next guest read needs its own host walk
+        hostDone = false;
     }
     //Send off as many of the writes as we can.
     while (writes.size()) {
@@ -888,6 +1685,95 @@ Walker::WalkerState::sendPackets()
     }
 }
 
+bool
+Walker::WalkerState::startHostWalk(Addr gpa)
+{
+    hostGpa = gpa;
+    // Host entries are all tagged with PCID 0 and the table base
+    if (walker->nestedTlb &&
+            walker->nestedTlb->lookup(gpa, 0, walker->hostTableBase)) {
+        return false;
+    }
+    walker->stats.hostWalks++;
+
+    // Skip the host levels cached in the host pwc, deepest first
+    hostLevel = 0;
+    if (PageStructureCache *host_pwc = walker->hostPwc) {
+        BaseTranslationCache *levels[] = {&host_pwc->pdeCache,
+            &host_pwc->pdpCache, &host_pwc->pml4Cache};
+        for (unsigned i = 0; i < NumHostLevels - 1; i++) {
+            if (levels[i]->lookup(gpa, 0, walker->hostTableBase)) {
+                hostLevel = NumHostLevels - 1 - i;
+                break;
+            }
+        }
+        host_pwc->recordProbe(hostLevel != 0, 0);
+    }
+    walker->stats.hostPwcHitLevel[hostLevel]++;
+    makeHostRead();
+    return true;
+}
+
+void
+Walker::WalkerState::makeHostRead()
+{
+    RequestPtr request = std::make_shared<Request>(
+        walker->hostEntryAddr(hostLevel, hostGpa), sizeof(uint64_t),
+        Request::PHYSICAL, walker->requestorId);
+    hostRead = new Packet(request, MemCmd::ReadReq);
+    hostRead->allocate();
+}
+
+void
+Walker::WalkerState::recvHostRead(PacketPtr pkt)
+{
+    if (timing) {
+        walker->stats.hostReads[hostLevel]++;
+        walker->stats.hostReadCycles[hostLevel] +=
+            walker->ticksToCycles(curTick() - hostSendTick);
+    }
+
+    // The modeled entry is present, writable and accessed, and points to
+    //  the table of the next host level, or to the page itself
+    PageTableEntry pte = 0;
+    pte.p = 1;
+    pte.w = 1;
+    pte.a = 1;
+    if (hostLevel + 1 < NumHostLevels) {
+        pte.base = walker->hostEntryAddr(hostLevel + 1, hostGpa) >> PageShift;
+        if (PageStructureCache *host_pwc = walker->hostPwc) {
+            BaseTranslationCache *levels[] = {&host_pwc->pml4Cache,
+                &host_pwc->pdpCache, &host_pwc->pdeCache};
+            levels[hostLevel]->insert(hostGpa, 0, walker->hostTableBase,
+                    pte);
+        }
+        hostLevel++;
+        makeHostRead();
+    } else {
+        pte.base = hostGpa >> PageShift;
+        if (walker->nestedTlb) {
+            walker->nestedTlb->insert(hostGpa, 0, walker->hostTableBase,
+                    pte);
+        }
+        hostDone = true;
+    }
+}
+
+void
+Walker::WalkerState::hostWalkAtomic(Addr gpa)
+{
+    if (!startHostWalk(gpa)) {
+        return;
+    }
+    while (hostRead) {
+        PacketPtr pkt = hostRead;
+        hostRead = NULL;
+        walker->port.sendAtomic(pkt);
+        recvHostRead(pkt);
+        delete pkt;
+    }
+}
+
 unsigned
 Walker::WalkerState::numInflight() const
 {
@@ -38,6 +38,7 @@
 #ifndef __ARCH_X86_PAGE_TABLE_WALKER_HH__
 #define __ARCH_X86_PAGE_TABLE_WALKER_HH__
 
+#include <initializer_list>
 #include <vector>
 
 #include "arch/generic/mmu.hh"
@@ -45,11 +46,14 @@
 #include "arch/x86/tlb.hh"
 // Shiming:
 #include "arch/x86/translation_cache.hh"
+#include "base/logging.hh"
 #include "base/types.hh"
 #include "mem/packet.hh"
 #include "params/X86PagetableWalker.hh"
 #include "sim/clocked_object.hh"
 #include "sim/faults.hh"
+#include "sim/probe/probe.hh"
+#include "sim/stats.hh"
 #include "sim/system.hh"
 
 namespace gem5
@@ -59,13 +63,15 @@ class ThreadContext;
 
 namespace X86ISA
 {
+    class NestedTlb;
+
     // Shiming: define outside of class so pwc can use it
     enum PageWalkState : short
     {
         Ready,
         Waiting,
-        // Long mode
-        LongPML4, LongPDP, LongPD, LongPTE,
+        // Long mode, LongPML5 only with five-level paging (CR4.LA57)
+        LongPML5, LongPML4, LongPDP, LongPD, LongPTE,
         // PAE legacy mode
         PAEPDP, PAEPD, PAEPTE,
         // Non PAE legacy mode with and without PSE
@@ -120,6 +126,8 @@ namespace X86ISA
             bool retrying;
             bool started;
             bool squashed;
+            // Shiming: a background walk of the translation prefetcher
+            bool prefetch;
             /**
              * Shiming: record pwc related stuff
              * @{
@@ -129,16 +137,75 @@ namespace X86ISA
             bool skipPwcCaching;
             State pwcHitState;
             PageTableEntry nextStepEntry;
+            // Shiming: pwc lookup latency, charged before the first read
+            Cycles pwcLookupLat;
+            // Shiming: PCID that pwc entries of this walk are tagged with
+            uint16_t pwcPcid;
+            // Shiming: and its page table root (from CR3)
+            Addr pwcRoot;
+            // Shiming: PageStructureCache::generation() at the walk start
+            uint64_t pwcGeneration;
+            /**
+             * Shiming: pwc fills waiting for the page size of the walk,
+             *  unless the huge page fill policy is NORMAL
+             */
+            struct PwcFill
+            {
+                BaseTranslationCache *cache;
+                Addr vaddr;
+                PageTableEntry pte;
+                BaseTranslationCache::LegacyAcc la;
+            };
+            std::vector<PwcFill> pendingPwcFills;
+            // Shiming: page size of the translation, once the leaf is read
+            unsigned leafLogBytes;
+            /** @} */
+            /**
+             * Shiming: walk coalescing
+             * @{
+             */
+            // Walks of the same page, that complete with this one
+            std::vector<WalkerState *> secondaries;
+            // Walks waiting for the entry this one is reading
+            std::vector<WalkerState *> levelWaiters;
+            // Our read, while we wait for another walk reading that entry
+            PacketPtr sharedRead;
+            // The entry being read (and its level), if a read is in flight
+            bool readInflight;
+            Addr inflightAddr;
+            State inflightState;
+            /** @} */
+            /**
+             * Shiming: the host dimension of a nested walk. Each guest read
+             *  (and the data page at the end) waits for a host walk of its
+             *  guest physical address, one host read at a time.
+             * @{
+             */
+            // Next host read to send, and the one in flight
+            PacketPtr hostRead;
+            PacketPtr hostInflight;
+            // The pending guest read went through the host walk already
+            bool hostDone;
+            Addr hostGpa;
+            // Host level of hostRead, see Walker::hostEntryAddr()
+            unsigned hostLevel;
+            Tick hostSendTick;
             /** @} */
           public:
             WalkerState(Walker * _walker, BaseMMU::Translation *_translation,
-                        const RequestPtr &_req, bool _isFunctional = false) :
+                        const RequestPtr &_req, bool _isFunctional = false,
+                        bool _isPrefetch = false) :
                 walker(_walker), req(_req), state(Ready),
                 nextState(Ready), inflight(0),
                 translation(_translation),
                 functional(_isFunctional), timing(false),
                 retrying(false), started(false), squashed(false),
-                /** Shiming: */hitInPwc(false), skipPwcCaching(false)
+                prefetch(_isPrefetch),
+                /** Shiming: */hitInPwc(false), skipPwcCaching(false),
+                pwcLookupLat(0), pwcPcid(0), pwcRoot(0), leafLogBytes(0),
+                sharedRead(NULL), readInflight(false), inflightAddr(0),
+                inflightState(Ready), hostRead(NULL), hostInflight(NULL),
+                hostDone(false), hostGpa(0), hostLevel(0), hostSendTick(0)
             {
             }
             void initState(ThreadContext * _tc, BaseMMU::Mode _mode,
@@ -150,19 +217,86 @@ namespace X86ISA
             bool isRetrying();
             bool wasStarted();
             bool isTiming();
+            bool isPrefetch() const { return prefetch; }
             void retry();
             void squash();
             std::string name() const {return walker->name();}
 
           private:
             void setupWalk(Addr vaddr);
+            /**
+             * Shiming: a pwc level that can skip the walk to state.
+             */
+            struct PwcLevel
+            {
+                BaseTranslationCache *cache;
+                State state;
+            };
+            /**
+             * Shiming: look up one level of a pwc for this walk. user is
+             *  the private level in front of a shared one, whose flushes
+             *  hide the shared entries filled before them.
+             */
+            TranslationCacheEntry *lookupPwcLevel(PageStructureCache *pwc,
+                    BaseTranslationCache *cache, Addr vaddr,
+                    BaseTranslationCache::LegacyAcc la,
+                    const BaseTranslationCache *user=nullptr);
+            /**
+             * Shiming: find the deepest cached step of the walk. Levels are
+             *  given deepest first. If they all miss, the shared pwc behind
+             *  them is probed too.
+             */
+            void probePwc(Addr vaddr, BaseTranslationCache::LegacyAcc la,
+                    std::initializer_list<PwcLevel> levels);
             Fault stepWalk(PacketPtr &write);
+            /**
+             * Shiming: the other entries of the line that held the last PTE
+             *  (or PDE) read came with it. Install those that are present
+             *  and accessed into the TLB (or the pdeCache).
+             */
+            void lineFillTlb(bool parent_writable, bool parent_user,
+                    uint64_t pcid);
+            void lineFillPwc(BaseTranslationCache::LegacyAcc la);
+            /**
+             * Shiming: fill a pwc level with a step of this walk, or hold
+             *  the fill until the page size is known, see
+             *  PageStructureCache::HugePageFill.
+             */
+            void fillPwc(BaseTranslationCache *cache, Addr vaddr,
+                    PageTableEntry pte, BaseTranslationCache::LegacyAcc la=
+                    BaseTranslationCache::LegacyAcc::NONE);
+            /** Shiming: do the held fills of a walk of a log_bytes page */
+            void commitPwcFills(unsigned log_bytes);
+            /**
+             * Shiming: fill a pwc level through a fill port, unless the
+             *  pwc was flushed or demapped since the walk started, or is
+             *  by the time the port is free
+             */
+            void insertPwc(BaseTranslationCache *cache, Addr vaddr,
+                    PageTableEntry pte, BaseTranslationCache::LegacyAcc la,
+                    bool low_priority);
             void sendPackets();
+            /**
+             * Shiming: start the host walk of gpa. Returns false if the
+             *  nested TLB had it, or true with hostRead set to the first
+             *  read (below the deepest host pwc hit).
+             */
+            bool startHostWalk(Addr gpa);
+            /** Shiming: set hostRead to the read of hostLevel */
+            void makeHostRead();
+            /** Shiming: go on with the host walk after a host read */
+            void recvHostRead(PacketPtr pkt);
+            /** Shiming: the whole host walk of gpa, in atomic mode */
+            void hostWalkAtomic(Addr gpa);
             void endWalk();
             Fault pageFault(bool present);
 
             // Shiming: Profile page walk penalty
             Tick startTick;
+            // Shiming: memory reads of this walk, and when the last one
+            //  was sent
+            unsigned numReads;
+            Tick readSendTick;
         };
 
         friend class WalkerState;
@@ -179,6 +313,16 @@ namespace X86ISA
                 senderWalk(_senderWalk) {}
         };
 
+        /** Shiming: nobody waits for a prefetch walk */
+        class PrefetchTranslation : public BaseMMU::Translation
+        {
+          public:
+            void markDelayed() override {}
+            void finish(const Fault &fault, const RequestPtr &req,
+                    ThreadContext *tc, BaseMMU::Mode mode) override {}
+        };
+        PrefetchTranslation prefetchTranslation;
+
       public:
         // Kick off the state machine.
         Fault start(ThreadContext * _tc, BaseMMU::Translation *translation,
@@ -209,8 +353,128 @@ namespace X86ISA
         bool recvTimingResp(PacketPtr pkt);
         void recvReqRetry();
         bool sendTiming(WalkerState * sendingState, PacketPtr pkt);
+        // Shiming: read a whole line of page table entries, off the timing
+        //  path (the line was already fetched by the walk)
+        void readLine(Addr line_addr, uint8_t *data);
+
+        /**
+         * Shiming: translation prefetching
+         * @{
+         */
+        bool lineFillTlbEnabled;
+        bool lineFillPwcEnabled;
+        // Number of strides walked ahead, 0 disables the prefetcher
+        unsigned prefetchDegree;
+        // Stride between the pages of the last two demand walks, and how
+        //  many times in a row it was seen
+        Addr pfLastVpn;
+        int64_t pfLastStride;
+        unsigned pfConfidence;
+
+        /** Train the stride prefetcher on a demand walk, and prefetch */
+        void trainPrefetcher(ThreadContext *tc, Addr vaddr);
+        /** Queue a background walk, it starts after the demand walks */
+        void startPrefetch(ThreadContext *tc, Addr vaddr);
+        /** Where a demand walk is queued: ahead of unstarted prefetches */
+        std::list<WalkerState *>::iterator demandQueuePos();
+        /** @} */
+
+        /**
+         * Shiming: concurrent walks
+         * @{
+         */
+        // Number of walks that can be in progress at the same time
+        unsigned numWalkers;
+        // Last time the occupancy histograms were sampled
+        Cycles occupancyCycle;
+
+        /** Walks in progress (the others in currStates are queued) */
+        unsigned numBusy() const;
+        /** Account the time since the last change of occupancy */
+        void sampleOccupancy();
+        /** A walk of the same page as state, that state can wait for */
+        WalkerState *findPrimary(const WalkerState *state);
+        /** A walk with a read of the entry at addr of level in flight */
+        WalkerState *findInflightRead(const WalkerState *state, Addr addr,
+                PageWalkState level);
+        /** Complete a walk that waited for a walk of the same page */
+        void finishSecondary(WalkerState *state);
+        /** Queue a walk, and start it if a walker is free */
+        void enqueue(WalkerState *state);
+        /** Hand a response to its walk, and retire the walk if done */
+        void walkResponse(WalkerState *state, PacketPtr pkt);
+        /** @} */
+
+        /**
+         * Shiming: page table reads are attributed to the level of the
+         *  page table read, and to the level of the memory hierarchy that
+         *  served them.
+         * @{
+         */
+        enum WalkLevel { PML5Level, PML4Level, PDPLevel, PDLevel, PTLevel,
+                         NumWalkLevels };
+        static WalkLevel walkLevel(PageWalkState state);
+        // Number of cache levels in front of memory on the walker's path
+        unsigned cacheLevels;
+        /** Account a page table read that took lat, served by pkt */
+        void recordRead(PageWalkState state, Cycles lat, PacketPtr pkt);
+        /** @} */
+
+        struct WalkerStats : public statistics::Group
+        {
+            WalkerStats(statistics::Group *parent, unsigned cache_levels);
+
+            statistics::Scalar lineFillTlb;
+            statistics::Scalar lineFillPwc;
+            statistics::Scalar prefetches;
+            statistics::Scalar prefetchFaults;
+            statistics::Scalar prefetchDropped;
+            // Shiming: concurrent walks
+            statistics::Scalar coalescedWalks;
+            statistics::Scalar coalescedRewalks;
+            statistics::Scalar sharedReads;
+            statistics::Histogram busyWalkers;
+            statistics::Histogram queuedWalks;
+            // Shiming: walk latency breakdown
+            statistics::Histogram walkLatency;
+            statistics::Histogram walkReads;
+            statistics::Vector levelReads;
+            statistics::Vector levelReadCycles;
+            statistics::Formula levelReadAvgCycles;
+            statistics::Vector2d levelReadServedBy;
+            statistics::Vector pwcHitLevel;
+            // Shiming: per page size (4K, 2M/4M, 1G) of the translation
+            statistics::Vector sizeWalks;
+            statistics::Vector sizeWalkCycles;
+            statistics::Formula sizeWalkAvgCycles;
+            statistics::Vector sizePwcHits;
+            statistics::Scalar hugePwcFillsBypassed;
+            statistics::Scalar pwcFillsDemoted;
+            statistics::Scalar pwcFillsDropped;
+            // Shiming: host dimension of nested walks
+            statistics::Scalar hostWalks;
+            statistics::Vector hostReads;
+            statistics::Vector hostReadCycles;
+            statistics::Formula hostReadAvgCycles;
+            statistics::Vector hostPwcHitLevel;
+        } stats;
+
+        /**
+         * Shiming: notified at the start of every demand walk, see
+         *  walk_profiler.hh. Prefetch walks are not, they would count as
+         *  reuses the program does not make.
+         */
+      public:
+        struct WalkProbeInfo
+        {
+            Addr vaddr;
+            uint16_t pcid;
+        };
+      private:
+        ProbePointArg<WalkProbeInfo> *ppWalk;
 
       public:
+        void regProbePoints() override;
 
         void setTLB(TLB * _tlb)
         {
@@ -225,8 +489,19 @@ namespace X86ISA
             requestorId(sys->getRequestorId(this)),
             numSquashable(params.num_squash_per_cycle),
             startWalkWrapperEvent([this]{ startWalkWrapper(); }, name()),
-            /** Shiming: */ enablePwc(false), pwcVerifMode(false), pwc(nullptr)
+            lineFillTlbEnabled(params.line_fill_tlb),
+            lineFillPwcEnabled(params.line_fill_pwc),
+            prefetchDegree(params.prefetch_degree),
+            pfLastVpn(0), pfLastStride(0), pfConfidence(0),
+            numWalkers(params.num_walkers), occupancyCycle(0),
+            cacheLevels(params.cache_levels),
+            stats(this, params.cache_levels), ppWalk(nullptr),
+            /** Shiming: */ enablePwc(false), pwcVerifMode(false),
+            pwc(nullptr), nested(false), hostPwc(nullptr), nestedTlb(nullptr),
+            hostTableBase(0), hostTableSize(0)
         {
+            fatal_if(numWalkers == 0, "%s: num_walkers must be at least 1",
+                    name());
         }
 
         // Shiming: pwc-related
@@ -243,6 +518,35 @@ namespace X86ISA
 
         PageStructureCache* pwc;
         void setPwc(PageStructureCache* pwcPtr);
+
+        /**
+         * Shiming: nested (2D) walks. gem5 does not model a hypervisor, so
+         *  the host page table (as EPT, 4 levels) maps guest physical
+         *  addresses to the same host physical ones. Its entries are only
+         *  modeled: host reads go to a window of physical memory, where
+         *  each level is one table indexed with the address bits above the
+         *  level, so that they load the caches like a real host table, but
+         *  their data is not used.
+         * @{
+         */
+      private:
+        bool nested;
+        // Host pwc (PML4, PDP and PDE levels), nullptr if none
+        PageStructureCache *hostPwc;
+        // Nested TLB, nullptr if none
+        NestedTlb *nestedTlb;
+        Addr hostTableBase;
+        Addr hostTableSize;
+        // Host levels, from the root
+        static constexpr unsigned NumHostLevels = 4;
+
+        /** Where the host entry of level for gpa is read from */
+        Addr hostEntryAddr(unsigned level, Addr gpa) const;
+      public:
+        void setNested(PageStructureCache *host_pwc, NestedTlb *nested_tlb,
+                Addr table_base, Addr table_size);
+        bool isNested() const { return nested; }
+        /** @} */
     };
 
 } // namespace X86ISA
@@ -631,6 +631,7 @@ BitUnion64(CR4)
     Bitfield<17> pcide; // PCID Enable
     Bitfield<16> fsgsbase; // Enable RDFSBASE, RDGSBASE, WRFSBASE,
                            // WRGSBASE instructions
+    Bitfield<12> la57; // 57-bit Linear Addresses (5-Level Paging)
     Bitfield<10> osxmmexcpt; // Operating System Unmasked
                              // Exception Support
     Bitfield<9> osfxsr; // Operating System FXSave/FSRSTOR Support
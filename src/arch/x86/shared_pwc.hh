@@ -0,0 +1,85 @@
+/**
+ * 2023 Feb
+ * Shiming Li
+ * shiming.li@it.uu.se
+ *
+ * Uppsala Architecture Research Team (UART)
+ * Uppsala University
+ *
+ * A second level pwc that the (private) pwcs of several MMUs can share,
+ *  e.g. by cores running threads of the same process. It is probed when a
+ *  walk misses in all levels of the private pwc, and its hits are brought
+ *  back into the private one. It is unified: all levels share its entries.
+ */
+
+#ifndef __ARCH_X86_SHARED_PWC_HH__
+#define __ARCH_X86_SHARED_PWC_HH__
+
+#include "arch/x86/translation_cache.hh"
+#include "base/logging.hh"
+#include "params/X86SharedPwc.hh"
+#include "sim/clocked_object.hh"
+
+namespace gem5
+{
+
+namespace X86ISA {
+
+class SharedPageStructureCache : public ClockedObject
+{
+  public:
+    /**
+     * Probe latency is the access latency, whatever the levels probed. It
+     *  and the lookup ports are in cycles of this object's clock.
+     */
+    PageStructureCache pwc;
+    const BaseTranslationCache::Inclusion inclusion;
+    /** Put the checkpointed entries back, instead of starting cold */
+    const bool restoreState;
+
+  public:
+    SharedPageStructureCache(const X86SharedPwcParams &p)
+      : ClockedObject(p),
+        pwc(name(), 0, 0, 0, 0, 0, 0, 0, 0, p.replacement_policy, true,
+            p.latency, PageStructureCache::UNIFIED, p.size, p.assoc),
+        inclusion(toInclusion(p.inclusion)),
+        restoreState(p.restore_state)
+    {
+        pwc.setPorts(p.lookup_ports, 0, this);
+    }
+
+    void
+    serialize(CheckpointOut &cp) const override
+    {
+        pwc.serialize(cp);
+    }
+
+    void
+    unserialize(CheckpointIn &cp) override
+    {
+        if (restoreState) {
+            pwc.unserialize(cp);
+        }
+    }
+
+  private:
+    static BaseTranslationCache::Inclusion
+    toInclusion(X86PwcInclusion inclusion)
+    {
+        switch (inclusion) {
+          case X86PwcInclusion::inclusive:
+            return BaseTranslationCache::INCLUSIVE;
+          case X86PwcInclusion::exclusive:
+            return BaseTranslationCache::EXCLUSIVE;
+          case X86PwcInclusion::non_inclusive:
+            return BaseTranslationCache::NON_INCLUSIVE;
+          default:
+            panic("Unknown pwc inclusion policy %d", (int)inclusion);
+        }
+    }
+};
+
+} // namespace X86ISA
+} // namespace gem5
+
+#endif // __ARCH_X86_SHARED_PWC_HH__
@@ -0,0 +1,82 @@
+/**
+ * 2023 Feb
+ * Shiming Li
+ * shiming.li@it.uu.se
+ *
+ * Uppsala Architecture Research Team (UART)
+ * Uppsala University
+ *
+ * The second level TLB, see stlb.hh.
+ */
+
+#include "arch/x86/stlb.hh"
+
+#include "base/trace.hh"
+#include "debug/TLB.hh"
+#include "sim/full_system.hh"
+
+namespace gem5
+{
+
+namespace X86ISA
+{
+
+SecondLevelTLB::SecondLevelTLB(const Params &p)
+    : ClockedObject(p), lruSeq(0),
+      arrays(name(), p.size, p.assoc, p.size_2m, p.assoc_2m,
+             p.size_1g, p.assoc_1g, p.replacement_policy, &lruSeq),
+      stats(this), latency(p.latency)
+{
+    stats.missRate = stats.misses / stats.accesses;
+}
+
+TlbEntry *
+SecondLevelTLB::lookup(Addr va)
+{
+    stats.accesses++;
+    TlbEntry *entry = arrays.lookup(va);
+    if (entry) {
+        DPRINTF(TLB, "STLB hit for %#x.\n", va);
+        stats.hits++;
+    } else {
+        stats.misses++;
+    }
+    return entry;
+}
+
+TlbEntry *
+SecondLevelTLB::insert(Addr vpn, const TlbEntry &entry)
+{
+    // In SE mode, the entries only match the address they were put at
+    return arrays.insert(vpn, entry, FullSystem);
+}
+
+SecondLevelTLB::StlbStats::StlbStats(statistics::Group *parent)
+  : statistics::Group(parent),
+    ADD_STAT(accesses, statistics::units::Count::get(),
+             "STLB lookups (first level TLB misses)"),
+    ADD_STAT(hits, statistics::units::Count::get(),
+             "STLB hits"),
+    ADD_STAT(misses, statistics::units::Count::get(),
+             "STLB misses, which start a page walk"),
+    ADD_STAT(missRate, statistics::units::Ratio::get(),
+             "STLB miss rate")
+{
+}
+
+void
+SecondLevelTLB::serialize(CheckpointOut &cp) const
+{
+    arrays.serialize(cp);
+    SERIALIZE_SCALAR(lruSeq);
+}
+
+void
+SecondLevelTLB::unserialize(CheckpointIn &cp)
+{
+    arrays.unserialize(cp);
+    UNSERIALIZE_SCALAR(lruSeq);
+}
+
+} // namespace X86ISA
+} // namespace gem5
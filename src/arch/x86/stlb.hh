@@ -0,0 +1,74 @@
+/**
+ * 2023 Feb
+ * Shiming Li
+ * shiming.li@it.uu.se
+ *
+ * Uppsala Architecture Research Team (UART)
+ * Uppsala University
+ *
+ * A second level TLB (STLB) behind the instruction and data TLBs of a core.
+ *  It is looked up when the first level TLB misses, and only when it also
+ *  misses does the page walk (and the pwc) start. A hit is brought back
+ *  into the first level TLB after the STLB latency. Walks fill both
+ *  levels, so the STLB is not exclusive of the first level TLBs.
+ */
+
+#ifndef __ARCH_X86_STLB_HH__
+#define __ARCH_X86_STLB_HH__
+
+#include "arch/x86/tlb_array.hh"
+#include "params/X86STLB.hh"
+#include "sim/clocked_object.hh"
+#include "sim/stats.hh"
+
+namespace gem5
+{
+
+namespace X86ISA
+{
+    class SecondLevelTLB : public ClockedObject
+    {
+      protected:
+        uint64_t lruSeq;
+        TlbArrays arrays;
+
+        struct StlbStats : public statistics::Group
+        {
+            StlbStats(statistics::Group *parent);
+
+            statistics::Scalar accesses;
+            statistics::Scalar hits;
+            statistics::Scalar misses;
+            statistics::Formula missRate;
+        } stats;
+
+      public:
+        /** Latency of a lookup, added to the first level miss */
+        const Cycles latency;
+
+      public:
+        typedef X86STLBParams Params;
+        SecondLevelTLB(const Params &p);
+
+        /**
+         * @param va The page aligned address with the PCID, as in the
+         *  first level TLBs
+         */
+        TlbEntry *lookup(Addr va);
+        /** The entry of va, if any, not counted as a lookup */
+        TlbEntry *probe(Addr va) { return arrays.lookup(va, false); }
+        /** vpn has the PCID already */
+        TlbEntry *insert(Addr vpn, const TlbEntry &entry);
+
+        void flushAll() { arrays.flushAll(); }
+        void flushNonGlobal() { arrays.flushNonGlobal(); }
+        void demapPage(Addr va) { arrays.demapPage(va); }
+
+        void serialize(CheckpointOut &cp) const override;
+        void unserialize(CheckpointIn &cp) override;
+    };
+
+} // namespace X86ISA
+} // namespace gem5
+
+#endif // __ARCH_X86_STLB_HH__
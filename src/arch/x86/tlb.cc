@@ -53,6 +53,8 @@
 #include "mem/packet_access.hh"
 #include "mem/page_table.hh"
 #include "mem/request.hh"
+#include "sim/eventq.hh"
+#include "sim/faults.hh"
 #include "sim/full_system.hh"
 #include "sim/process.hh"
 #include "sim/pseudo_inst.hh"
@@ -63,17 +65,12 @@ namespace gem5
 namespace X86ISA {
 
 TLB::TLB(const Params &p)
-    : BaseTLB(p), configAddress(0), size(p.size),
-      tlb(size), lruSeq(0), m5opRange(p.system->m5opRange()), stats(this)
+    : BaseTLB(p), configAddress(0), lruSeq(0),
+      arrays(name(), p.size, p.assoc, p.size_2m, p.assoc_2m,
+             p.size_1g, p.assoc_1g, p.replacement_policy, &lruSeq),
+      stlb(nullptr), ppLookup(nullptr), m5opRange(p.system->m5opRange()),
+      stats(this)
 {
-    if (!size)
-        fatal("TLBs must have a non-zero size.\n");
-
-    for (int x = 0; x < size; x++) {
-        tlb[x].trieHandle = NULL;
-        freeList.push_back(&tlb[x]);
-    }
-
     walker = p.walker;
     walker->setTLB(this);
 
@@ -81,24 +78,6 @@ TLB::TLB(const Params &p)
     stats.pageWalkAvgLat = stats.pageWalkTotalLat / stats.pageWalkNum;
 }
 
-void
-TLB::evictLRU()
-{
-    // Find the entry with the lowest (and hence least recently updated)
-    // sequence number.
-
-    unsigned lru = 0;
-    for (unsigned i = 1; i < size; i++) {
-        if (tlb[i].lruSeq < tlb[lru].lruSeq)
-            lru = i;
-    }
-
-    assert(tlb[lru].trieHandle);
-    trie.remove(tlb[lru].trieHandle);
-    tlb[lru].trieHandle = NULL;
-    freeList.push_back(&tlb[lru]);
-}
-
 TlbEntry *
 TLB::insert(Addr vpn, const TlbEntry &entry, uint64_t pcid)
 {
@@ -108,53 +87,39 @@ TLB::insert(Addr vpn, const TlbEntry &entry, uint64_t pcid)
     //virtual addresses
     vpn = concAddrPcid(vpn, pcid);
 
-    // If somebody beat us to it, just use that existing entry.
-    TlbEntry *newEntry = trie.lookup(vpn);
-    if (newEntry) {
-        assert(newEntry->vaddr == vpn);
-        return newEntry;
-    }
-
-    if (freeList.empty())
-        evictLRU();
+    // Shiming: walks fill both levels
+    if (stlb)
+        stlb->insert(vpn, entry);
 
-    newEntry = freeList.front();
-    freeList.pop_front();
-
-    *newEntry = entry;
-    newEntry->lruSeq = nextSeq();
-    newEntry->vaddr = vpn;
-    if (FullSystem) {
-        newEntry->trieHandle =
-        trie.insert(vpn, TlbEntryTrie::MaxBits-entry.logBytes, newEntry);
-    }
-    else {
-        newEntry->trieHandle =
-        trie.insert(vpn, TlbEntryTrie::MaxBits, newEntry);
-    }
-    return newEntry;
+    // In SE mode, the entries only match the address they were put at
+    return arrays.insert(vpn, entry, FullSystem);
 }
 
 TlbEntry *
 TLB::lookup(Addr va, bool update_lru)
 {
-    TlbEntry *entry = trie.lookup(va);
-    if (entry && update_lru)
-        entry->lruSeq = nextSeq();
-    return entry;
+    return arrays.lookup(va, update_lru);
+}
+
+bool
+TLB::cached(Addr va)
+{
+    return arrays.lookup(va, false) || (stlb && stlb->probe(va));
+}
+
+void
+TLB::regProbePoints()
+{
+    ppLookup = new ProbePointArg<Addr>(getProbeManager(), "Lookup");
 }
 
 void
 TLB::flushAll()
 {
     DPRINTF(TLB, "Invalidating all entries.\n");
-    for (unsigned i = 0; i < size; i++) {
-        if (tlb[i].trieHandle) {
-            trie.remove(tlb[i].trieHandle);
-            tlb[i].trieHandle = NULL;
-            freeList.push_back(&tlb[i]);
-        }
-    }
+    arrays.flushAll();
+    if (stlb)
+        stlb->flushAll();
 }
 
 void
@@ -167,24 +132,17 @@ void
 TLB::flushNonGlobal()
 {
     DPRINTF(TLB, "Invalidating all non global entries.\n");
-    for (unsigned i = 0; i < size; i++) {
-        if (tlb[i].trieHandle && !tlb[i].global) {
-            trie.remove(tlb[i].trieHandle);
-            tlb[i].trieHandle = NULL;
-            freeList.push_back(&tlb[i]);
-        }
-    }
+    arrays.flushNonGlobal();
+    if (stlb)
+        stlb->flushNonGlobal();
 }
 
 void
 TLB::demapPage(Addr va, uint64_t asn)
 {
-    TlbEntry *entry = trie.lookup(va);
-    if (entry) {
-        trie.remove(entry->trieHandle);
-        entry->trieHandle = NULL;
-        freeList.push_back(entry);
-    }
+    arrays.demapPage(va);
+    if (stlb)
+        stlb->demapPage(va);
 }
 
 namespace
@@ -420,21 +378,54 @@ TLB::translate(const RequestPtr &req,
 
             pageAlignedVaddr = concAddrPcid(pageAlignedVaddr, pcid);
             TlbEntry *entry = lookup(pageAlignedVaddr);
+            ppLookup->notify(pageAlignedVaddr);
 
             if (mode == BaseMMU::Read) {
                 stats.rdAccesses++;
             } else {
                 stats.wrAccesses++;
             }
+            // Shiming: on a miss, try the STLB before walking
             if (!entry) {
-                DPRINTF(TLB, "Handling a TLB miss for "
-                        "address %#x at pc %#x.\n",
-                        vaddr, tc->pcState().instAddr());
                 if (mode == BaseMMU::Read) {
                     stats.rdMisses++;
                 } else {
                     stats.wrMisses++;
                 }
+                TlbEntry *stlbEntry =
+                    stlb ? stlb->lookup(pageAlignedVaddr) : nullptr;
+                if (stlbEntry) {
+                    stats.stlbHits++;
+                    // The first level copy counts a prefetch hit, if any
+                    TlbEntry copy = *stlbEntry;
+                    stlbEntry->prefetched = false;
+                    if (timing && translation && stlb->latency > 0) {
+                        // Finish with the copy once the STLB has responded,
+                        //  the entry only reaches this TLB then
+                        delayedResponse = true;
+                        auto finish = [this, req, tc, translation, mode,
+                                       vaddr, copy]
+                        {
+                            finishStlbHit(req, tc, translation, mode, vaddr,
+                                          copy);
+                        };
+                        stlb->schedule(new EventFunctionWrapper(finish,
+                                name() + ".stlbHitEvent", true),
+                            stlb->clockEdge(stlb->latency));
+                        return NoFault;
+                    }
+                    // The vaddr of the entry has the pcid already
+                    entry = arrays.insert(copy.vaddr, copy, FullSystem);
+                }
+            }
+            if (entry && entry->prefetched) {
+                stats.prefetchHits++;
+                entry->prefetched = false;
+            }
+            if (!entry) {
+                DPRINTF(TLB, "Handling a TLB miss for "
+                        "address %#x at pc %#x.\n",
+                        vaddr, tc->pcState().instAddr());
                 if (FullSystem) {
                     Fault fault = walker->start(tc, translation, req, mode);
                     // Shiming: record page walks
@@ -467,32 +458,9 @@ TLB::translate(const RequestPtr &req,
                 }
             }
 
-            DPRINTF(TLB, "Entry found with paddr %#x, "
-                    "doing protection checks.\n", entry->paddr);
-            // Do paging protection checks.
-            bool inUser = m5Reg.cpl == 3 && !(flags & CPL0FlagBit);
-            CR0 cr0 = tc->readMiscRegNoEffect(misc_reg::Cr0);
-            bool badWrite = (!entry->writable && (inUser || cr0.wp));
-            if ((inUser && !entry->user) ||
-                (mode == BaseMMU::Write && badWrite)) {
-                // The page must have been present to get into the TLB in
-                // the first place. We'll assume the reserved bits are
-                // fine even though we're not checking them.
-                return std::make_shared<PageFault>(vaddr, true, mode, inUser,
-                                                   false);
-            }
-            if (storeCheck && badWrite) {
-                // This would fault if this were a write, so return a page
-                // fault that reflects that happening.
-                return std::make_shared<PageFault>(
-                    vaddr, true, BaseMMU::Write, inUser, false);
-            }
-
-            Addr paddr = entry->paddr | (vaddr & mask(entry->logBytes));
-            DPRINTF(TLB, "Translated %#x -> %#x.\n", vaddr, paddr);
-            req->setPaddr(paddr);
-            if (entry->uncacheable)
-                req->setFlags(Request::UNCACHEABLE | Request::STRICT_ORDER);
+            Fault fault = translateWithEntry(req, tc, mode, vaddr, *entry);
+            if (fault != NoFault)
+                return fault;
         } else {
             //Use the address which already has segmentation applied.
             DPRINTF(TLB, "Paging disabled.\n");
@@ -509,6 +477,43 @@ TLB::translate(const RequestPtr &req,
     return finalizePhysical(req, tc, mode);
 }
 
+Fault
+TLB::translateWithEntry(const RequestPtr &req, ThreadContext *tc,
+        BaseMMU::Mode mode, Addr vaddr, const TlbEntry &entry)
+{
+    Request::Flags flags = req->getFlags();
+    bool storeCheck = flags & Request::READ_MODIFY_WRITE;
+    HandyM5Reg m5Reg = tc->readMiscRegNoEffect(misc_reg::M5Reg);
+
+    DPRINTF(TLB, "Entry found with paddr %#x, "
+            "doing protection checks.\n", entry.paddr);
+    // Do paging protection checks.
+    bool inUser = m5Reg.cpl == 3 && !(flags & CPL0FlagBit);
+    CR0 cr0 = tc->readMiscRegNoEffect(misc_reg::Cr0);
+    bool badWrite = (!entry.writable && (inUser || cr0.wp));
+    if ((inUser && !entry.user) ||
+        (mode == BaseMMU::Write && badWrite)) {
+        // The page must have been present to get into the TLB in
+        // the first place. We'll assume the reserved bits are
+        // fine even though we're not checking them.
+        return std::make_shared<PageFault>(vaddr, true, mode, inUser,
+                                           false);
+    }
+    if (storeCheck && badWrite) {
+        // This would fault if this were a write, so return a page
+        // fault that reflects that happening.
+        return std::make_shared<PageFault>(
+            vaddr, true, BaseMMU::Write, inUser, false);
+    }
+
+    Addr paddr = entry.paddr | (vaddr & mask(entry.logBytes));
+    DPRINTF(TLB, "Translated %#x -> %#x.\n", vaddr, paddr);
+    req->setPaddr(paddr);
+    if (entry.uncacheable)
+        req->setFlags(Request::UNCACHEABLE | Request::STRICT_ORDER);
+    return NoFault;
+}
+
 Fault
 TLB::translateAtomic(const RequestPtr &req, ThreadContext *tc,
     BaseMMU::Mode mode)
@@ -566,6 +571,30 @@ TLB::translateTiming(const RequestPtr &req, ThreadContext *tc,
         translation->markDelayed();
 }
 
+void
+TLB::finishStlbHit(const RequestPtr &req, ThreadContext *tc,
+    BaseMMU::Translation *translation, BaseMMU::Mode mode, Addr vaddr,
+    const TlbEntry &stlb_entry)
+{
+    if (translation->squashed()) {
+        // Like the walker does for squashed walks
+        translation->finish(std::make_shared<UnimpFault>("Squashed Inst"),
+                            req, tc, mode);
+        return;
+    }
+    // The lookup was counted when the translation started
+    TlbEntry *entry = arrays.insert(stlb_entry.vaddr, stlb_entry,
+                                    FullSystem);
+    if (entry->prefetched) {
+        stats.prefetchHits++;
+        entry->prefetched = false;
+    }
+    Fault fault = translateWithEntry(req, tc, mode, vaddr, *entry);
+    if (fault == NoFault)
+        fault = finalizePhysical(req, tc, mode);
+    translation->finish(fault, req, tc, mode);
+}
+
 Walker *
 TLB::getWalker()
 {
@@ -582,6 +611,8 @@ TLB::TlbStats::TlbStats(statistics::Group *parent)
              "TLB misses on read requests"),
     ADD_STAT(wrMisses, statistics::units::Count::get(),
              "TLB misses on write requests"),
+    ADD_STAT(stlbHits, statistics::units::Count::get(),
+             "TLB misses that hit in the second level TLB"),
     // Shiming
     ADD_STAT(pageWalkNum, statistics::units::Count::get(),
              "Total number of page walks"),
@@ -589,45 +620,24 @@ TLB::TlbStats::TlbStats(statistics::Group *parent)
              "Total latency of page walks"),
     ADD_STAT(pageWalkAvgLat, statistics::units::Rate<
                 statistics::units::Tick, statistics::units::Count>::get(),
-             "Average latency of page walks")
+             "Average latency of page walks"),
+    ADD_STAT(prefetchHits, statistics::units::Count::get(),
+             "First hits on entries installed by translation prefetching")
 {
 }
 
 void
 TLB::serialize(CheckpointOut &cp) const
 {
-    // Only store the entries in use.
-    uint32_t _size = size - freeList.size();
-    SERIALIZE_SCALAR(_size);
+    arrays.serialize(cp);
     SERIALIZE_SCALAR(lruSeq);
-
-    uint32_t _count = 0;
-    for (uint32_t x = 0; x < size; x++) {
-        if (tlb[x].trieHandle != NULL)
-            tlb[x].serializeSection(cp, csprintf("Entry%d", _count++));
-    }
 }
 
 void
 TLB::unserialize(CheckpointIn &cp)
 {
-    // Do not allow to restore with a smaller tlb.
-    uint32_t _size;
-    UNSERIALIZE_SCALAR(_size);
-    if (_size > size) {
-        fatal("TLB size less than the one in checkpoint!");
-    }
-
+    arrays.unserialize(cp);
     UNSERIALIZE_SCALAR(lruSeq);
-
-    for (uint32_t x = 0; x < _size; x++) {
-        TlbEntry *newEntry = freeList.front();
-        freeList.pop_front();
-
-        newEntry->unserializeSection(cp, csprintf("Entry%d", x));
-        newEntry->trieHandle = trie.insert(newEntry->vaddr,
-            TlbEntryTrie::MaxBits - newEntry->logBytes, newEntry);
-    }
 }
 
 Port *
@@ -38,14 +38,15 @@
 #ifndef __ARCH_X86_TLB_HH__
 #define __ARCH_X86_TLB_HH__
 
-#include <list>
 #include <vector>
 
 #include "arch/generic/tlb.hh"
 #include "arch/x86/pagetable.hh"
-#include "base/trie.hh"
+#include "arch/x86/stlb.hh"
+#include "arch/x86/tlb_array.hh"
 #include "mem/request.hh"
 #include "params/X86TLB.hh"
+#include "sim/probe/probe.hh"
 #include "sim/stats.hh"
 
 namespace gem5
@@ -62,8 +63,6 @@ namespace X86ISA
       protected:
         friend class Walker;
 
-        typedef std::list<TlbEntry *> EntryList;
-
         uint32_t configAddress;
 
       public:
@@ -74,6 +73,11 @@ namespace X86ISA
         void takeOverFrom(BaseTLB *otlb) override {}
 
         TlbEntry *lookup(Addr va, bool update_lru = true);
+        /**
+         * Shiming: Whether va is in this TLB or its STLB, without counting
+         *  an access or updating the LRU of either.
+         */
+        bool cached(Addr va);
 
         void setConfigAddress(uint32_t addr);
         //concatenate Page Addr and pcid
@@ -84,8 +88,6 @@ namespace X86ISA
 
       protected:
 
-        EntryList::iterator lookupIt(Addr va, bool update_lru = true);
-
         Walker * walker;
 
       public:
@@ -97,15 +99,25 @@ namespace X86ISA
 
         void demapPage(Addr va, uint64_t asn) override;
 
+        void regProbePoints() override;
+
+        void setStlb(SecondLevelTLB *_stlb) { stlb = _stlb; }
+        SecondLevelTLB *getStlb() { return stlb; }
+
       protected:
-        uint32_t size;
+        uint64_t lruSeq;
 
-        std::vector<TlbEntry> tlb;
+        /** Shiming: one array per page size, see tlb_array.hh */
+        TlbArrays arrays;
 
-        EntryList freeList;
+        /** Shiming: second level TLB behind this one, may be shared */
+        SecondLevelTLB *stlb;
 
-        TlbEntryTrie trie;
-        uint64_t lruSeq;
+        /**
+         * Shiming: notified of the page (with the PCID in its low bits) of
+         *  every lookup of a translation, see walk_profiler.hh.
+         */
+        ProbePointArg<Addr> *ppLookup;
 
         AddrRange m5opRange;
 
@@ -117,11 +129,15 @@ namespace X86ISA
             statistics::Scalar wrAccesses;
             statistics::Scalar rdMisses;
             statistics::Scalar wrMisses;
+            // Shiming: misses of this TLB that hit in the STLB
+            statistics::Scalar stlbHits;
 
             // Shiming: profile pagewalk penalty
             statistics::Scalar pageWalkNum;
             statistics::Scalar pageWalkTotalLat;
             statistics::Formula pageWalkAvgLat;
+            // Shiming: first hits on prefetched (or line-filled) entries
+            statistics::Scalar prefetchHits;
         } stats;
 
         Fault translateInt(bool read, RequestPtr req, ThreadContext *tc);
@@ -130,13 +146,30 @@ namespace X86ISA
                 BaseMMU::Translation *translation, BaseMMU::Mode mode,
                 bool &delayedResponse, bool timing);
 
+        /**
+         * Shiming: the protection checks and physical address of a paged
+         *  translation of vaddr (segmentation applied) once its entry is
+         *  known. finalizePhysical() is left to the caller.
+         */
+        Fault translateWithEntry(const RequestPtr &req, ThreadContext *tc,
+                BaseMMU::Mode mode, Addr vaddr, const TlbEntry &entry);
+
       // Shiming: expose public function
       public:
         void increasePageWalkLat(Tick lat) { stats.pageWalkTotalLat += lat; }
 
-      public:
+      protected:
+        /**
+         * Shiming: finish a timing translation that hit in the STLB, once
+         *  the STLB has responded, with a copy of the STLB entry. The
+         *  entry is put in this TLB then, and the translation is not
+         *  looked up (nor counted) again.
+         */
+        void finishStlbHit(const RequestPtr &req, ThreadContext *tc,
+                BaseMMU::Translation *translation, BaseMMU::Mode mode,
+                Addr vaddr, const TlbEntry &stlb_entry);
 
-        void evictLRU();
+      public:
 
         uint64_t
         nextSeq()
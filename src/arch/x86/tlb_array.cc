@@ -0,0 +1,359 @@
+/**
+ * 2023 Feb
+ * Shiming Li
+ * shiming.li@it.uu.se
+ *
+ * Uppsala Architecture Research Team (UART)
+ * Uppsala University
+ *
+ * The entry arrays of a TLB, see tlb_array.hh.
+ */
+
+#include "arch/x86/tlb_array.hh"
+
+#include <algorithm>
+
+#include "base/intmath.hh"
+#include "base/logging.hh"
+#include "base/str.hh"
+
+namespace gem5
+{
+
+namespace X86ISA
+{
+
+TlbArray::TlbArray(std::string _name, uint32_t _size, uint32_t _assoc,
+        replacement_policy::Base *_rp, uint64_t *lru_seq)
+    : myName(_name), size(_size), tlb(_size),
+      assoc((_assoc == 0 || _assoc > _size) ? _size : _assoc),
+      replacementPolicy(_rp), numValid(0), lruSeq(lru_seq)
+{
+    fatal_if(size == 0, "%s: TLBs must have a non-zero size.", name());
+    fatal_if(size % assoc != 0, "%s: size (%d) must be a multiple of the "
+            "associativity (%d)", name(), size, assoc);
+    numSets = size / assoc;
+    fatal_if(!isPowerOf2(numSets), "%s: number of sets (%d) must be a "
+            "power of 2", name(), numSets);
+    setBits = floorLog2(numSets);
+
+    sets.resize(numSets);
+    replEntries.resize(replacementPolicy ? size : 0);
+    lruPrev.resize(size);
+    lruNext.resize(size);
+    lruHead.assign(numSets, NoEntry);
+    lruTail.assign(numSets, NoEntry);
+    for (uint32_t x = 0; x < size; x++) {
+        tlb[x].trieHandle = NULL;
+        if (replacementPolicy) {
+            replEntries[x].setPosition(x / assoc, x % assoc);
+            replEntries[x].replacementData =
+                replacementPolicy->instantiateEntry();
+            sets[x / assoc].push_back(&replEntries[x]);
+        }
+        lruPushBack(x);
+    }
+}
+
+uint32_t
+TlbArray::getSet(Addr vpn, unsigned log_bytes) const
+{
+    // XOR-fold the page number like the pwc does, so that regular strides
+    //  spread over the sets
+    Addr pn = vpn >> log_bytes;
+    return (pn ^ (pn >> setBits)) & (numSets - 1);
+}
+
+void
+TlbArray::lruUnlink(uint32_t idx)
+{
+    uint32_t set = idx / assoc;
+    if (lruPrev[idx] != NoEntry)
+        lruNext[lruPrev[idx]] = lruNext[idx];
+    else
+        lruHead[set] = lruNext[idx];
+    if (lruNext[idx] != NoEntry)
+        lruPrev[lruNext[idx]] = lruPrev[idx];
+    else
+        lruTail[set] = lruPrev[idx];
+}
+
+void
+TlbArray::lruPushFront(uint32_t idx)
+{
+    uint32_t set = idx / assoc;
+    lruPrev[idx] = NoEntry;
+    lruNext[idx] = lruHead[set];
+    if (lruHead[set] != NoEntry)
+        lruPrev[lruHead[set]] = idx;
+    else
+        lruTail[set] = idx;
+    lruHead[set] = idx;
+}
+
+void
+TlbArray::lruPushBack(uint32_t idx)
+{
+    uint32_t set = idx / assoc;
+    lruNext[idx] = NoEntry;
+    lruPrev[idx] = lruTail[set];
+    if (lruTail[set] != NoEntry)
+        lruNext[lruTail[set]] = idx;
+    else
+        lruHead[set] = idx;
+    lruTail[set] = idx;
+}
+
+void
+TlbArray::touch(TlbEntry *entry)
+{
+    entry->lruSeq = ++*lruSeq;
+    uint32_t idx = indexOf(entry);
+    if (replacementPolicy) {
+        replacementPolicy->touch(replEntries[idx].replacementData);
+    } else {
+        lruUnlink(idx);
+        lruPushFront(idx);
+    }
+}
+
+void
+TlbArray::invalidate(TlbEntry *entry)
+{
+    assert(entry->trieHandle);
+    trie.remove(entry->trieHandle);
+    entry->trieHandle = NULL;
+    numValid--;
+    uint32_t idx = indexOf(entry);
+    if (replacementPolicy) {
+        replacementPolicy->invalidate(replEntries[idx].replacementData);
+    } else {
+        // Free entries are found at the LRU end
+        lruUnlink(idx);
+        lruPushBack(idx);
+    }
+}
+
+TlbEntry *
+TlbArray::getVictim(uint32_t set)
+{
+    TlbEntry *victim;
+    if (replacementPolicy) {
+        victim = nullptr;
+        for (ReplaceableEntry *way : sets[set]) {
+            TlbEntry *candidate = &tlb[way->getSet() * assoc + way->getWay()];
+            if (!candidate->trieHandle) {
+                victim = candidate;
+                break;
+            }
+        }
+        if (!victim) {
+            ReplaceableEntry *way = replacementPolicy->getVictim(sets[set]);
+            victim = &tlb[way->getSet() * assoc + way->getWay()];
+        }
+    } else {
+        victim = &tlb[lruTail[set]];
+    }
+
+    if (victim->trieHandle)
+        invalidate(victim);
+    return victim;
+}
+
+TlbEntry *
+TlbArray::lookup(Addr va, bool update_lru)
+{
+    TlbEntry *entry = trie.lookup(va);
+    if (entry && update_lru)
+        touch(entry);
+    return entry;
+}
+
+TlbEntry *
+TlbArray::insert(Addr vpn, const TlbEntry &entry, bool match_page)
+{
+    // If somebody beat us to it, just use that existing entry.
+    TlbEntry *newEntry = trie.lookup(vpn);
+    if (newEntry) {
+        assert(newEntry->vaddr == vpn);
+        return newEntry;
+    }
+
+    newEntry = getVictim(getSet(vpn, entry.logBytes));
+
+    *newEntry = entry;
+    newEntry->vaddr = vpn;
+    newEntry->trieHandle = trie.insert(vpn,
+            match_page ? TlbEntryTrie::MaxBits - entry.logBytes
+                       : TlbEntryTrie::MaxBits, newEntry);
+    numValid++;
+    if (replacementPolicy) {
+        newEntry->lruSeq = ++*lruSeq;
+        replacementPolicy->reset(
+                replEntries[indexOf(newEntry)].replacementData);
+    } else {
+        touch(newEntry);
+    }
+    return newEntry;
+}
+
+void
+TlbArray::flushAll()
+{
+    for (uint32_t i = 0; i < size; i++) {
+        if (tlb[i].trieHandle) {
+            invalidate(&tlb[i]);
+        }
+    }
+}
+
+void
+TlbArray::flushNonGlobal()
+{
+    for (uint32_t i = 0; i < size; i++) {
+        if (tlb[i].trieHandle && !tlb[i].global) {
+            invalidate(&tlb[i]);
+        }
+    }
+}
+
+void
+TlbArray::demapPage(Addr va)
+{
+    TlbEntry *entry = trie.lookup(va);
+    if (entry) {
+        invalidate(entry);
+    }
+}
+
+std::vector<const TlbEntry *>
+TlbArray::validEntries() const
+{
+    std::vector<const TlbEntry *> entries;
+    for (uint32_t i = 0; i < size; i++) {
+        if (tlb[i].trieHandle) {
+            entries.push_back(&tlb[i]);
+        }
+    }
+    return entries;
+}
+
+TlbArrays::TlbArrays(std::string _name, uint32_t size_4k, uint32_t assoc_4k,
+        uint32_t size_2m, uint32_t assoc_2m,
+        uint32_t size_1g, uint32_t assoc_1g,
+        replacement_policy::Base *rp, uint64_t *lru_seq)
+    : array4k(new TlbArray(_name, size_4k, assoc_4k, rp, lru_seq)),
+      array2m(size_2m ? new TlbArray(_name + ".2M", size_2m, assoc_2m, rp,
+                  lru_seq) : nullptr),
+      array1g(size_1g ? new TlbArray(_name + ".1G", size_1g, assoc_1g, rp,
+                  lru_seq) : nullptr)
+{
+    arrays.push_back(array4k.get());
+    if (array2m)
+        arrays.push_back(array2m.get());
+    if (array1g)
+        arrays.push_back(array1g.get());
+}
+
+TlbArray *
+TlbArrays::arrayFor(unsigned log_bytes)
+{
+    // Legacy 4M pages go with the 2M ones
+    if (log_bytes >= 30 && array1g)
+        return array1g.get();
+    if (log_bytes >= 21 && log_bytes < 30 && array2m)
+        return array2m.get();
+    return array4k.get();
+}
+
+TlbEntry *
+TlbArrays::lookup(Addr va, bool update_lru)
+{
+    for (TlbArray *array : arrays) {
+        TlbEntry *entry = array->lookup(va, update_lru);
+        if (entry)
+            return entry;
+    }
+    return nullptr;
+}
+
+TlbEntry *
+TlbArrays::insert(Addr vpn, const TlbEntry &entry, bool match_page)
+{
+    return arrayFor(entry.logBytes)->insert(vpn, entry, match_page);
+}
+
+void
+TlbArrays::flushAll()
+{
+    for (TlbArray *array : arrays)
+        array->flushAll();
+}
+
+void
+TlbArrays::flushNonGlobal()
+{
+    for (TlbArray *array : arrays)
+        array->flushNonGlobal();
+}
+
+void
+TlbArrays::demapPage(Addr va)
+{
+    for (TlbArray *array : arrays)
+        array->demapPage(va);
+}
+
+uint32_t
+TlbArrays::capacity() const
+{
+    uint32_t total = 0;
+    for (const TlbArray *array : arrays)
+        total += array->capacity();
+    return total;
+}
+
+void
+TlbArrays::serialize(CheckpointOut &cp) const
+{
+    // Only store the entries in use.
+    std::vector<const TlbEntry *> entries;
+    for (const TlbArray *array : arrays) {
+        std::vector<const TlbEntry *> valid = array->validEntries();
+        entries.insert(entries.end(), valid.begin(), valid.end());
+    }
+    uint32_t _size = entries.size();
+    SERIALIZE_SCALAR(_size);
+
+    uint32_t _count = 0;
+    for (const TlbEntry *entry : entries)
+        entry->serializeSection(cp, csprintf("Entry%d", _count++));
+}
+
+void
+TlbArrays::unserialize(CheckpointIn &cp)
+{
+    // Do not allow to restore with a smaller tlb.
+    uint32_t _size;
+    UNSERIALIZE_SCALAR(_size);
+    if (_size > capacity()) {
+        fatal("TLB size less than the one in checkpoint!");
+    }
+
+    std::vector<TlbEntry> entries(_size);
+    for (uint32_t x = 0; x < _size; x++) {
+        entries[x].unserializeSection(cp, csprintf("Entry%d", x));
+    }
+    // With fewer ways (or a smaller array for a page size) than in the
+    //  checkpoint, some of them may be evicted again.
+    std::stable_sort(entries.begin(), entries.end(),
+            [](const TlbEntry &a, const TlbEntry &b)
+            { return a.lruSeq < b.lruSeq; });
+    for (const TlbEntry &entry : entries) {
+        // Checkpoints always match on the page size
+        insert(entry.vaddr, entry, true);
+    }
+}
+
+} // namespace X86ISA
+} // namespace gem5
@@ -0,0 +1,160 @@
+/**
+ * 2023 Feb
+ * Shiming Li
+ * shiming.li@it.uu.se
+ *
+ * Uppsala Architecture Research Team (UART)
+ * Uppsala University
+ *
+ * The entry arrays of a TLB, split out of tlb.hh/tlb.cc so that the first
+ *  level TLBs and the shared STLB use the same storage. A TlbArray holds
+ *  the entries of one array; TlbArrays holds one array per page size
+ *  (4K, 2M and 1G), like the TLBs of recent Intel cores.
+ */
+
+#ifndef __ARCH_X86_TLB_ARRAY_HH__
+#define __ARCH_X86_TLB_ARRAY_HH__
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "arch/x86/pagetable.hh"
+#include "base/trie.hh"
+#include "base/types.hh"
+#include "mem/cache/replacement_policies/base.hh"
+#include "mem/cache/replacement_policies/replaceable_entry.hh"
+#include "sim/serialize.hh"
+
+namespace gem5
+{
+
+namespace X86ISA
+{
+    /**
+     * The entries are organized as numSets x assoc (a single set is fully
+     *  associative). Lookups go through the trie, which matches the whole
+     *  page of an entry, so the sets only decide where an entry goes and
+     *  what it can evict.
+     */
+    class TlbArray
+    {
+      private:
+        std::string myName;
+
+        uint32_t size;
+        std::vector<TlbEntry> tlb;
+
+        uint32_t assoc;
+        uint32_t numSets;
+        unsigned setBits;
+
+        /**
+         * Victim selection among the ways of a set. If null, an exact LRU
+         *  is kept per set as a list of tlb[] indices, with the invalid
+         *  entries at the LRU end, so that fills and hits are O(1).
+         */
+        replacement_policy::Base *replacementPolicy;
+        std::vector<ReplaceableEntry> replEntries;
+        std::vector<ReplacementCandidates> sets;
+
+        static constexpr uint32_t NoEntry = (uint32_t)-1;
+        std::vector<uint32_t> lruPrev;
+        std::vector<uint32_t> lruNext;
+        std::vector<uint32_t> lruHead;
+        std::vector<uint32_t> lruTail;
+
+        uint32_t numValid;
+
+        TlbEntryTrie trie;
+        /** Sequence numbers of the owner, kept in the entries' lruSeq */
+        uint64_t *lruSeq;
+
+      private:
+        uint32_t getSet(Addr vpn, unsigned log_bytes) const;
+        uint32_t indexOf(const TlbEntry *entry) const
+        {
+            return entry - tlb.data();
+        }
+        /** Pick the entry of the set to fill, evicting it if valid */
+        TlbEntry *getVictim(uint32_t set);
+        /** Make entry the most recently used of its set */
+        void touch(TlbEntry *entry);
+        void lruUnlink(uint32_t idx);
+        void lruPushFront(uint32_t idx);
+        void lruPushBack(uint32_t idx);
+
+      public:
+        /**
+         * @param _assoc Number of ways per set, 0 (or _size) means fully
+         *  associative.
+         * @param _rp Replacement policy, nullptr selects the exact LRU.
+         */
+        TlbArray(std::string _name, uint32_t _size, uint32_t _assoc,
+                replacement_policy::Base *_rp, uint64_t *lru_seq);
+
+        TlbEntry *lookup(Addr va, bool update_lru = true);
+        /**
+         * Place a copy of entry at vpn, unless there already is one.
+         * @param match_page Match any address of the page, instead of
+         *  vpn only.
+         */
+        TlbEntry *insert(Addr vpn, const TlbEntry &entry, bool match_page);
+        void invalidate(TlbEntry *entry);
+
+        void flushAll();
+        void flushNonGlobal();
+        void demapPage(Addr va);
+
+        uint32_t capacity() const { return size; }
+        uint32_t valid() const { return numValid; }
+        /** The valid entries, for checkpointing */
+        std::vector<const TlbEntry *> validEntries() const;
+
+        std::string name() const { return myName; }
+    };
+
+    /**
+     * A TLB made of one array per page size. A 2M or 1G array of size 0
+     *  means that those pages share the 4K array, which is the default
+     *  (a single array for all page sizes).
+     */
+    class TlbArrays
+    {
+      private:
+        std::unique_ptr<TlbArray> array4k;
+        std::unique_ptr<TlbArray> array2m;
+        std::unique_ptr<TlbArray> array1g;
+        /** The distinct arrays, in lookup order */
+        std::vector<TlbArray *> arrays;
+
+        TlbArray *arrayFor(unsigned log_bytes);
+
+      public:
+        TlbArrays(std::string _name, uint32_t size_4k, uint32_t assoc_4k,
+                uint32_t size_2m, uint32_t assoc_2m,
+                uint32_t size_1g, uint32_t assoc_1g,
+                replacement_policy::Base *rp, uint64_t *lru_seq);
+
+        TlbEntry *lookup(Addr va, bool update_lru = true);
+        TlbEntry *insert(Addr vpn, const TlbEntry &entry, bool match_page);
+
+        void flushAll();
+        void flushNonGlobal();
+        void demapPage(Addr va);
+
+        uint32_t capacity() const;
+
+        /**
+         * Checkpoint the entries of all arrays in one list, as a TLB with
+         *  a single array did. Restoring fills them from the least
+         *  recently used, so that the LRU order is rebuilt.
+         */
+        void serialize(CheckpointOut &cp) const;
+        void unserialize(CheckpointIn &cp);
+    };
+
+} // namespace X86ISA
+} // namespace gem5
+
+#endif // __ARCH_X86_TLB_ARRAY_HH__
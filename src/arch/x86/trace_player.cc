@@ -0,0 +1,410 @@
+/**
+ * 2023 Feb
+ * Shiming Li
+ * shiming.li@it.uu.se
+ *
+ * Uppsala Architecture Research Team (UART)
+ * Uppsala University
+ *
+ * The trace driven translation model, see trace_player.hh.
+ */
+
+#include "arch/x86/trace_player.hh"
+
+#include <cstring>
+
+#include "arch/x86/isa.hh"
+#include "arch/x86/ldstflags.hh"
+#include "arch/x86/mmu.hh"
+#include "arch/x86/page_size.hh"
+#include "arch/x86/pagetable.hh"
+#include "arch/x86/regs/misc.hh"
+#include "arch/x86/regs/segment.hh"
+#include "arch/x86/types.hh"
+#include "base/bitfield.hh"
+#include "base/intmath.hh"
+#include "base/logging.hh"
+#include "base/trace.hh"
+#include "cpu/simple_thread.hh"
+#include "debug/TLB.hh"
+#include "mem/packet.hh"
+#include "sim/byteswap.hh"
+#include "sim/sim_exit.hh"
+#include "sim/system.hh"
+
+#if HAVE_PROTOBUF
+#include "proto/packet.pb.h"
+
+#endif
+
+namespace gem5
+{
+
+namespace X86ISA
+{
+
+namespace
+{
+
+// Bits of the virtual address decoded by each level
+constexpr unsigned LevelBits = 9;
+// Data pages go far above the page tables, which are allocated from 4K up
+constexpr Addr PageBase = 1ULL << 40;
+
+} // anonymous namespace
+
+unsigned TranslationTracePlayer::numActive = 0;
+
+TranslationTracePlayer::PageTablePort::PageTablePort(
+        const std::string &name, TranslationTracePlayer &player, PortID id)
+    : QueuedResponsePort(name, &player, queue, id),
+      queue(player, *this), player(player)
+{
+}
+
+Tick
+TranslationTracePlayer::PageTablePort::recvAtomic(PacketPtr pkt)
+{
+    player.access(pkt);
+    return player.cyclesToTicks(player.walkReadLatency);
+}
+
+void
+TranslationTracePlayer::PageTablePort::recvFunctional(PacketPtr pkt)
+{
+    player.access(pkt);
+}
+
+bool
+TranslationTracePlayer::PageTablePort::recvTimingReq(PacketPtr pkt)
+{
+    player.access(pkt);
+    if (pkt->isResponse()) {
+        schedTimingResp(pkt, player.clockEdge(player.walkReadLatency));
+    } else {
+        delete pkt;
+    }
+    return true;
+}
+
+AddrRangeList
+TranslationTracePlayer::PageTablePort::getAddrRanges() const
+{
+    return {AddrRange(0, MaxAddr)};
+}
+
+TranslationTracePlayer::TranslationTracePlayer(const Params &p)
+    : ClockedObject(p), system(p.system), mmu(p.mmu), isa(p.isa),
+      requestorId(p.system->getRequestorId(this)),
+      traceFile(p.trace_file), traceFormat(p.trace_format),
+      maxAccesses(p.max_accesses), la57(p.la57),
+      pageShift(floorLog2(p.page_size)),
+      walkReadLatency(p.walk_read_latency),
+      topLevel(p.la57 ? 5 : 4),
+      leafLevel(1 + (pageShift - PageShift) / LevelBits),
+      rootTable(PageBytes), nextTable(2 * PageBytes), nextPage(PageBase),
+      bufferPos(0), bufferLen(0), replayed(0), waiting(false),
+      delayed(false), issueTick(0),
+      replayEvent([this]{ replay(); }, name() + ".replay"),
+      stats(this)
+{
+    fatal_if(pageShift != 12 && pageShift != 21 && pageShift != 30,
+            "%s: page_size must be 4KiB, 2MiB or 1GiB", name());
+    fatal_if(traceFormat == X86TraceFormat::protobuf &&
+            !p.protobuf_virtual_addresses,
+            "%s: the packet traces of gem5 hold physical addresses, set "
+            "protobuf_virtual_addresses if %s holds virtual ones", name(),
+            traceFile);
+
+    for (int i = 0; i < p.port_walker_ports_connection_count; i++) {
+        walkerPorts.emplace_back(new PageTablePort(
+                csprintf("%s.walker_ports[%d]", name(), i), *this, i));
+    }
+
+    stats.avgDelayedLatency =
+        stats.delayedTicks / stats.delayedTranslations;
+}
+
+TranslationTracePlayer::~TranslationTracePlayer()
+{
+}
+
+TranslationTracePlayer::TracePlayerStats::TracePlayerStats(
+        statistics::Group *parent)
+  : statistics::Group(parent),
+    ADD_STAT(accesses, statistics::units::Count::get(),
+             "Virtual addresses replayed"),
+    ADD_STAT(pagesMapped, statistics::units::Count::get(),
+             "Distinct pages of the trace"),
+    ADD_STAT(tablesMapped, statistics::units::Count::get(),
+             "Page table pages below the root"),
+    ADD_STAT(pteReads, statistics::units::Count::get(),
+             "Page table entries read by the walkers"),
+    ADD_STAT(pteWrites, statistics::units::Count::get(),
+             "Page table entries written by the walkers"),
+    ADD_STAT(delayedTranslations, statistics::units::Count::get(),
+             "Timing translations not done on the TLB lookup (walks and "
+             "STLB hits)"),
+    ADD_STAT(delayedTicks, statistics::units::Tick::get(),
+             "Ticks of the delayed translations"),
+    ADD_STAT(avgDelayedLatency, statistics::units::Rate<
+                statistics::units::Tick, statistics::units::Count>::get(),
+             "Average ticks per delayed translation")
+{
+}
+
+Port &
+TranslationTracePlayer::getPort(const std::string &if_name, PortID idx)
+{
+    if (if_name == "walker_ports" && idx < walkerPorts.size()) {
+        return *walkerPorts[idx];
+    }
+    return ClockedObject::getPort(if_name, idx);
+}
+
+void
+TranslationTracePlayer::init()
+{
+    ClockedObject::init();
+    fatal_if(!FullSystem, "%s: the TLBs only walk in full system mode",
+            name());
+
+    // A 64-bit thread in user mode, with paging on and the root table in
+    //  CR3. The MMU only reads these registers.
+    thread.reset(new SimpleThread(nullptr, 0, system, mmu, isa, nullptr));
+    isa->setThreadContext(thread.get());
+
+    CR0 cr0 = thread->readMiscRegNoEffect(misc_reg::Cr0);
+    cr0.pe = 1;
+    cr0.pg = 1;
+    cr0.wp = 1;
+    thread->setMiscRegNoEffect(misc_reg::Cr0, cr0);
+    CR3 cr3 = 0;
+    cr3.longPdtb = rootTable >> PageShift;
+    thread->setMiscRegNoEffect(misc_reg::Cr3, cr3);
+    CR4 cr4 = 0;
+    cr4.pae = 1;
+    cr4.la57 = la57;
+    thread->setMiscRegNoEffect(misc_reg::Cr4, cr4);
+    Efer efer = 0;
+    efer.lme = 1;
+    efer.lma = 1;
+    thread->setMiscRegNoEffect(misc_reg::Efer, efer);
+    HandyM5Reg m5reg = 0;
+    m5reg.mode = LongMode;
+    m5reg.submode = SixtyFourBitMode;
+    m5reg.cpl = 3;
+    m5reg.paging = 1;
+    m5reg.prot = 1;
+    m5reg.defOp = 2;
+    m5reg.altOp = 1;
+    m5reg.defAddr = 3;
+    m5reg.altAddr = 2;
+    m5reg.stack = 3;
+    thread->setMiscRegNoEffect(misc_reg::M5Reg, m5reg);
+}
+
+void
+TranslationTracePlayer::map(Addr va)
+{
+    Addr table = rootTable;
+    for (unsigned level = topLevel; ; level--) {
+        unsigned shift = PageShift + LevelBits * (level - 1);
+        Addr pte_addr = table +
+            bits(va, shift + LevelBits - 1, shift) * sizeof(uint64_t);
+        auto it = ptes.find(pte_addr);
+        if (it != ptes.end()) {
+            if (level == leafLevel) {
+                return;
+            }
+            table = (Addr)PageTableEntry(it->second).base << PageShift;
+            continue;
+        }
+
+        PageTableEntry pte = 0;
+        pte.p = 1;
+        pte.w = 1;
+        pte.u = 1;
+        pte.a = 1;
+        if (level == leafLevel) {
+            pte.base = nextPage >> PageShift;
+            pte.ps = level > 1;
+            pte.d = 1;
+            nextPage += 1ULL << pageShift;
+            stats.pagesMapped++;
+            ptes.emplace(pte_addr, pte);
+            return;
+        }
+        table = nextTable;
+        nextTable += PageBytes;
+        fatal_if(nextTable > PageBase, "%s: out of page table memory",
+                name());
+        stats.tablesMapped++;
+        pte.base = table >> PageShift;
+        ptes.emplace(pte_addr, pte);
+    }
+}
+
+void
+TranslationTracePlayer::access(PacketPtr pkt)
+{
+    fatal_if(pkt->getAddr() % sizeof(uint64_t) ||
+            pkt->getSize() % sizeof(uint64_t),
+            "%s: %s is not made of page table entries", name(),
+            pkt->print());
+    uint8_t *data = pkt->getPtr<uint8_t>();
+    for (unsigned offset = 0; offset < pkt->getSize();
+            offset += sizeof(uint64_t)) {
+        Addr addr = pkt->getAddr() + offset;
+        uint64_t pte;
+        if (pkt->isRead()) {
+            auto it = ptes.find(addr);
+            pte = htole(it == ptes.end() ? 0 : it->second);
+            std::memcpy(data + offset, &pte, sizeof(pte));
+            stats.pteReads++;
+        } else if (pkt->isWrite()) {
+            std::memcpy(&pte, data + offset, sizeof(pte));
+            ptes[addr] = letoh(pte);
+            stats.pteWrites++;
+        }
+    }
+    if (pkt->needsResponse()) {
+        pkt->makeResponse();
+    }
+}
+
+void
+TranslationTracePlayer::openTrace()
+{
+    if (traceFormat == X86TraceFormat::protobuf) {
+#if HAVE_PROTOBUF
+        // Packet traces, as recorded by the memory trace probes or played
+        //  by the traffic generators, with virtual addresses
+        protobufTrace.reset(new ProtoInputStream(traceFile));
+        ProtoMessage::PacketHeader header_msg;
+        fatal_if(!protobufTrace->read(header_msg), "%s: failed to read the "
+                "packet header of %s", name(), traceFile);
+#else
+        fatal("%s: protobuf traces need a build with protobuf support",
+                name());
+#endif
+    } else {
+        // Compact format: little endian 64-bit virtual addresses, no header
+        binaryTrace.open(traceFile, std::ios::binary);
+        fatal_if(!binaryTrace, "%s: cannot open trace %s", name(),
+                traceFile);
+        buffer.resize(4096);
+    }
+}
+
+bool
+TranslationTracePlayer::nextAccess(Addr &va, BaseMMU::Mode &mode)
+{
+    if (maxAccesses && replayed == maxAccesses) {
+        return false;
+    }
+    if (traceFormat == X86TraceFormat::protobuf) {
+#if HAVE_PROTOBUF
+        ProtoMessage::Packet pkt_msg;
+        if (!protobufTrace->read(pkt_msg)) {
+            return false;
+        }
+        va = pkt_msg.addr();
+        mode = MemCmd(pkt_msg.cmd()).isWrite() ?
+            BaseMMU::Write : BaseMMU::Read;
+#endif
+    } else {
+        if (bufferPos == bufferLen) {
+            binaryTrace.read(reinterpret_cast<char *>(buffer.data()),
+                    buffer.size() * sizeof(uint64_t));
+            bufferLen = binaryTrace.gcount() / sizeof(uint64_t);
+            bufferPos = 0;
+            if (!bufferLen) {
+                return false;
+            }
+        }
+        va = letoh(buffer[bufferPos++]);
+        mode = BaseMMU::Read;
+    }
+    replayed++;
+    return true;
+}
+
+void
+TranslationTracePlayer::issue(Addr va, BaseMMU::Mode mode)
+{
+    // Keep the bits the page table decodes, so that any canonical form
+    //  of an address maps the same page
+    va = bits(va, PageShift + LevelBits * topLevel - 1, 0);
+    map(va);
+    stats.accesses++;
+
+    // A data access of a 64-bit address, with no segment base
+    Request::Flags flags = segment_idx::Ds | (3 << AddrSizeFlagShift);
+    RequestPtr req = std::make_shared<Request>(va, 1, flags, requestorId,
+            0, thread->contextId());
+    if (system->isTimingMode()) {
+        waiting = true;
+        delayed = false;
+        issueTick = curTick();
+        mmu->translateTiming(req, thread.get(), this, mode);
+    } else {
+        checkFault(mmu->translateAtomic(req, thread.get(), mode), req);
+    }
+}
+
+void
+TranslationTracePlayer::checkFault(const Fault &fault,
+        const RequestPtr &req)
+{
+    // Every page of the trace is mapped before it is translated
+    panic_if(fault != NoFault, "%s: translating %#x faulted: %s", name(),
+            req->getVaddr(), fault->name());
+}
+
+void
+TranslationTracePlayer::finish(const Fault &fault, const RequestPtr &req,
+        ThreadContext *tc, BaseMMU::Mode mode)
+{
+    checkFault(fault, req);
+    assert(waiting);
+    waiting = false;
+    if (delayed) {
+        stats.delayedTranslations++;
+        stats.delayedTicks += curTick() - issueTick;
+        // Called back by the walker or the STLB, carry on from an event
+        schedule(replayEvent, curTick());
+    }
+}
+
+void
+TranslationTracePlayer::replay()
+{
+    // TLB hits finish in translateTiming(), the next access goes on at
+    //  once. The others finish later, from finish().
+    Addr va;
+    BaseMMU::Mode mode;
+    while (!waiting) {
+        if (!nextAccess(va, mode)) {
+            DPRINTF(TLB, "%s: replayed %d accesses of %s.\n", name(),
+                    replayed, traceFile);
+            assert(numActive > 0);
+            if (--numActive == 0) {
+                exitSimLoop("translation trace replayed");
+            }
+            return;
+        }
+        issue(va, mode);
+    }
+}
+
+void
+TranslationTracePlayer::startup()
+{
+    openTrace();
+    numActive++;
+    schedule(replayEvent, curTick());
+}
+
+} // namespace X86ISA
+} // namespace gem5
@@ -0,0 +1,181 @@
+/**
+ * 2023 Feb
+ * Shiming Li
+ * shiming.li@it.uu.se
+ *
+ * Uppsala Architecture Research Team (UART)
+ * Uppsala University
+ *
+ * A trace driven model of the translation path, to evaluate TLB and pwc
+ *  configurations without a CPU. It replays the virtual addresses of a
+ *  trace through a real X86MMU: its TLBs, walkers and page structure
+ *  caches, with all their options (STLB, pwc ports, shared pwc, line
+ *  fills, prefetches and nested walks). The player is the requestor of
+ *  the translations, atomic or timing as the system memory mode, and the
+ *  memory of the walkers: their reads are served from a functional long
+ *  mode page table after a fixed latency. Pages are mapped on first
+ *  touch, as the SE mode page table does.
+ *
+ * The trace holds virtual addresses. Note that the packet traces of gem5
+ *  (the memory trace probes, the elastic traces) record the physical
+ *  addresses of the packets: protobuf traces are only replayed when they
+ *  are declared to hold virtual addresses.
+ *
+ * Several players can be put under one system to sweep configurations in
+ *  a single run, see configs/example/translation_trace.py.
+ */
+
+#ifndef __ARCH_X86_TRACE_PLAYER_HH__
+#define __ARCH_X86_TRACE_PLAYER_HH__
+
+#include <fstream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "arch/generic/mmu.hh"
+#include "base/types.hh"
+#include "config/have_protobuf.hh"
+#include "mem/qport.hh"
+#include "params/X86TranslationTracePlayer.hh"
+#include "sim/clocked_object.hh"
+#include "sim/eventq.hh"
+#include "sim/stats.hh"
+
+#if HAVE_PROTOBUF
+#include "proto/protoio.hh"
+
+#endif
+
+namespace gem5
+{
+
+class SimpleThread;
+class System;
+
+namespace X86ISA
+{
+    class ISA;
+    class MMU;
+
+    class TranslationTracePlayer : public ClockedObject,
+                                   public BaseMMU::Translation
+    {
+      private:
+        /** Serves the page table reads and writes of a walker */
+        class PageTablePort : public QueuedResponsePort
+        {
+          private:
+            RespPacketQueue queue;
+            TranslationTracePlayer &player;
+
+          public:
+            PageTablePort(const std::string &name,
+                          TranslationTracePlayer &player, PortID id);
+
+          protected:
+            Tick recvAtomic(PacketPtr pkt) override;
+            void recvFunctional(PacketPtr pkt) override;
+            bool recvTimingReq(PacketPtr pkt) override;
+            AddrRangeList getAddrRanges() const override;
+        };
+
+        System *system;
+        MMU *mmu;
+        ISA *isa;
+        /** The context of the translations, holding the paging registers */
+        std::unique_ptr<SimpleThread> thread;
+        const RequestorID requestorId;
+
+        const std::string traceFile;
+        const X86TraceFormat traceFormat;
+        /** Stop after this many accesses, 0 replays the whole trace */
+        const uint64_t maxAccesses;
+        const bool la57;
+        /** Page size of all the mappings, as a shift (12, 21 or 30) */
+        const unsigned pageShift;
+        const Cycles walkReadLatency;
+
+        /** Levels of the walk, PT is 1 and PML4 (PML5 with LA57) the top */
+        const unsigned topLevel;
+        /** Level of the leaf PTEs, from the page size */
+        const unsigned leafLevel;
+
+        /**
+         * The functional page table: the entries written so far, by their
+         *  physical address. The others read as not present.
+         */
+        std::unordered_map<Addr, uint64_t> ptes;
+        Addr rootTable;
+        Addr nextTable;
+        Addr nextPage;
+
+        std::vector<std::unique_ptr<PageTablePort>> walkerPorts;
+
+        /** The trace, read as the accesses are issued */
+        std::ifstream binaryTrace;
+        std::vector<uint64_t> buffer;
+        size_t bufferPos;
+        size_t bufferLen;
+#if HAVE_PROTOBUF
+        std::unique_ptr<ProtoInputStream> protobufTrace;
+#endif
+        uint64_t replayed;
+
+        /** A timing translation is in flight */
+        bool waiting;
+        /** It was left to the walker, or to the STLB */
+        bool delayed;
+        Tick issueTick;
+
+        EventFunctionWrapper replayEvent;
+        /** Players that have not finished their trace yet */
+        static unsigned numActive;
+
+        struct TracePlayerStats : public statistics::Group
+        {
+            TracePlayerStats(statistics::Group *parent);
+
+            statistics::Scalar accesses;
+            statistics::Scalar pagesMapped;
+            statistics::Scalar tablesMapped;
+            statistics::Scalar pteReads;
+            statistics::Scalar pteWrites;
+            statistics::Scalar delayedTranslations;
+            statistics::Scalar delayedTicks;
+            statistics::Formula avgDelayedLatency;
+        } stats;
+
+        /** Map the page of va, and the tables on the way, if needed */
+        void map(Addr va);
+        /** Read or write the PTEs of a walker packet */
+        void access(PacketPtr pkt);
+
+        void openTrace();
+        /** @return false at the end of the trace */
+        bool nextAccess(Addr &va, BaseMMU::Mode &mode);
+        void issue(Addr va, BaseMMU::Mode mode);
+        void checkFault(const Fault &fault, const RequestPtr &req);
+        void replay();
+
+      public:
+        typedef X86TranslationTracePlayerParams Params;
+        TranslationTracePlayer(const Params &p);
+        ~TranslationTracePlayer();
+
+        Port &getPort(const std::string &if_name,
+                      PortID idx = InvalidPortID) override;
+
+        void init() override;
+        void startup() override;
+
+        void markDelayed() override { delayed = true; }
+        void finish(const Fault &fault, const RequestPtr &req,
+                    ThreadContext *tc, BaseMMU::Mode mode) override;
+    };
+
+} // namespace X86ISA
+} // namespace gem5
+
+#endif // __ARCH_X86_TRACE_PLAYER_HH__
@@ -10,115 +10,322 @@
  *  http://kib.kiev.ua/x86docs/Intel/WhitePapers/317080-002.pdf. Code is
  *  based on tlb.hh and tlb.cc.
  *
- * It should be fine to not use Serializable for checkpointing since these
- *  caches does not hold modified entries (i.e. they are write-through).
+ * The caches are write-through, their contents are only checkpointed to
+ *  restore them warm.
  */
 
 #include "arch/x86/translation_cache.hh"
 
-#include <list>
+#include <algorithm>
 #include <vector>
 
 #include "arch/x86/pagetable.hh" // Shiming: To use PageTableEntry
 #include "arch/x86/pagetable_walker.hh" // Shiming: To use State
 #include "base/bitfield.hh" // Shiming: To use mbit
-#include "base/trie.hh"
+#include "base/logging.hh"
 
 namespace gem5
 {
 namespace X86ISA
 {
-    void BaseTranslationCache::evictLRU() {
-        unsigned lru = 0;
-        for (unsigned i = 1; i < size; i++) {
-            if (tc[i].lruSeq < tc[lru].lruSeq) {
-                lru = i;
-            }
-        }
-
-        assert(tc[lru].trieHandle);
-        trie.remove(tc[lru].trieHandle);
-        tc[lru].trieHandle = NULL;
-        freeList.push_back(&tc[lru]);
-        stats.evict++;
-    }
+    uint64_t BaseTranslationCache::fills = 0;
 
     BaseTranslationCache::BaseTranslationCache(std::string _name,
-            uint32_t _size, unsigned _idx_mask_bits_h,
-            unsigned _idx_mask_bits_l)
-            : size(_size), myName(_name), idxMaskBitsH(_idx_mask_bits_h),
-                idxMaskBitsL(_idx_mask_bits_l), tc(_size) {
+            TranslationCacheStore *_shared_store, uint32_t _size,
+            uint32_t _assoc, replacement_policy::Base *_rp,
+            unsigned _idx_mask_bits_h, unsigned _idx_mask_bits_l)
+            : ownStore(_shared_store ? nullptr
+                    : new TranslationCacheStore(_name, _size, _assoc, _rp)),
+                store(_shared_store ? _shared_store : ownStore.get()),
+                myName(_name), idxMaskBitsH(_idx_mask_bits_h),
+                idxMaskBitsL(_idx_mask_bits_l) {
         addrMask = (~(Addr)0 >> idxMaskBitsH) & (~(Addr)0 << idxMaskBitsL);
-        for (int x = 0; x < size; x++) {
-            tc[x].trieHandle = NULL;
-            freeList.push_back(&tc[x]);
-        }
+        level = store->addLevel(
+                [this](const TranslationCacheEntry &entry) {
+                    evicted(entry);
+                }, &stats.occupancy);
+
         stats.flush.name(name() + ".flush");
+        stats.pcidFlush.name(name() + ".pcidFlush");
         stats.insert.name(name() + ".insert");
         stats.evict.name(name() + ".evict");
         stats.hit.name(name() + ".hit");
         stats.miss.name(name() + ".miss");
+        stats.occupancy.name(name() + ".occupancy");
+        stats.backInval.name(name() + ".backInval");
+        stats.victimFill.name(name() + ".victimFill");
+        stats.demapped.name(name() + ".demapped");
     }
 
     TranslationCacheEntry* BaseTranslationCache::insert(Addr vpn,
-                const ::gem5::X86ISA::PageTableEntry &ptentry, LegacyAcc la) {
+                uint16_t pcid, Addr root,
+                const ::gem5::X86ISA::PageTableEntry &ptentry,
+                LegacyAcc la, bool low_priority) {
         Addr idx = maskVpn(legacyMask(vpn, la));
+        // The next level first, so that what it drops for room (and drops
+        //  here too if inclusive) cannot be the entry filled here.
+        if (nextLevel && inclusion != EXCLUSIVE) {
+            useNext(nextLevel->insert(idx, pcid, root, ptentry));
+        }
+
         // If somebody beat us to it, just use that existing entry.
-        TranslationCacheEntry *newEntry = trie.lookup(idx);
+        TranslationCacheEntry *newEntry =
+            store->find(idx, pcid, root, level, idxMaskBitsL);
         if (newEntry) {
             assert(newEntry->index == idx);
             assert(newEntry->nextStepEntry == ptentry);
+            // Shiming: read again by a walk, so fresh for its core
+            newEntry->fillSeq = ++fills;
             return newEntry;
         }
 
-        if (freeList.empty()) {
-            evictLRU();
+        bool evicted;
+        newEntry = store->fill(idx, pcid, root, level, idxMaskBitsL,
+                ptentry, evicted);
+        newEntry->fillSeq = ++fills;
+        if (low_priority) {
+            store->demote(newEntry);
+        }
+        if (evicted) {
+            stats.evict++;
         }
-        newEntry = freeList.front();
-        freeList.pop_front();
-
-        newEntry->nextStepEntry = ptentry;
-        newEntry->lruSeq = nextSeq();
-        newEntry->index = idx;
-        newEntry->trieHandle =
-            trie.insert(idx,
-                TranslationCacheEntryTrie::MaxBits - getIdxMaskBitsL(),
-                newEntry);
         stats.insert++;
         return newEntry;
     }
 
     TranslationCacheEntry* BaseTranslationCache::lookup(Addr va,
-            LegacyAcc la, bool update_lru) {
-        TranslationCacheEntry* entry
-            = trie.lookup(maskVpn(legacyMask(va, la)));
+            uint16_t pcid, Addr root, LegacyAcc la, bool update_lru,
+            const BaseTranslationCache *user) {
+        TranslationCacheEntry* entry = probe(va, pcid, root, la, user);
         if (entry) {
-            stats.hit++;
-            if (update_lru) {
-                entry->lruSeq = nextSeq();
-            }
+            access(entry, update_lru);
         } else {
             stats.miss++;
         }
         return entry;
     }
 
+    TranslationCacheEntry* BaseTranslationCache::probe(Addr va,
+            uint16_t pcid, Addr root, LegacyAcc la,
+            const BaseTranslationCache *user) {
+        TranslationCacheEntry *entry = store->find(
+                maskVpn(legacyMask(va, la)), pcid, root, level,
+                idxMaskBitsL);
+        if (entry && user && !user->fresh(entry)) {
+            return nullptr;
+        }
+        return entry;
+    }
+
+    void BaseTranslationCache::access(TranslationCacheEntry *entry,
+            bool update_lru) {
+        assert(entry && entry->valid && entry->level == level);
+        stats.hit++;
+        if (update_lru) {
+            store->touch(entry);
+        }
+    }
+
+    void BaseTranslationCache::setNextLevel(BaseTranslationCache *next,
+            Inclusion _inclusion) {
+        assert(next && !nextLevel);
+        fatal_if(next->upperLevels.size() >= 64, "%s: at most 64 caches "
+                "can share %s", name(), next->name());
+        nextLevel = next;
+        upperIndex = next->upperLevels.size();
+        inclusion = _inclusion;
+        next->inclusion = _inclusion;
+        next->upperLevels.push_back(this);
+    }
+
+    TranslationCacheEntry* BaseTranslationCache::fillFromNextLevel(Addr va,
+            uint16_t pcid, Addr root, LegacyAcc la,
+            TranslationCacheEntry *next_entry) {
+        assert(nextLevel && next_entry->valid);
+        // Copy it first: filling here may evict into the next level
+        ::gem5::X86ISA::PageTableEntry pte = next_entry->nextStepEntry;
+        if (inclusion == EXCLUSIVE) {
+            nextLevel->store->invalidate(next_entry);
+        } else {
+            useNext(next_entry);
+        }
+        return insert(va, pcid, root, pte, la);
+    }
+
+    void BaseTranslationCache::useNext(TranslationCacheEntry *next_entry) {
+        next_entry->users = insertBits(next_entry->users, upperIndex, 1);
+    }
+
+    bool BaseTranslationCache::fresh(
+            const TranslationCacheEntry *next_entry) const {
+        if (next_entry->fillSeq <= flushSeq) {
+            return false;
+        }
+        auto it = pcidFlushSeq.find(next_entry->asid);
+        return it == pcidFlushSeq.end() || next_entry->fillSeq > it->second;
+    }
+
+    void BaseTranslationCache::evicted(const TranslationCacheEntry &entry) {
+        if (nextLevel && inclusion == EXCLUSIVE) {
+            // The index is already masked, which NONE leaves as is
+            TranslationCacheEntry *victim = nextLevel->insert(entry.index,
+                    entry.asid, entry.root, entry.nextStepEntry);
+            // Moved, not read again: as fresh as it was here
+            victim->fillSeq = entry.fillSeq;
+            useNext(victim);
+            stats.victimFill++;
+        } else if (inclusion == INCLUSIVE) {
+            for (BaseTranslationCache *upper : upperLevels) {
+                TranslationCacheEntry *copy = upper->store->find(entry.index,
+                        entry.asid, entry.root, upper->level,
+                        upper->idxMaskBitsL);
+                if (copy) {
+                    upper->store->invalidate(copy);
+                    upper->stats.backInval++;
+                }
+            }
+        }
+    }
+
+    void BaseTranslationCache::backInvalidate(bool match_pcid,
+            uint16_t pcid) {
+        if (inclusion != INCLUSIVE) {
+            return;
+        }
+        for (BaseTranslationCache *upper : upperLevels) {
+            upper->stats.backInval += upper->store->invalidateLevel(
+                    upper->level, match_pcid, pcid);
+            upper->invalidations++;
+        }
+    }
+
     void BaseTranslationCache::flush() {
         /**
          * On writes to CR3 (TLB flush non-global) or CR4 (TLB flush
          * all), TC should always flush all.
          */
-        for (unsigned i = 0; i < size; i++) {
-            if (tc[i].trieHandle) {
-                trie.remove(tc[i].trieHandle);
-                tc[i].trieHandle = NULL;
-                freeList.push_back(&tc[i]);
+        store->invalidateLevel(level);
+        stats.flush++;
+        invalidations++;
+        if (nextLevel) {
+            // Shiming: Local to this core, other cores keep their entries
+            nextLevel->store->dropUser(nextLevel->level, upperIndex);
+            flushSeq = fills;
+            pcidFlushSeq.clear();
+        }
+        backInvalidate(false, 0);
+    }
+
+    void BaseTranslationCache::flushPcid(uint16_t pcid) {
+        store->invalidateLevel(level, true, pcid);
+        stats.pcidFlush++;
+        invalidations++;
+        if (nextLevel) {
+            nextLevel->store->dropUser(nextLevel->level, upperIndex, true,
+                    pcid);
+            pcidFlushSeq[pcid] = fills;
+        }
+        backInvalidate(true, pcid);
+    }
+
+    void BaseTranslationCache::demap(Addr va, LegacyAcc la) {
+        Addr idx = maskVpn(legacyMask(va, la));
+        stats.demapped += store->invalidateIndex(level, idx, idxMaskBitsL);
+        invalidations++;
+        if (nextLevel) {
+            // The index is already masked, which NONE leaves as is
+            nextLevel->demap(idx);
+        }
+        if (inclusion == INCLUSIVE) {
+            for (BaseTranslationCache *upper : upperLevels) {
+                upper->stats.backInval += upper->store->invalidateIndex(
+                        upper->level, idx, upper->idxMaskBitsL);
+                upper->invalidations++;
             }
         }
-        stats.flush++;
+    }
+
+    uint64_t BaseTranslationCache::generation() const {
+        return invalidations + (nextLevel ? nextLevel->invalidations : 0);
+    }
+
+    void BaseTranslationCache::serialize(CheckpointOut &cp) const {
+        std::vector<Addr> index;
+        std::vector<uint16_t> pcid;
+        std::vector<Addr> root;
+        std::vector<uint64_t> pte;
+        std::vector<uint64_t> lruSeq;
+        for (const TranslationCacheEntry *entry :
+                store->levelEntries(level)) {
+            index.push_back(entry->index);
+            pcid.push_back(entry->asid);
+            root.push_back(entry->root);
+            pte.push_back(entry->nextStepEntry);
+            lruSeq.push_back(entry->lruSeq);
+        }
+        SERIALIZE_CONTAINER(index);
+        SERIALIZE_CONTAINER(pcid);
+        SERIALIZE_CONTAINER(root);
+        SERIALIZE_CONTAINER(pte);
+        SERIALIZE_CONTAINER(lruSeq);
+    }
+
+    void BaseTranslationCache::unserialize(CheckpointIn &cp,
+            std::vector<SavedEntry> &entries) {
+        std::vector<Addr> index;
+        std::vector<uint16_t> pcid;
+        std::vector<Addr> root;
+        std::vector<uint64_t> pte;
+        std::vector<uint64_t> lruSeq;
+        UNSERIALIZE_CONTAINER(index);
+        UNSERIALIZE_CONTAINER(pcid);
+        UNSERIALIZE_CONTAINER(root);
+        UNSERIALIZE_CONTAINER(pte);
+        UNSERIALIZE_CONTAINER(lruSeq);
+        fatal_if(pcid.size() != index.size() || root.size() != index.size()
+                || pte.size() != index.size()
+                || lruSeq.size() != index.size(),
+                "%s: inconsistent checkpointed entries", name());
+        for (size_t i = 0; i < index.size(); i++) {
+            entries.push_back({this, index[i], pcid[i], root[i], pte[i],
+                    lruSeq[i]});
+        }
+    }
+
+    void BaseTranslationCache::restore(const SavedEntry &saved) {
+        // Indices are saved masked, which NONE leaves as is. The fills get
+        //  increasing lruSeq, but a replacement policy sees them all on
+        //  the same tick, see PageStructureCache::serialize()
+        TranslationCacheEntry *entry = store->find(saved.index, saved.pcid,
+                saved.root, level, idxMaskBitsL);
+        if (entry) {
+            store->touch(entry);
+        } else {
+            bool evicted;
+            entry = store->fill(saved.index, saved.pcid, saved.root, level,
+                    idxMaskBitsL, saved.pte, evicted);
+        }
+        entry->fillSeq = ++fills;
+        entry->nextStepEntry = saved.pte;
+        // Which cores used it is not checkpointed: any of them may
+        entry->users = mask(upperLevels.size());
     }
 
     // Child classes
+    Addr PageStructureCache::PML5Cache::legacyMask(Addr vpn, LegacyAcc la) {
+        switch (la) {
+            case NONE: {
+                return vpn;
+            }
+
+            case LEGACY_32b_PAE:
+            case LEGACY_32b_NO_PAE:
+            default: {
+                panic("PML5 cache should not be used in legacy mode");
+            }
+        }
+    }
+
     Addr PageStructureCache::PML4Cache::legacyMask(Addr vpn, LegacyAcc la) {
         switch (la) {
             case NONE: {
@@ -171,10 +378,193 @@ namespace X86ISA
         }
     }
 
+    PageStructureCache::PageStructureCache(std::string ownerName,
+            uint32_t pml5c_size, uint32_t pml5c_assoc,
+            uint32_t pml4c_size, uint32_t pml4c_assoc,
+            uint32_t pdpc_size, uint32_t pdpc_assoc,
+            uint32_t pdec_size, uint32_t pdec_assoc,
+            replacement_policy::Base *rp, bool parallel_probe,
+            Cycles lookup_latency, Organization organization,
+            uint32_t unified_size, uint32_t unified_assoc)
+            : parallelProbe(parallel_probe), lookupLatency(lookup_latency),
+                unifiedStore(organization == UNIFIED
+                    ? new TranslationCacheStore(ownerName + ".unifiedPwc",
+                        unified_size, unified_assoc, rp)
+                    : nullptr),
+                pml5Cache(ownerName + ".pml5Cache", unifiedStore.get(),
+                    pml5c_size, pml5c_assoc, rp),
+                pml4Cache(ownerName + ".pml4Cache", unifiedStore.get(),
+                    pml4c_size, pml4c_assoc, rp),
+                pdpCache(ownerName + ".pdpCache", unifiedStore.get(),
+                    pdpc_size, pdpc_assoc, rp),
+                pdeCache(ownerName + ".pdeCache", unifiedStore.get(),
+                    pdec_size, pdec_assoc, rp) {
+        stats.probes.name(ownerName + ".pwc.probes");
+        stats.probeHits.name(ownerName + ".pwc.probeHits");
+        stats.probeMisses.name(ownerName + ".pwc.probeMisses");
+        stats.pcidHits.init(0).name(ownerName + ".pwc.pcidHits");
+        stats.pcidMisses.init(0).name(ownerName + ".pwc.pcidMisses");
+        stats.lookupPortConflicts.name(ownerName +
+                ".pwc.lookupPortConflicts");
+        stats.lookupPortWaitCycles.name(ownerName +
+                ".pwc.lookupPortWaitCycles");
+        stats.fillPortConflicts.name(ownerName + ".pwc.fillPortConflicts");
+        stats.fillPortWaitCycles.name(ownerName + ".pwc.fillPortWaitCycles");
+        stats.demaps.name(ownerName + ".pwc.demaps");
+    }
+
+    Tick PageStructureCache::edgeFrom(Tick when) const {
+        Tick edge = clock->clockEdge();
+        if (when > edge) {
+            edge += divCeil(when - edge, clock->clockPeriod())
+                * clock->clockPeriod();
+        }
+        return edge;
+    }
+
+    Tick PageStructureCache::reservePort(std::map<Tick, unsigned> &taken,
+            unsigned ports, Tick edge) const {
+        // Forget the edges that are over
+        taken.erase(taken.begin(), taken.lower_bound(curTick()));
+        Tick period = clock->clockPeriod();
+        auto it = taken.find(edge);
+        while (it != taken.end() && it->first == edge &&
+                it->second >= ports) {
+            edge += period;
+            ++it;
+        }
+        taken[edge]++;
+        return edge;
+    }
+
+    Tick PageStructureCache::reserveLookup(Tick when) {
+        if (!lookupPorts) {
+            return when;
+        }
+        Tick first = edgeFrom(when);
+        Tick at = reservePort(lookupsAt, lookupPorts, first);
+        Cycles wait((at - first) / clock->clockPeriod());
+        if (wait > 0) {
+            stats.lookupPortConflicts++;
+            stats.lookupPortWaitCycles += wait;
+        }
+        return at;
+    }
+
+    Tick PageStructureCache::reserveFill(Tick when) {
+        if (!fillPorts) {
+            return when;
+        }
+        Tick first = edgeFrom(when);
+        Tick at = reservePort(fillsAt, fillPorts, first);
+        Cycles wait((at - first) / clock->clockPeriod());
+        if (wait > 0) {
+            stats.fillPortConflicts++;
+            stats.fillPortWaitCycles += wait;
+        }
+        return at;
+    }
+
+    void PageStructureCache::recordProbe(bool hit, uint16_t pcid) {
+        stats.probes++;
+        if (hit) {
+            stats.probeHits++;
+            stats.pcidHits.sample(pcid);
+        } else {
+            stats.probeMisses++;
+            stats.pcidMisses.sample(pcid);
+        }
+    }
+
+    void PageStructureCache::setNextLevel(PageStructureCache *next,
+            BaseTranslationCache::Inclusion inclusion) {
+        nextLevel = next;
+        pml5Cache.setNextLevel(&next->pml5Cache, inclusion);
+        pml4Cache.setNextLevel(&next->pml4Cache, inclusion);
+        pdpCache.setNextLevel(&next->pdpCache, inclusion);
+        pdeCache.setNextLevel(&next->pdeCache, inclusion);
+    }
+
+    void PageStructureCache::serialize(CheckpointOut &cp) const {
+        {
+            Serializable::ScopedCheckpointSection sec(cp, "pml5Cache");
+            pml5Cache.serialize(cp);
+        }
+        {
+            Serializable::ScopedCheckpointSection sec(cp, "pml4Cache");
+            pml4Cache.serialize(cp);
+        }
+        {
+            Serializable::ScopedCheckpointSection sec(cp, "pdpCache");
+            pdpCache.serialize(cp);
+        }
+        {
+            Serializable::ScopedCheckpointSection sec(cp, "pdeCache");
+            pdeCache.serialize(cp);
+        }
+    }
+
+    void PageStructureCache::unserialize(CheckpointIn &cp) {
+        std::vector<BaseTranslationCache::SavedEntry> entries;
+        // Checkpoints taken before LA57 support have no PML5 cache
+        if (cp.sectionExists(Serializable::currentSection() + ".pml5Cache")) {
+            Serializable::ScopedCheckpointSection sec(cp, "pml5Cache");
+            pml5Cache.unserialize(cp, entries);
+        }
+        {
+            Serializable::ScopedCheckpointSection sec(cp, "pml4Cache");
+            pml4Cache.unserialize(cp, entries);
+        }
+        {
+            Serializable::ScopedCheckpointSection sec(cp, "pdpCache");
+            pdpCache.unserialize(cp, entries);
+        }
+        {
+            Serializable::ScopedCheckpointSection sec(cp, "pdeCache");
+            pdeCache.unserialize(cp, entries);
+        }
+        // With a smaller (or less associative) pwc than in the checkpoint,
+        //  the least recently used entries are evicted again
+        std::stable_sort(entries.begin(), entries.end(),
+                [](const BaseTranslationCache::SavedEntry &a,
+                   const BaseTranslationCache::SavedEntry &b)
+                { return a.lruSeq < b.lruSeq; });
+        for (const BaseTranslationCache::SavedEntry &entry : entries) {
+            entry.cache->restore(entry);
+        }
+    }
+
     void PageStructureCache::flush() {
+        pml5Cache.flush();
         pml4Cache.flush();
         pdpCache.flush();
         pdeCache.flush();
     }
+
+    void PageStructureCache::flushPcid(uint16_t pcid) {
+        pml5Cache.flushPcid(pcid);
+        pml4Cache.flushPcid(pcid);
+        pdpCache.flushPcid(pcid);
+        pdeCache.flushPcid(pcid);
+    }
+
+    uint64_t PageStructureCache::generation() const {
+        return pml5Cache.generation() + pml4Cache.generation() +
+            pdpCache.generation() + pdeCache.generation();
+    }
+
+    void PageStructureCache::demap(Addr va) {
+        stats.demaps++;
+        pml5Cache.demap(va);
+        pml4Cache.demap(va);
+        pdpCache.demap(va);
+        pdeCache.demap(va);
+        // Legacy walks index a 32-bit va as long mode ones do, except the
+        //  PDEs without PAE, which map 4M
+        if (va <= mask(32)) {
+            pdeCache.demap(va,
+                    BaseTranslationCache::LegacyAcc::LEGACY_32b_NO_PAE);
+        }
+    }
 } // namespace X86ISA
 } // namespace gem5
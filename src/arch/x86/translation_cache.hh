@@ -10,16 +10,25 @@
  *  http://kib.kiev.ua/x86docs/Intel/WhitePapers/317080-002.pdf. Code is
  *  based on tlb.hh and tlb.cc.
  *
- * It should be fine to not use Serializable for checkpointing since these
- *  caches does not hold modified entries (i.e. they are write-through).
+ * These caches do not hold modified entries (i.e. they are write-through),
+ *  so checkpointing their contents is only needed to restore them warm.
+ *  They are not Serializable themselves: the MMU (or shared pwc) that owns
+ *  a PageStructureCache checkpoints it in its own section.
  */
 
-#include <list>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
 #include <vector>
 
+#include "arch/generic/translation_cache_store.hh"
 #include "arch/x86/pagetable.hh" // Shiming: To use PageTableEntry
 #include "arch/x86/pagetable_walker.hh" // Shiming: To use State
-#include "base/trie.hh"
+#include "base/types.hh"
+#include "mem/cache/replacement_policies/base.hh"
+#include "sim/clocked_object.hh"
+#include "sim/serialize.hh"
 #include "sim/stats.hh"
 
 #ifndef __ARCH_X86_TRANSLATION_CACHE_HH__
@@ -28,26 +37,15 @@
 namespace gem5
 {
 
-namespace X86ISA
-{
-    // Declare here first, and define later. Need it for declaring Trie
-    struct TranslationCacheEntry;
-} // namespace X86ISA
-
-typedef Trie<Addr, X86ISA::TranslationCacheEntry> TranslationCacheEntryTrie;
-
 namespace X86ISA
 {
     enum PageWalkState : short; // Defined in pagetable_walker.hh
 
-    struct TranslationCacheEntry
-    {
-        Addr index;
-        ::gem5::X86ISA::PageTableEntry nextStepEntry;
-        uint64_t lruSeq;
-        TranslationCacheEntryTrie::Handle trieHandle;
-    };
-
+    /**
+     * The levels of the pwc keep their entries in TranslationCacheStores
+     *  (see arch/generic/translation_cache_store.hh), tagged with the PCID
+     *  and CR3 of the walk that filled them.
+     */
     class BaseTranslationCache
     {
         public:
@@ -57,9 +55,40 @@ namespace X86ISA
                 LEGACY_32b_PAE,
                 LEGACY_32b_NO_PAE
             };
+            /** Content policy of a shared next level, see setNextLevel() */
+            enum Inclusion
+            {
+                NON_INCLUSIVE = 0,
+                INCLUSIVE,
+                EXCLUSIVE
+            };
         private:
-            uint32_t size;
-            uint64_t lruSeq;
+            /** Private store, unless the store is shared */
+            std::unique_ptr<TranslationCacheStore> ownStore;
+            TranslationCacheStore *store;
+            uint8_t level;
+
+            /**
+             * The same level of a shared (L2) pwc behind this one, and the
+             *  translation caches in front of this one if it is shared.
+             */
+            BaseTranslationCache *nextLevel = nullptr;
+            Inclusion inclusion = NON_INCLUSIVE;
+            std::vector<BaseTranslationCache *> upperLevels;
+            /** Position of this level in upperLevels of the next level */
+            unsigned upperIndex = 0;
+            /**
+             * The last fill (of any level) before the last flush of this
+             *  level, and before the flushes of single PCIDs since then.
+             *  The entries of the next level filled until then are stale
+             *  for this level.
+             */
+            uint64_t flushSeq = 0;
+            std::unordered_map<uint16_t, uint64_t> pcidFlushSeq;
+            /** Fills of all levels so far */
+            static uint64_t fills;
+            /** Flushes and demaps of this level so far, see generation() */
+            uint64_t invalidations = 0;
 
         protected:
             std::string myName;
@@ -68,98 +97,402 @@ namespace X86ISA
             unsigned idxMaskBitsL = 0; // trie.insert() needs this type
             uint64_t addrMask = 0;
 
-            std::list<TranslationCacheEntry *> freeList;
-            std::vector<TranslationCacheEntry> tc;
-
-            TranslationCacheEntryTrie trie;
-
         private:
-            uint64_t nextSeq() { return ++lruSeq; }
-
-            void evictLRU();
-
             inline unsigned getIdxMaskBitsL() { return idxMaskBitsL; }
             inline Addr maskVpn(Addr vpn) { return addrMask & vpn; }
+            /** Drop the entries of the upper levels, to keep inclusion */
+            void backInvalidate(bool match_pcid, uint16_t pcid);
+            /** Record that this level filled or hit an entry of the next */
+            void useNext(TranslationCacheEntry *next_entry);
+            /** Whether next_entry was filled after this level flushed it */
+            bool fresh(const TranslationCacheEntry *next_entry) const;
 
             virtual Addr legacyMask(Addr vpn, LegacyAcc la) {
                 panic("no impl");
             }
 
         protected:
-            BaseTranslationCache(std::string _name, uint32_t _size,
+            /**
+             * @param _shared_store Store shared with other translation
+             *  caches. If nullptr, a private store of _size entries and
+             *  _assoc ways is created (_assoc 0 means fully associative).
+             * @param _rp Replacement policy of the private store. nullptr
+             *  selects the built-in exact LRU.
+             */
+            BaseTranslationCache(std::string _name,
+                TranslationCacheStore *_shared_store, uint32_t _size,
+                uint32_t _assoc, replacement_policy::Base *_rp,
                 unsigned _idx_mask_bits_h, unsigned _idx_mask_bits_l);
             virtual ~BaseTranslationCache() = default;
 
             struct TranslationCacheStats
             {
                 statistics::Scalar flush;
+                statistics::Scalar pcidFlush;
                 statistics::Scalar insert;
                 statistics::Scalar evict;
                 statistics::Scalar hit;
                 statistics::Scalar miss;
+                // Valid entries, matters when sharing a unified store
+                statistics::Average occupancy;
+                // Entries dropped because the shared level dropped them
+                statistics::Scalar backInval;
+                // Victims moved to an exclusive shared level
+                statistics::Scalar victimFill;
+                // Entries dropped by single address invalidations
+                statistics::Scalar demapped;
             } stats;
         public:
-            TranslationCacheEntry* insert(Addr vpn,
+            /**
+             * Entries are tagged with the PCID and page table root of the
+             *  walk that inserted them and only hit for the same ones, so
+             *  that a level shared by cores running different address
+             *  spaces (possibly with the same PCID) holds them side by side
+             *  and never hits for the wrong one.
+             * @param low_priority Fill the entry as the next victim of its
+             *  set instead of the most recently used. An entry that is
+             *  already there keeps its place.
+             */
+            TranslationCacheEntry* insert(Addr vpn, uint16_t pcid, Addr root,
                     const ::gem5::X86ISA::PageTableEntry &ptentry,
-                    LegacyAcc la=LegacyAcc::NONE);
-            TranslationCacheEntry* lookup(Addr va,
-                    LegacyAcc la=LegacyAcc::NONE, bool update_lru=true);
+                    LegacyAcc la=LegacyAcc::NONE, bool low_priority=false);
+            /**
+             * @param user In a shared level, the upper level looking up.
+             *  Only the entries filled since its last flush hit.
+             */
+            TranslationCacheEntry* lookup(Addr va, uint16_t pcid, Addr root,
+                    LegacyAcc la=LegacyAcc::NONE, bool update_lru=true,
+                    const BaseTranslationCache *user=nullptr);
+            /**
+             * Look up without touching stats or replacement state. Used
+             *  when several levels are probed at once and only one of the
+             *  hits is used, see access().
+             */
+            TranslationCacheEntry* probe(Addr va, uint16_t pcid, Addr root,
+                    LegacyAcc la=LegacyAcc::NONE,
+                    const BaseTranslationCache *user=nullptr);
+            /** Account a hit on an entry returned by probe() */
+            void access(TranslationCacheEntry *entry, bool update_lru=true);
+
+            /**
+             * Put a shared level behind this one. Walks fill both levels
+             *  unless the next level is EXCLUSIVE, in which case it only
+             *  holds the victims of this level and its hits move back here.
+             *  If it is INCLUSIVE, whatever it drops is dropped here too.
+             */
+            void setNextLevel(BaseTranslationCache *next,
+                    Inclusion _inclusion);
+            BaseTranslationCache *getNextLevel() const { return nextLevel; }
+            /**
+             * Fill this level with an entry that hit in the next level,
+             *  moving it if the next level is exclusive.
+             */
+            TranslationCacheEntry* fillFromNextLevel(Addr va, uint16_t pcid,
+                    Addr root, LegacyAcc la,
+                    TranslationCacheEntry *next_entry);
+            /** Called by the store before dropping a valid entry for room */
+            void evicted(const TranslationCacheEntry &entry);
+
+            /**
+             * Checkpointing, see PageStructureCache::serialize().
+             * @{
+             */
+            struct SavedEntry
+            {
+                BaseTranslationCache *cache;
+                Addr index;
+                uint16_t pcid;
+                Addr root;
+                uint64_t pte;
+                uint64_t lruSeq;
+            };
+            void serialize(CheckpointOut &cp) const;
+            /** Read the entries of this level back, into entries */
+            void unserialize(CheckpointIn &cp,
+                    std::vector<SavedEntry> &entries);
+            /** Put back a checkpointed entry, this level only */
+            void restore(const SavedEntry &entry);
+            /** @} */
         public:
+            /**
+             * Flushes (CR3 and CR4 writes) only concern the core that does
+             *  them, so they stay in this level: the next level is shared
+             *  by other cores, which must not lose their entries. It
+             *  forgets that this level uses its entries, and drops the ones
+             *  no other core uses. The others stay for the other cores, but
+             *  no longer hit for this level until a walk of it fills them
+             *  again: it must not skip steps with the paging structure
+             *  entries it has just invalidated. A flush of a shared level
+             *  itself (an explicit shootdown) invalidates its upper levels
+             *  if they are inclusive.
+             */
             void flush();
+            /** Invalidate the entries of one PCID, see flush() */
+            void flushPcid(uint16_t pcid);
+            /**
+             * Invalidate the entries whose index covers va, of any PCID,
+             *  as INVLPG does. Unlike flushes, forwarded to the next level,
+             *  since they stand for a change of the paging structures.
+             */
+            void demap(Addr va, LegacyAcc la=LegacyAcc::NONE);
+            /**
+             * Changes with every flush or demap of this level or of the
+             *  next one, which a walk that read its entries before must
+             *  not fill again.
+             */
+            uint64_t generation() const;
             std::string name() const { return myName; }
     };
 
     /**
-     * This mimics an Intel page structure cache
+     * This mimics an Intel page structure cache. In the unified
+     *  organization the levels share one store instead (as in a unified
+     *  page table cache). The entries stay tagged with the virtual index of
+     *  their level so that the walker can still skip steps.
      */
     class PageStructureCache
     {
+        public:
+            enum Organization
+            {
+                SPLIT = 0,
+                UNIFIED
+            };
+            /**
+             * How walks that end at a 2M/4M or 1G page fill the levels
+             *  above their leaf: as 4K walks do (NORMAL), not at all
+             *  (BYPASS), or ahead of 4K walks (PRIORITISE), whose fills of
+             *  those levels then go in as the next victims.
+             */
+            enum HugePageFill
+            {
+                NORMAL = 0,
+                BYPASS,
+                PRIORITISE
+            };
         private:
-            /** Create 3 split translation caches for the first 3 level walk */
+            /**
+             * Create split translation caches for the first 3 (4 with LA57)
+             *  levels of the walk. Indices keep the linear address bits up
+             *  to 56, which are copies of bit 47 without LA57.
+             */
+            class PML5Cache: public BaseTranslationCache
+            {
+                public:
+                    PML5Cache(std::string _name,
+                            TranslationCacheStore *_store, uint32_t _size,
+                            uint32_t _assoc, replacement_policy::Base *_rp)
+                        : BaseTranslationCache(_name, _store, _size, _assoc,
+                                _rp, 7, 48) {}
+                    Addr legacyMask(Addr vpn, LegacyAcc la) override;
+            };
+
             class PML4Cache: public BaseTranslationCache
             {
                 public:
-                    PML4Cache(std::string _name, uint32_t _size)
-                        : BaseTranslationCache(_name, _size, 12, 39) {}
+                    PML4Cache(std::string _name,
+                            TranslationCacheStore *_store, uint32_t _size,
+                            uint32_t _assoc, replacement_policy::Base *_rp)
+                        : BaseTranslationCache(_name, _store, _size, _assoc,
+                                _rp, 7, 39) {}
                     Addr legacyMask(Addr vpn, LegacyAcc la) override;
             };
 
             class PDPCache: public BaseTranslationCache
             {
                 public:
-                    PDPCache(std::string _name, uint32_t _size)
-                        : BaseTranslationCache(_name, _size, 12, 30) {}
+                    PDPCache(std::string _name,
+                            TranslationCacheStore *_store, uint32_t _size,
+                            uint32_t _assoc, replacement_policy::Base *_rp)
+                        : BaseTranslationCache(_name, _store, _size, _assoc,
+                                _rp, 7, 30) {}
                     Addr legacyMask(Addr vpn, LegacyAcc la) override;
             };
 
             class PDECache: public BaseTranslationCache
             {
                 public:
-                    PDECache(std::string _name, uint32_t _size)
-                        : BaseTranslationCache(_name, _size, 12, 21) {}
+                    PDECache(std::string _name,
+                            TranslationCacheStore *_store, uint32_t _size,
+                            uint32_t _assoc, replacement_policy::Base *_rp)
+                        : BaseTranslationCache(_name, _store, _size, _assoc,
+                                _rp, 7, 21) {}
                     Addr legacyMask(Addr vpn, LegacyAcc la) override;
             };
+            /**
+             * Probe all levels in one step (and pick the deepest hit)
+             *  instead of one level after the other.
+             */
+            bool parallelProbe;
+            /** Latency of probing one level, or all levels in parallel */
+            Cycles lookupLatency;
+            HugePageFill hugePageFill = NORMAL;
+
+            /**
+             * Lookup and fill ports per cycle, 0 for unlimited. A walk's
+             *  probe takes one lookup port, whatever the number of levels
+             *  it looks at, and every fill takes a fill port. The ports
+             *  taken are kept per edge of the pwc clock, in ticks, so that
+             *  walkers of other clock domains sharing the pwc line up.
+             * @{
+             */
+            unsigned lookupPorts = 0;
+            unsigned fillPorts = 0;
+            const Clocked *clock = nullptr;
+            std::map<Tick, unsigned> lookupsAt;
+            std::map<Tick, unsigned> fillsAt;
+            /** The first edge of the pwc clock from when on */
+            Tick edgeFrom(Tick when) const;
+            /** Take the first free port from edge on, return its tick */
+            Tick reservePort(std::map<Tick, unsigned> &taken,
+                    unsigned ports, Tick edge) const;
+            /** @} */
+
+            /** One probe per walk, whatever the number of levels */
+            struct PageStructureCacheStats
+            {
+                statistics::Scalar probes;
+                statistics::Scalar probeHits;
+                statistics::Scalar probeMisses;
+                // Indexed by PCID, only the PCIDs seen are printed
+                statistics::SparseHistogram pcidHits;
+                statistics::SparseHistogram pcidMisses;
+                // Probes and fills that waited for a port, and how long
+                statistics::Scalar lookupPortConflicts;
+                statistics::Scalar lookupPortWaitCycles;
+                statistics::Scalar fillPortConflicts;
+                statistics::Scalar fillPortWaitCycles;
+                // Single address invalidations, see demap()
+                statistics::Scalar demaps;
+            } stats;
+
+            /** The store shared by all levels if unified */
+            std::unique_ptr<TranslationCacheStore> unifiedStore;
+            /** Shared pwc probed when all levels miss, if any */
+            PageStructureCache *nextLevel = nullptr;
         public:
             /** This class itself is a combination of caches */
+            PML5Cache pml5Cache;
             PML4Cache pml4Cache;
             PDPCache pdpCache;
             PDECache pdeCache;
         public:
-            /** Constructor and destructor */
+            /**
+             * Constructor and destructor. The per-level sizes and
+             *  associativities are only used by the split organization,
+             *  unified_size and unified_assoc only by the unified one.
+             */
             PageStructureCache(std::string ownerName,
-                uint32_t pml4c_size, uint32_t pdpc_size,
-                uint32_t pdec_size)
-                : pml4Cache(ownerName + ".pml4Cache", pml4c_size),
-                    pdpCache(ownerName + ".pdpCache", pdpc_size),
-                    pdeCache(ownerName + ".pdeCache", pdec_size) {}
+                uint32_t pml5c_size, uint32_t pml5c_assoc,
+                uint32_t pml4c_size, uint32_t pml4c_assoc,
+                uint32_t pdpc_size, uint32_t pdpc_assoc,
+                uint32_t pdec_size, uint32_t pdec_assoc,
+                replacement_policy::Base *rp=nullptr,
+                bool parallel_probe=false,
+                Cycles lookup_latency=Cycles(0),
+                Organization organization=SPLIT,
+                uint32_t unified_size=0, uint32_t unified_assoc=0);
             ~PageStructureCache() {}
         public:
             void flush();
+            /**
+             * Invalidate the entries of one PCID, as on a MOV to CR3 or a
+             *  single-context INVPCID ("TLBs, Paging-Structure Caches, and
+             *  Their Invalidation" 5.1 and 5.2).
+             */
+            void flushPcid(uint16_t pcid);
+            /**
+             * INVLPG (or a page fault) of va: only the entries that would
+             *  be used to translate va are invalidated, in all levels
+             *  ("TLBs, Paging-Structure Caches, and Their Invalidation"
+             *  5.1). The PCID is not known here, so the entries of every
+             *  PCID go, which is more than required but safe.
+             */
+            void demap(Addr va);
+            /** The sum of BaseTranslationCache::generation() of the levels */
+            uint64_t generation() const;
+
+            bool isParallelProbe() const { return parallelProbe; }
+            void setHugePageFill(HugePageFill fill) { hugePageFill = fill; }
+            /**
+             * @param _clock Clock of the pwc, whose cycles the ports and
+             *  the lookup latency are in.
+             */
+            void
+            setPorts(unsigned lookup_ports, unsigned fill_ports,
+                    const Clocked *_clock)
+            {
+                lookupPorts = lookup_ports;
+                fillPorts = fill_ports;
+                clock = _clock;
+            }
+            /**
+             * Take a lookup (fill) port for a probe (fill) that reaches
+             *  the pwc at tick when, at the first edge of the pwc clock
+             *  with a free port.
+             * @return The tick the port is taken at, when itself if the
+             *  ports are unlimited.
+             */
+            Tick reserveLookup(Tick when);
+            Tick reserveFill(Tick when);
+            HugePageFill getHugePageFill() const { return hugePageFill; }
+            /**
+             * Latency of a walk's probe that looked up num_probed levels
+             *  (all of them in parallel mode).
+             */
+            Cycles
+            probeLatency(unsigned num_probed) const
+            {
+                return parallelProbe ? lookupLatency
+                    : Cycles(lookupLatency * num_probed);
+            }
+            /** The same in ticks of the pwc clock */
+            Tick
+            probeTicks(unsigned num_probed) const
+            {
+                return clock->cyclesToTicks(probeLatency(num_probed));
+            }
+            void recordProbe(bool hit, uint16_t pcid);
+
+            /** Put a (shared) pwc behind every level of this one */
+            void setNextLevel(PageStructureCache *next,
+                    BaseTranslationCache::Inclusion inclusion);
+            PageStructureCache *getNextLevel() const { return nextLevel; }
+
+            /**
+             * Checkpoint the entries of all levels (index, PCID, root, PTE
+             *  and recency), one section per level. Restoring puts them back
+             *  from the least recently used, so that with the built-in LRU
+             *  the recency order, also across the levels of a unified
+             *  store, is rebuilt whatever the organization of the restored
+             *  pwc. With a replacement policy only the order of the fills
+             *  is kept: the policies stamp their entries with curTick(),
+             *  which is the same for all of them, so LRU-like policies
+             *  start with ties. The next level is checkpointed by its owner.
+             */
+            void serialize(CheckpointOut &cp) const;
+            void unserialize(CheckpointIn &cp);
             //PageTableEntry lookup(Addr va, PageWalkState state);
             //void insert(Addr vpn, const PageTableEntry& ptentry,
             //        PageWalkState state);
     };
 
+    /**
+     * The guest physical to host physical translations of nested walks
+     *  (the leaf entries of the host page table), indexed by guest physical
+     *  page. A hit skips the whole host walk of a guest physical address.
+     */
+    class NestedTlb : public BaseTranslationCache
+    {
+        public:
+            NestedTlb(std::string _name, uint32_t _size, uint32_t _assoc,
+                    replacement_policy::Base *_rp)
+                : BaseTranslationCache(_name, nullptr, _size, _assoc, _rp,
+                        12, 12) {}
+        private:
+            Addr legacyMask(Addr vpn, LegacyAcc la) override { return vpn; }
+    };
+
 } // namespace X86ISA
 } // namespace gem5
 
@@ -0,0 +1,152 @@
+/**
+ * 2023 Feb
+ * Shiming Li
+ * shiming.li@it.uu.se
+ *
+ * Uppsala Architecture Research Team (UART)
+ * Uppsala University
+ *
+ * Two cores behind one shared pwc: a flush stays local to the core that
+ *  does it, but that core no longer hits what it cached before, nor
+ *  fills what its walks read before.
+ */
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "arch/x86/translation_cache.hh"
+#include "sim/cur_tick.hh"
+#include "sim/root.hh"
+
+using namespace gem5;
+using namespace gem5::X86ISA;
+
+// The stats look names up through the Root, which is not linked in
+Root *Root::_root = nullptr;
+
+namespace
+{
+
+const Addr Va = 0x7f0000200000;
+const Addr Cr3 = 0x1000;
+const uint64_t Pte = 0x5027;
+
+class SharedPwcTest : public testing::TestWithParam<uint32_t>
+{
+  protected:
+    /**
+     * The stats of the caches stay registered by their address and name,
+     *  so every test gets caches of its own, never freed
+     */
+    SharedPwcTest()
+        : shared(*new PageStructureCache(unique("shared"), 2, GetParam(),
+                 4, GetParam(), 8, GetParam(), 16, GetParam())),
+          a(*new PageStructureCache(unique("a"), 2, 0, 2, 0, 4, 0, 4, 0)),
+          b(*new PageStructureCache(unique("b"), 2, 0, 2, 0, 4, 0, 4, 0))
+    {
+        Gem5Internal::_curTickPtr = &tick;
+        a.setNextLevel(&shared, BaseTranslationCache::NON_INCLUSIVE);
+        b.setNextLevel(&shared, BaseTranslationCache::NON_INCLUSIVE);
+    }
+
+    static std::string
+    unique(const std::string &name)
+    {
+        static unsigned tests = 0;
+        return name + std::to_string(tests++);
+    }
+
+    /** The shared PDE cache as seen by a miss of core */
+    TranslationCacheEntry *
+    sharedHit(PageStructureCache &core, uint16_t pcid=0)
+    {
+        return shared.pdeCache.probe(Va, pcid, Cr3,
+                BaseTranslationCache::NONE, &core.pdeCache);
+    }
+
+    Tick tick = 0;
+    PageStructureCache &shared;
+    PageStructureCache &a;
+    PageStructureCache &b;
+};
+
+} // anonymous namespace
+
+/** After a flush, the core misses in the shared level, the other hits */
+TEST_P(SharedPwcTest, FlushHidesSharedEntries)
+{
+    a.pdeCache.insert(Va, 0, Cr3, Pte);
+    b.pdeCache.fillFromNextLevel(Va, 0, Cr3, BaseTranslationCache::NONE,
+            sharedHit(b));
+    ASSERT_NE(sharedHit(a), nullptr);
+
+    a.flush();
+    EXPECT_EQ(a.pdeCache.probe(Va, 0, Cr3), nullptr);
+    EXPECT_EQ(sharedHit(a), nullptr);
+    EXPECT_NE(sharedHit(b), nullptr);
+
+    // A walk of the core reads the entry again, or a walk of the other
+    a.pdeCache.insert(Va, 0, Cr3, Pte);
+    EXPECT_NE(sharedHit(a), nullptr);
+    a.flush();
+    b.pdeCache.insert(Va, 0, Cr3, Pte);
+    EXPECT_NE(sharedHit(a), nullptr);
+}
+
+/** Flushing a PCID only hides the entries of that PCID */
+TEST_P(SharedPwcTest, PcidFlush)
+{
+    for (uint16_t pcid : {1, 2}) {
+        a.pdeCache.insert(Va, pcid, Cr3, Pte);
+        b.pdeCache.fillFromNextLevel(Va, pcid, Cr3,
+                BaseTranslationCache::NONE, sharedHit(b, pcid));
+    }
+
+    a.flushPcid(1);
+    EXPECT_EQ(sharedHit(a, 1), nullptr);
+    EXPECT_NE(sharedHit(a, 2), nullptr);
+    EXPECT_NE(sharedHit(b, 1), nullptr);
+}
+
+/**
+ * A walk drops its delayed fills after an invalidation of the pwc of its
+ *  core, including an INVLPG of another core reaching the shared level
+ */
+TEST_P(SharedPwcTest, Generation)
+{
+    uint64_t generation = a.generation();
+    b.demap(Va);
+    EXPECT_NE(a.generation(), generation);
+
+    generation = a.generation();
+    b.flush();
+    b.flushPcid(1);
+    EXPECT_EQ(a.generation(), generation);
+    a.flushPcid(1);
+    EXPECT_NE(a.generation(), generation);
+}
+
+/**
+ * The contexts of an index share its set, so a demap finds the entries
+ *  of every PCID and root by probing it alone
+ */
+TEST_P(SharedPwcTest, DemapAllContexts)
+{
+    for (uint16_t pcid : {0, 1}) {
+        shared.pdeCache.insert(Va, pcid, Cr3 + pcid * 0x1000, Pte);
+    }
+    shared.pdeCache.insert(Va + 0x200000, 0, Cr3, Pte);
+    ASSERT_NE(shared.pdeCache.probe(Va, 0, Cr3), nullptr);
+    ASSERT_NE(shared.pdeCache.probe(Va, 1, Cr3 + 0x1000), nullptr);
+
+    b.demap(Va);
+    for (uint16_t pcid : {0, 1}) {
+        EXPECT_EQ(shared.pdeCache.probe(Va, pcid, Cr3 + pcid * 0x1000),
+                nullptr);
+    }
+    EXPECT_NE(shared.pdeCache.probe(Va + 0x200000, 0, Cr3), nullptr);
+}
+
+INSTANTIATE_TEST_SUITE_P(FullyAndSetAssociative, SharedPwcTest,
+        testing::Values(0u, 2u));
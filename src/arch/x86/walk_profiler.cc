@@ -0,0 +1,124 @@
+/**
+ * 2023 Feb
+ * Shiming Li
+ * shiming.li@it.uu.se
+ *
+ * Uppsala Architecture Research Team (UART)
+ * Uppsala University
+ *
+ * The pwc and TLB reuse profiler, see walk_profiler.hh.
+ */
+
+#include "arch/x86/walk_profiler.hh"
+
+#include "base/bitfield.hh"
+#include "base/logging.hh"
+
+namespace gem5
+{
+
+namespace X86ISA
+{
+
+WalkProfiler::WalkProfiler(const Params &p)
+    : SimObject(p), mmu(p.mmu), maxDistance(p.max_distance), stats(this)
+{
+    fatal_if(p.max_distance == 0 || p.max_distance % p.bucket_size != 0,
+            "%s: max_distance must be a non-zero multiple of bucket_size",
+            name());
+    for (statistics::Distribution *dist : {&stats.pml4Distance,
+            &stats.pdpDistance, &stats.pdeDistance, &stats.itbDistance,
+            &stats.dtbDistance}) {
+        dist->init(0, p.max_distance - 1, p.bucket_size)
+            .flags(statistics::pdf | statistics::cdf);
+    }
+}
+
+WalkProfiler::WalkProfilerStats::WalkProfilerStats(
+        statistics::Group *parent)
+  : statistics::Group(parent),
+    ADD_STAT(pml4Distance, statistics::units::Count::get(),
+             "Stack distance of the PML4 entries used by the walks"),
+    ADD_STAT(pdpDistance, statistics::units::Count::get(),
+             "Stack distance of the PDP entries used by the walks"),
+    ADD_STAT(pdeDistance, statistics::units::Count::get(),
+             "Stack distance of the PDEs used by the walks"),
+    ADD_STAT(itbDistance, statistics::units::Count::get(),
+             "Stack distance of the pages looked up in the instruction TLB"),
+    ADD_STAT(dtbDistance, statistics::units::Count::get(),
+             "Stack distance of the pages looked up in the data TLB"),
+    ADD_STAT(pml4Cold, statistics::units::Count::get(),
+             "First uses of a PML4 entry"),
+    ADD_STAT(pdpCold, statistics::units::Count::get(),
+             "First uses of a PDP entry"),
+    ADD_STAT(pdeCold, statistics::units::Count::get(),
+             "First uses of a PDE"),
+    ADD_STAT(itbCold, statistics::units::Count::get(),
+             "First lookups of a page in the instruction TLB"),
+    ADD_STAT(dtbCold, statistics::units::Count::get(),
+             "First lookups of a page in the data TLB")
+{
+}
+
+void
+WalkProfiler::regProbeListeners()
+{
+    TLB *itb = static_cast<TLB *>(mmu->itb);
+    TLB *dtb = static_cast<TLB *>(mmu->dtb);
+    // Both walkers share the pwc, so their walks go in the same streams
+    for (TLB *tlb : {itb, dtb}) {
+        listeners.emplace_back(new Listener<Walker::WalkProbeInfo>(*this,
+                tlb->getWalker()->getProbeManager(), "Walk",
+                &WalkProfiler::profileWalk));
+    }
+    listeners.emplace_back(new Listener<Addr>(*this,
+            itb->getProbeManager(), "Lookup",
+            &WalkProfiler::profileItbLookup));
+    listeners.emplace_back(new Listener<Addr>(*this,
+            dtb->getProbeManager(), "Lookup",
+            &WalkProfiler::profileDtbLookup));
+}
+
+void
+WalkProfiler::sample(StackDistCalc &calc, Addr key,
+        statistics::Distribution &dist, statistics::Scalar &cold)
+{
+    uint64_t distance = calc.calcStackDistAndUpdate(key).first;
+    if (distance == StackDistCalc::Infinity) {
+        // Into the overflow bucket, so that the CDF is the hit rate
+        cold++;
+        dist.sample(maxDistance);
+    } else {
+        dist.sample(distance);
+    }
+}
+
+void
+WalkProfiler::profileWalk(const Walker::WalkProbeInfo &info)
+{
+    // Entries are tagged with the PCID, keep it in the low bits. The
+    //  indices keep the address bits up to 56, as the pwc does.
+    Addr pcid = info.pcid & mask(12);
+    sample(pml4Calc, (bits(info.vaddr, 56, 39) << 12) | pcid,
+            stats.pml4Distance, stats.pml4Cold);
+    sample(pdpCalc, (bits(info.vaddr, 56, 30) << 12) | pcid,
+            stats.pdpDistance, stats.pdpCold);
+    sample(pdeCalc, (bits(info.vaddr, 56, 21) << 12) | pcid,
+            stats.pdeDistance, stats.pdeCold);
+}
+
+void
+WalkProfiler::profileItbLookup(const Addr &vpn)
+{
+    // The page of the lookup with the PCID in the low bits already
+    sample(itbCalc, vpn, stats.itbDistance, stats.itbCold);
+}
+
+void
+WalkProfiler::profileDtbLookup(const Addr &vpn)
+{
+    sample(dtbCalc, vpn, stats.dtbDistance, stats.dtbCold);
+}
+
+} // namespace X86ISA
+} // namespace gem5
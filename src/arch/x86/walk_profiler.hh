@@ -0,0 +1,114 @@
+/**
+ * 2023 Feb
+ * Shiming Li
+ * shiming.li@it.uu.se
+ *
+ * Uppsala Architecture Research Team (UART)
+ * Uppsala University
+ *
+ * A profiler of the reuse of the pwc and TLB entries, to size them from a
+ *  single run instead of sweeping their sizes. There is one per MMU, since
+ *  the pwc is shared by the walkers of both TLBs. It listens to the demand
+ *  walks of both walkers ("Walk" probe) and to the lookups of both TLBs
+ *  ("Lookup" probe), and computes the stack (LRU reuse) distance of every
+ *  PML4, PDP and PDE index the walks use, and of every page each TLB
+ *  looks up, as in Mattson et al. A fully associative LRU structure of N
+ *  entries hits exactly the accesses at a distance below N.
+ *
+ * The distances are sampled into one distribution per stream, with the
+ *  first use of an index in the overflow bucket, so that the CDF of the
+ *  distribution at N is the hit rate of N entries. The pwc streams assume
+ *  every level is looked up on each walk (as with parallel probes) and
+ *  long mode indices. Prefetch walks are not profiled. The TLB streams
+ *  count pages of 4K, whatever the size of the translation.
+ */
+
+#ifndef __ARCH_X86_WALK_PROFILER_HH__
+#define __ARCH_X86_WALK_PROFILER_HH__
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "arch/x86/mmu.hh"
+#include "arch/x86/pagetable_walker.hh"
+#include "base/types.hh"
+#include "mem/stack_dist_calc.hh"
+#include "params/X86WalkProfiler.hh"
+#include "sim/probe/probe.hh"
+#include "sim/sim_object.hh"
+#include "sim/stats.hh"
+
+namespace gem5
+{
+
+namespace X86ISA
+{
+    class WalkProfiler : public SimObject
+    {
+      private:
+        MMU *mmu;
+        /** Distances from here on go to the overflow bucket */
+        const unsigned maxDistance;
+
+        StackDistCalc pml4Calc;
+        StackDistCalc pdpCalc;
+        StackDistCalc pdeCalc;
+        StackDistCalc itbCalc;
+        StackDistCalc dtbCalc;
+
+        template <class Arg>
+        class Listener : public ProbeListenerArgBase<Arg>
+        {
+          public:
+            Listener(WalkProfiler &_parent, ProbeManager *pm,
+                    const std::string &name,
+                    void (WalkProfiler::*_func)(const Arg &))
+                : ProbeListenerArgBase<Arg>(pm, name), parent(_parent),
+                  func(_func) {}
+
+            void notify(const Arg &arg) override { (parent.*func)(arg); }
+
+          private:
+            WalkProfiler &parent;
+            void (WalkProfiler::*func)(const Arg &);
+        };
+
+        std::vector<std::unique_ptr<ProbeListener>> listeners;
+
+        struct WalkProfilerStats : public statistics::Group
+        {
+            WalkProfilerStats(statistics::Group *parent);
+
+            statistics::Distribution pml4Distance;
+            statistics::Distribution pdpDistance;
+            statistics::Distribution pdeDistance;
+            statistics::Distribution itbDistance;
+            statistics::Distribution dtbDistance;
+            // First uses, which miss whatever the size
+            statistics::Scalar pml4Cold;
+            statistics::Scalar pdpCold;
+            statistics::Scalar pdeCold;
+            statistics::Scalar itbCold;
+            statistics::Scalar dtbCold;
+        } stats;
+
+        /** Sample the distance of key in a stream */
+        void sample(StackDistCalc &calc, Addr key,
+                statistics::Distribution &dist, statistics::Scalar &cold);
+
+        void profileWalk(const Walker::WalkProbeInfo &info);
+        void profileItbLookup(const Addr &vpn);
+        void profileDtbLookup(const Addr &vpn);
+
+      public:
+        typedef X86WalkProfilerParams Params;
+        WalkProfiler(const Params &p);
+
+        void regProbeListeners() override;
+    };
+
+} // namespace X86ISA
+} // namespace gem5
+
+#endif // __ARCH_X86_WALK_PROFILER_HH__
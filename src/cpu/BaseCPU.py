@@ -97,6 +97,35 @@ class BaseCPU(ClockedObject):
     def takeOverFrom(self, old_cpu):
         self._ccObject.takeOverFrom(old_cpu._ccObject)
 
+    # Shiming: pwc params are forwarded to the (X86) mmu and to switch cpus
+    @classmethod
+    def pwcParams(cls):
+        """Names of the pwc params of this CPU"""
+        return [
+            "enable_pwc",
+            "pwc_pml5_size",
+            "pwc_pml4_size",
+            "pwc_pdp_size",
+            "pwc_pde_size",
+            "pwc_pml5_assoc",
+            "pwc_pml4_assoc",
+            "pwc_pdp_assoc",
+            "pwc_pde_assoc",
+            "pwc_replacement_policy",
+            "pwc_parallel_probe",
+            "pwc_lookup_latency",
+            "pwc_organization",
+            "pwc_unified_size",
+            "pwc_unified_assoc",
+            "pwc_huge_page_fill",
+            "pwc_lookup_ports",
+            "pwc_fill_ports",
+        ]
+
+    def pwcArgs(self):
+        """The pwc params of this CPU as keyword arguments"""
+        return {name: getattr(self, name) for name in self.pwcParams()}
+
     system = Param.System(Parent.any, "system object")
     cpu_id = Param.Int(-1, "CPU identifier")
     socket_id = Param.Unsigned(0, "Physical Socket identifier")
@@ -134,9 +163,39 @@ class BaseCPU(ClockedObject):
     # @{
     enable_pwc = Param.Bool(False, "Use translation cache "
                                         "(aka pwc/page structure cache)")
+    pwc_pml5_size = Param.Unsigned(2, "PML5 cache size in number of entries "
+                                    "(only used with LA57)")
     pwc_pml4_size = Param.Unsigned(8, "PML4 cache size in number of entries")
     pwc_pdp_size = Param.Unsigned(16, "PDP cache size in number of entries")
     pwc_pde_size = Param.Unsigned(32, "PDE cache size in number of entries")
+    pwc_pml5_assoc = Param.Unsigned(0, "PML5 cache associativity "
+                                    "(0 means fully associative)")
+    pwc_pml4_assoc = Param.Unsigned(0, "PML4 cache associativity "
+                                    "(0 means fully associative)")
+    pwc_pdp_assoc = Param.Unsigned(0, "PDP cache associativity "
+                                    "(0 means fully associative)")
+    pwc_pde_assoc = Param.Unsigned(0, "PDE cache associativity "
+                                    "(0 means fully associative)")
+    pwc_replacement_policy = Param.BaseReplacementPolicy(NULL,
+        "Replacement policy of all pwc levels. Exact LRU if not set")
+    pwc_parallel_probe = Param.Bool(False, "Probe all pwc levels in one "
+                                    "step and use the deepest hit")
+    pwc_lookup_latency = Param.Cycles(0, "Latency of a pwc lookup (per "
+                                    "level probed, or once if parallel)")
+    # An X86PwcOrganization, kept as a string as it is x86 only
+    pwc_organization = Param.String("split", "Split per-level pwc, or a "
+                                    "unified one where levels share capacity")
+    pwc_unified_size = Param.Unsigned(56, "Unified pwc size in number of "
+                                    "entries")
+    pwc_unified_assoc = Param.Unsigned(0, "Unified pwc associativity "
+                                    "(0 means fully associative)")
+    # An X86PwcHugePageFill
+    pwc_huge_page_fill = Param.String("normal", "How walks ending at a "
+                                    "2M/1G page fill the pwc")
+    pwc_lookup_ports = Param.Unsigned(0, "Pwc probes per cycle (0 means "
+                                    "unlimited)")
+    pwc_fill_ports = Param.Unsigned(0, "Pwc fills per cycle (0 means "
+                                    "unlimited)")
     # @}
     interrupts = VectorParam.BaseInterrupts([], "Interrupt Controller")
     isa = VectorParam.BaseISA([], "ISA instance")
@@ -0,0 +1,57 @@
+# 2023 Feb
+# Shiming Li
+# shiming.li@it.uu.se
+#
+# Uppsala Architecture Research Team (UART)
+# Uppsala University
+
+from m5.SimObject import SimObject
+from m5.params import *
+
+
+class QuantumBridge(SimObject):
+    """Timing bridge between SimObjects of two event queues (threads)
+
+    The requestor side runs on in_eventq_index, the responder side on the
+    eventq_index of the bridge. Every packet crosses with the latency of the
+    bridge, which is the lookahead of the parallel simulation: it must be
+    larger than the sim_quantum of the root. The packets are only collected
+    on the quantum barriers, in the order they were sent, so a run gives
+    the same result whatever the thread interleaving. So that the accesses
+    take as long as without the bridge, its latency is taken out of the
+    latencies of the responder, e.g. the cpu_side_lookahead of a cache.
+
+    Example:
+
+    sys.cpu = Cpu(eventq_index=1)
+    sys.bridge = QuantumBridge(in_eventq_index=1, eventq_index=0)
+    sys.l1d.cpu_side_lookahead = sys.bridge.latency
+
+    sys.cpu.dcache_port = sys.bridge.in_port
+    sys.bridge.out_port = sys.l1d.cpu_side
+    """
+
+    type = "QuantumBridge"
+    cxx_header = "mem/quantum_bridge.hh"
+    cxx_class = "gem5::QuantumBridge"
+
+    in_port = ResponsePort("Incoming port, on in_eventq_index")
+    out_port = RequestPort("Outgoing port, on eventq_index")
+
+    in_eventq_index = Param.UInt32("Event queue of the requestor side")
+    latency = Param.Latency(
+        "1ns", "Latency of each packet, larger than the sim_quantum"
+    )
+    check_determinism = Param.Bool(
+        False,
+        "Print a digest of the deliveries at exit, to compare runs, and "
+        "check that every packet is sent from the queue of its side",
+    )
+    # Shiming: Between the caches of a cpu and a coherent crossbar
+    coherent = Param.Bool(
+        False,
+        "The in side holds caches snooped by a coherent crossbar on the "
+        "out side: the snoops are answered in the call, and the requests "
+        "are accepted once they have crossed. The runs differ with the "
+        "interleaving of the threads",
+    )
@@ -89,6 +89,14 @@ class BaseCache(ClockedObject):
     tag_latency = Param.Cycles("Tag lookup latency")
     data_latency = Param.Cycles("Data access latency")
     response_latency = Param.Cycles("Latency for the return path on a miss")
+    # Shiming: The latency of a QuantumBridge (--pdes) in front of the cpu
+    # side port, taken out of the latencies of the cache so that the
+    # accesses still take as long
+    cpu_side_lookahead = Param.Latency(
+        "0t",
+        "Latency of the link in front of the cpu side port, taken out of "
+        "each request and response crossing it",
+    )
 
     warmup_percentage = Param.Percent(
         0, "Percentage of tags to be touched to warm up the cache"
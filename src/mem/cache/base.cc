@@ -98,6 +98,7 @@ BaseCache::BaseCache(const BaseCacheParams &p, unsigned blk_size)
       fillLatency(p.data_latency),
       responseLatency(p.response_latency),
       sequentialAccess(p.sequential_access),
+      cpuSideLookahead(p.cpu_side_lookahead),
       numTarget(p.tgts_per_mshr),
       forwardSnoops(true),
       clusivity(p.clusivity),
@@ -134,6 +135,15 @@ BaseCache::BaseCache(const BaseCacheParams &p, unsigned blk_size)
         "Compressed cache %s does not have a compression algorithm", name());
     if (compressor)
         compressor->setCache(this);
+
+    // Shiming: A response from the cache crosses the link twice, a miss
+    //  once each way. The shortest access, a miss or a tag only access
+    //  (e.g. the response to a software prefetch), takes the lookup latency.
+    fatal_if(cpuSideLookahead > cyclesToTicks(forwardLatency) ||
+             cpuSideLookahead > cyclesToTicks(responseLatency) ||
+             2 * cpuSideLookahead > cyclesToTicks(lookupLatency),
+             "The cpu side lookahead of %s (%d ticks) is longer than its "
+             "latencies allow", name(), cpuSideLookahead);
 }
 
 BaseCache::~BaseCache()
@@ -404,7 +414,9 @@ BaseCache::recvTimingReq(PacketPtr pkt)
 {
     // anything that is merely forwarded pays for the forward latency and
     // the delay provided by the crossbar
-    Tick forward_time = clockEdge(forwardLatency) + pkt->headerDelay;
+    // Shiming: less the link the request crossed to get here
+    Tick forward_time = clockEdge(forwardLatency) + pkt->headerDelay -
+        cpuSideLookahead;
 
     if (pkt->cmd == MemCmd::LockedRMWWriteReq) {
         // For LockedRMW accesses, we mark the block inaccessible after the
@@ -432,7 +444,8 @@ BaseCache::recvTimingReq(PacketPtr pkt)
         // After the evicted blocks are selected, they must be forwarded
         // to the write buffer to ensure they logically precede anything
         // happening below
-        doWritebacks(writebacks, clockEdge(lat + forwardLatency));
+        doWritebacks(writebacks,
+                     clockEdge(lat + forwardLatency) - cpuSideLookahead);
     }
 
     // Here we charge the headerDelay that takes into account the latencies
@@ -440,7 +453,8 @@ BaseCache::recvTimingReq(PacketPtr pkt)
     // The latency charged is just the value set by the access() function.
     // In case of a hit we are neglecting response latency.
     // In case of a miss we are neglecting forward latency.
-    Tick request_time = clockEdge(lat);
+    // Shiming: The response of a hit crosses the link back to the cpu
+    Tick request_time = clockEdge(lat) - 2 * cpuSideLookahead;
     // Here we reset the timing of the packet.
     pkt->headerDelay = pkt->payloadDelay = 0;
 
@@ -475,7 +489,7 @@ void
 BaseCache::handleUncacheableWriteResp(PacketPtr pkt)
 {
     Tick completion_time = clockEdge(responseLatency) +
-        pkt->headerDelay + pkt->payloadDelay;
+        pkt->headerDelay + pkt->payloadDelay - cpuSideLookahead;
 
     // Reset the bus additional time as it is now accounted for
     pkt->headerDelay = pkt->payloadDelay = 0;
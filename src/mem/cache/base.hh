@@ -921,6 +921,14 @@ class BaseCache : public ClockedObject
      */
     const bool sequentialAccess;
 
+    /**
+     * Shiming: The latency of the link in front of the cpu side port
+     * (a QuantumBridge). The requests arrive that late and the responses
+     * take that long to reach the cpu, so both are taken out of the
+     * timing of the cache.
+     */
+    const Tick cpuSideLookahead;
+
     /** The number of targets for each MSHR. */
     const int numTarget;
 
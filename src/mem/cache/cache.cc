@@ -801,9 +801,10 @@ Cache::serviceMSHRTargets(MSHR *mshr, const PacketPtr pkt, CacheBlk *blk)
                 assert(!tgt_pkt->req->isUncacheable());
 
                 assert(tgt_pkt->req->requestorId() < system->maxRequestors());
+                // Shiming: The request crossed the link before recvTime
                 stats.cmdStats(tgt_pkt)
                     .missLatency[tgt_pkt->req->requestorId()] +=
-                    completion_time - target.recvTime;
+                    completion_time - target.recvTime + cpuSideLookahead;
 
                 if (tgt_pkt->cmd == MemCmd::LockedRMWReadReq) {
                     // We're going to leave a target in the MSHR until the
@@ -890,7 +891,9 @@ Cache::serviceMSHRTargets(MSHR *mshr, const PacketPtr pkt, CacheBlk *blk)
             }
             // Reset the bus additional time as it is now accounted for
             tgt_pkt->headerDelay = tgt_pkt->payloadDelay = 0;
-            cpuSidePort.schedTimingResp(tgt_pkt, completion_time);
+            // Shiming: less the link back to the cpu
+            cpuSidePort.schedTimingResp(tgt_pkt,
+                                        completion_time - cpuSideLookahead);
             break;
 
           case MSHR::Target::FromPrefetcher:
@@ -280,8 +280,9 @@ NoncoherentCache::serviceMSHRTargets(MSHR *mshr, const PacketPtr pkt,
                 (transfer_offset ? pkt->payloadDelay : 0);
 
             assert(tgt_pkt->req->requestorId() < system->maxRequestors());
+            // Shiming: The request crossed the link before recvTime
             stats.cmdStats(tgt_pkt).missLatency[tgt_pkt->req->requestorId()] +=
-                completion_time - target.recvTime;
+                completion_time - target.recvTime + cpuSideLookahead;
 
             tgt_pkt->makeTimingResponse();
             if (pkt->isError())
@@ -289,7 +290,9 @@ NoncoherentCache::serviceMSHRTargets(MSHR *mshr, const PacketPtr pkt,
 
             // Reset the bus additional time as it is now accounted for
             tgt_pkt->headerDelay = tgt_pkt->payloadDelay = 0;
-            cpuSidePort.schedTimingResp(tgt_pkt, completion_time);
+            // Shiming: less the link back to the cpu
+            cpuSidePort.schedTimingResp(tgt_pkt,
+                                        completion_time - cpuSideLookahead);
             break;
 
           case MSHR::Target::FromPrefetcher:
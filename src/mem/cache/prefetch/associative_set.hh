@@ -61,6 +61,8 @@ class AssociativeSet
     replacement_policy::Base* const replacementPolicy;
     /** Vector containing the entries of the container */
     std::vector<Entry> entries;
+    /** Possible entries of the last lookup, reused to avoid allocations */
+    mutable std::vector<ReplaceableEntry *> possibleEntries;
 
   public:
     /**
@@ -95,6 +95,16 @@ class Base : public SimObject
     virtual void reset(const std::shared_ptr<ReplacementData>&
         replacement_data) const = 0;
 
+    /**
+     * Shiming: Make the entry of a low priority insertion the next probable
+     * victim, right after it is reset. Unlike invalidate(), the entry stays
+     * valid, and a later touch() promotes it as usual.
+     *
+     * @param replacement_data Replacement data to be demoted.
+     */
+    virtual void demote(const std::shared_ptr<ReplacementData>&
+        replacement_data) const = 0;
+
     /**
      * Find replacement victim among candidates.
      *
@@ -93,6 +93,14 @@ BRRIP::reset(const std::shared_ptr<ReplacementData>& replacement_data) const
     casted_replacement_data->valid = true;
 }
 
+void
+BRRIP::demote(
+    const std::shared_ptr<ReplacementData>& replacement_data) const
+{
+    std::static_pointer_cast<BRRIPReplData>(
+        replacement_data)->rrpv.saturate();
+}
+
 ReplaceableEntry*
 BRRIP::getVictim(const ReplacementCandidates& candidates) const
 {
@@ -143,6 +143,16 @@ class BRRIP : public Base
     void reset(const std::shared_ptr<ReplacementData>& replacement_data) const
                                                                      override;
 
+    /**
+     * Shiming: Make a valid entry the next probable victim, as a low
+     * priority insertion. Set RRPV as the most distant re-reference, the
+     * entry stays valid.
+     *
+     * @param replacement_data Replacement data to be demoted.
+     */
+    void demote(const std::shared_ptr<ReplacementData>& replacement_data)
+                                                               const override;
+
     /**
      * Find replacement victim using rrpv.
      *
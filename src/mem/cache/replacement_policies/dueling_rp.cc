@@ -106,6 +106,16 @@ Dueling::reset(const std::shared_ptr<ReplacementData>& replacement_data) const
     duelingMonitor.sample(static_cast<Dueler*>(casted_replacement_data.get()));
 }
 
+void
+Dueling::demote(
+    const std::shared_ptr<ReplacementData>& replacement_data) const
+{
+    std::shared_ptr<DuelerReplData> casted_replacement_data =
+        std::static_pointer_cast<DuelerReplData>(replacement_data);
+    replPolicyA->demote(casted_replacement_data->replDataA);
+    replPolicyB->demote(casted_replacement_data->replDataB);
+}
+
 ReplaceableEntry*
 Dueling::getVictim(const ReplacementCandidates& candidates) const
 {
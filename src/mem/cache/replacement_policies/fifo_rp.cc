@@ -68,6 +68,15 @@ FIFO::reset(const std::shared_ptr<ReplacementData>& replacement_data) const
         replacement_data)->tickInserted = curTick();
 }
 
+void
+FIFO::demote(
+    const std::shared_ptr<ReplacementData>& replacement_data) const
+{
+    // Inserted before any other entry
+    std::static_pointer_cast<FIFOReplData>(
+        replacement_data)->tickInserted = Tick(0);
+}
+
 ReplaceableEntry*
 FIFO::getVictim(const ReplacementCandidates& candidates) const
 {
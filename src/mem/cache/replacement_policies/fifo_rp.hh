@@ -95,6 +95,15 @@ class FIFO : public Base
     void reset(const std::shared_ptr<ReplacementData>& replacement_data) const
                                                                      override;
 
+    /**
+     * Shiming: Make a valid entry the next probable victim, as a low
+     * priority insertion. Sets its insertion tick as the oldest possible.
+     *
+     * @param replacement_data Replacement data to be demoted.
+     */
+    void demote(const std::shared_ptr<ReplacementData>& replacement_data)
+                                                               const override;
+
     /**
      * Find replacement victim using insertion timestamps.
      *
@@ -66,6 +66,13 @@ LFU::reset(const std::shared_ptr<ReplacementData>& replacement_data) const
     std::static_pointer_cast<LFUReplData>(replacement_data)->refCount = 1;
 }
 
+void
+LFU::demote(
+    const std::shared_ptr<ReplacementData>& replacement_data) const
+{
+    std::static_pointer_cast<LFUReplData>(replacement_data)->refCount = 0;
+}
+
 ReplaceableEntry*
 LFU::getVictim(const ReplacementCandidates& candidates) const
 {
@@ -95,6 +95,15 @@ class LFU : public Base
     void reset(const std::shared_ptr<ReplacementData>& replacement_data) const
                                                                      override;
 
+    /**
+     * Shiming: Make a valid entry the next probable victim, as a low
+     * priority insertion. Its reference count starts at zero.
+     *
+     * @param replacement_data Replacement data to be demoted.
+     */
+    void demote(const std::shared_ptr<ReplacementData>& replacement_data)
+                                                               const override;
+
     /**
      * Find replacement victim using reference frequency.
      *
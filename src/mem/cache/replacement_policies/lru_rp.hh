@@ -93,6 +93,15 @@ class LRU : public Base
     void reset(const std::shared_ptr<ReplacementData>& replacement_data) const
                                                                      override;
 
+    /**
+     * Shiming: Make a valid entry the next probable victim, as a low
+     * priority insertion. Sets its last touch tick as the oldest possible.
+     *
+     * @param replacement_data Replacement data to be demoted.
+     */
+    void demote(const std::shared_ptr<ReplacementData>& replacement_data)
+                                                               const override;
+
     /**
      * Find replacement victim using LRU timestamps.
      *
@@ -70,6 +70,15 @@ MRU::reset(const std::shared_ptr<ReplacementData>& replacement_data) const
         replacement_data)->lastTouchTick = curTick();
 }
 
+void
+MRU::demote(
+    const std::shared_ptr<ReplacementData>& replacement_data) const
+{
+    // More recent than any entry touched since
+    std::static_pointer_cast<MRUReplData>(
+        replacement_data)->lastTouchTick = MaxTick;
+}
+
 ReplaceableEntry*
 MRU::getVictim(const ReplacementCandidates& candidates) const
 {
@@ -67,6 +67,13 @@ Random::reset(const std::shared_ptr<ReplacementData>& replacement_data) const
         replacement_data)->valid = true;
 }
 
+void
+Random::demote(
+    const std::shared_ptr<ReplacementData>& replacement_data) const
+{
+    // All valid entries are equally likely victims, and this one is valid
+}
+
 ReplaceableEntry*
 Random::getVictim(const ReplacementCandidates& candidates) const
 {
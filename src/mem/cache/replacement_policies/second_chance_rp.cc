@@ -88,6 +88,16 @@ SecondChance::reset(
         replacement_data)->hasSecondChance = false;
 }
 
+void
+SecondChance::demote(
+    const std::shared_ptr<ReplacementData>& replacement_data) const
+{
+    FIFO::demote(replacement_data);
+
+    std::static_pointer_cast<SecondChanceReplData>(
+        replacement_data)->hasSecondChance = false;
+}
+
 ReplaceableEntry*
 SecondChance::getVictim(const ReplacementCandidates& candidates) const
 {
@@ -111,6 +111,14 @@ TreePLRU::TreePLRU(const Params &p)
 
 void
 TreePLRU::invalidate(const std::shared_ptr<ReplacementData>& replacement_data)
+{
+    // Shiming: Same as a demotion, the entry becomes the LRU
+    demote(replacement_data);
+}
+
+void
+TreePLRU::demote(
+    const std::shared_ptr<ReplacementData>& replacement_data) const
 {
     // Cast replacement data
     std::shared_ptr<TreePLRUReplData> treePLRU_replacement_data =
@@ -187,6 +187,16 @@ class TreePLRU : public Base
     void reset(const std::shared_ptr<ReplacementData>& replacement_data) const
                                                                      override;
 
+    /**
+     * Shiming: Make a valid entry the next probable victim, as a low
+     * priority insertion. Makes tree leaf of replacement data the LRU, as
+     * invalidate() does.
+     *
+     * @param replacement_data Replacement data to be demoted.
+     */
+    void demote(const std::shared_ptr<ReplacementData>& replacement_data)
+                                                               const override;
+
     /**
      * Find replacement victim using TreePLRU bits. It is assumed that all
      * candidates share the same replacement data tree.
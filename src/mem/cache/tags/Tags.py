@@ -94,6 +94,14 @@ class BaseSetAssoc(BaseTags):
         Parent.replacement_policy, "Replacement policy"
     )
 
+    # Shiming: host side only, the simulated behaviour is the same
+    packed_tags = Param.Bool(
+        False,
+        "Keep a packed copy of the tags of each set and compare all the "
+        "ways of a set at once on lookups (needs a SetAssociative "
+        "indexing policy)",
+    )
+
 
 class SectorTags(BaseTags):
     type = "SectorTags"
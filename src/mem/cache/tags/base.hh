@@ -50,6 +50,7 @@
 #include <cstdint>
 #include <functional>
 #include <string>
+#include <vector>
 
 #include "base/callback.hh"
 #include "base/logging.hh"
@@ -88,6 +89,12 @@ class BaseTags : public ClockedObject
     /** Indexing policy */
     BaseIndexingPolicy *indexingPolicy;
 
+    /**
+     * The possible entries of the last lookup. Kept across lookups so that
+     * finding a block or a victim does not allocate.
+     */
+    mutable std::vector<ReplaceableEntry*> possibleEntries;
+
     /**
      * The number of tags that need to be touched to meet the warmup
      * percentage.
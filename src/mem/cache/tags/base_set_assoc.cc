@@ -47,7 +47,9 @@
 
 #include <string>
 
+#include "base/bitfield.hh"
 #include "base/intmath.hh"
+#include "mem/cache/tags/indexing_policies/set_associative.hh"
 
 namespace gem5
 {
@@ -55,7 +57,9 @@ namespace gem5
 BaseSetAssoc::BaseSetAssoc(const Params &p)
     :BaseTags(p), allocAssoc(p.assoc), blks(p.size / p.block_size),
      sequentialAccess(p.sequential_access),
-     replacementPolicy(p.replacement_policy)
+     replacementPolicy(p.replacement_policy),
+     usePackedTags(p.packed_tags),
+     setIndexing(dynamic_cast<SetAssociative *>(p.indexing_policy))
 {
     // There must be a indexing policy
     fatal_if(!p.indexing_policy, "An indexing policy is required");
@@ -64,6 +68,12 @@ BaseSetAssoc::BaseSetAssoc(const Params &p)
     if (blkSize < 4 || !isPowerOf2(blkSize)) {
         fatal("Block size must be at least 4 and a power of 2");
     }
+
+    fatal_if(usePackedTags && !setIndexing,
+             "Packed tags need a SetAssociative indexing policy");
+    if (usePackedTags) {
+        packedTags.init(numBlocks / p.assoc, p.assoc);
+    }
 }
 
 void
@@ -95,6 +105,30 @@ BaseSetAssoc::invalidate(CacheBlk *blk)
 
     // Invalidate replacement data
     replacementPolicy->invalidate(blk->replacementData);
+
+    updatePackedTag(blk);
+}
+
+CacheBlk*
+BaseSetAssoc::findBlock(Addr addr, bool is_secure) const
+{
+    if (!usePackedTags) {
+        return BaseTags::findBlock(addr, is_secure);
+    }
+
+    const Addr tag = extractTag(addr);
+    const uint32_t set = setIndexing->extractSet(addr);
+    uint64_t ways = packedTags.match(set, PackedTags::key(tag, is_secure));
+
+    // There is at most one match, check it against the block anyway
+    for (; ways != 0; ways &= ways - 1) {
+        CacheBlk* blk = static_cast<CacheBlk*>(
+            indexingPolicy->getEntry(set, ctz64(ways)));
+        if (blk->matchTag(tag, is_secure)) {
+            return blk;
+        }
+    }
+    return nullptr;
 }
 
 void
@@ -107,6 +141,9 @@ BaseSetAssoc::moveBlock(CacheBlk *src_blk, CacheBlk *dest_blk)
     // the one that is being moved.
     replacementPolicy->invalidate(src_blk->replacementData);
     replacementPolicy->reset(dest_blk->replacementData);
+
+    updatePackedTag(src_blk);
+    updatePackedTag(dest_blk);
 }
 
 } // namespace gem5
@@ -59,12 +59,15 @@
 #include "mem/cache/replacement_policies/replaceable_entry.hh"
 #include "mem/cache/tags/base.hh"
 #include "mem/cache/tags/indexing_policies/base.hh"
+#include "mem/cache/tags/packed_tags.hh"
 #include "mem/packet.hh"
 #include "params/BaseSetAssoc.hh"
 
 namespace gem5
 {
 
+class SetAssociative;
+
 /**
  * A basic cache tag store.
  * @sa  \ref gem5MemorySystem "gem5 Memory System"
@@ -87,6 +90,26 @@ class BaseSetAssoc : public BaseTags
     /** Replacement policy */
     replacement_policy::Base *replacementPolicy;
 
+    /**
+     * Whether lookups compare the packed copy of the tags instead of the
+     * tags of the blocks. Only with a SetAssociative indexing policy, whose
+     * sets hold the blocks of a set.
+     */
+    const bool usePackedTags;
+    PackedTags packedTags;
+    SetAssociative *setIndexing;
+
+    /** Copy the tag and state of blk into the packed tags, if used */
+    void
+    updatePackedTag(const CacheBlk *blk)
+    {
+        if (usePackedTags) {
+            packedTags.set(blk->getSet(), blk->getWay(), blk->isValid() ?
+                PackedTags::key(blk->getTag(), blk->isSecure()) :
+                PackedTags::Invalid);
+        }
+    }
+
   public:
     /** Convenience typedef. */
      typedef BaseSetAssocParams Params;
@@ -114,6 +137,12 @@ class BaseSetAssoc : public BaseTags
      */
     void invalidate(CacheBlk *blk) override;
 
+    /**
+     * Find the block of an address. With packed tags all the ways of the
+     * set are compared at once, and only the matching block is touched.
+     */
+    CacheBlk *findBlock(Addr addr, bool is_secure) const override;
+
     /**
      * Access block and update replacement data. May not succeed, in which case
      * nullptr is returned. This has all the implications of a cache access and
@@ -170,12 +199,11 @@ class BaseSetAssoc : public BaseTags
                          std::vector<CacheBlk*>& evict_blks) override
     {
         // Get possible entries to be victimized
-        const std::vector<ReplaceableEntry*> entries =
-            indexingPolicy->getPossibleEntries(addr);
+        indexingPolicy->getPossibleEntries(addr, possibleEntries);
 
         // Choose replacement victim from replacement candidates
         CacheBlk* victim = static_cast<CacheBlk*>(replacementPolicy->getVictim(
-                                entries));
+                                possibleEntries));
 
         // There is only one eviction for this replacement
         evict_blks.push_back(victim);
@@ -199,6 +227,8 @@ class BaseSetAssoc : public BaseTags
 
         // Update replacement policy
         replacementPolicy->reset(blk->replacementData, pkt);
+
+        updatePackedTag(blk);
     }
 
     void moveBlock(CacheBlk *src_blk, CacheBlk *dest_blk) override;
@@ -107,8 +107,7 @@ CompressedTags::findVictim(Addr addr, const bool is_secure,
                            std::vector<CacheBlk*>& evict_blks)
 {
     // Get all possible locations of this superblock
-    const std::vector<ReplaceableEntry*> superblock_entries =
-        indexingPolicy->getPossibleEntries(addr);
+    indexingPolicy->getPossibleEntries(addr, possibleEntries);
 
     // Check if the superblock this address belongs to has been allocated. If
     // so, try co-allocating
@@ -116,7 +115,7 @@ CompressedTags::findVictim(Addr addr, const bool is_secure,
     SuperBlk* victim_superblock = nullptr;
     bool is_co_allocation = false;
     const uint64_t offset = extractSectorOffset(addr);
-    for (const auto& entry : superblock_entries){
+    for (const auto& entry : possibleEntries){
         SuperBlk* superblock = static_cast<SuperBlk*>(entry);
         if (superblock->matchTag(tag, is_secure) &&
             !superblock->blks[offset]->isValid() &&
@@ -134,7 +133,7 @@ CompressedTags::findVictim(Addr addr, const bool is_secure,
     if (victim_superblock == nullptr){
         // Choose replacement victim from replacement candidates
         victim_superblock = static_cast<SuperBlk*>(
-            replacementPolicy->getVictim(superblock_entries));
+            replacementPolicy->getVictim(possibleEntries));
 
         // The whole superblock must be evicted to make room for the new one
         for (const auto& blk : victim_superblock->blks){
@@ -143,11 +143,30 @@ class BaseIndexingPolicy : public SimObject
      * Should be called immediately before ReplacementPolicy's findVictim()
      * not to break cache resizing.
      *
+     * The entries are written into a vector owned by the caller, which is
+     * cleared first. Callers on the lookup path keep that vector around, so
+     * that no memory is allocated once it has grown to the associativity.
+     *
+     * @param addr The addr to a find possible entries for.
+     * @param entries The possible entries.
+     */
+    virtual void getPossibleEntries(const Addr addr,
+        std::vector<ReplaceableEntry*> &entries) const = 0;
+
+    /**
+     * Find all possible entries of an address, in a new vector. This
+     * allocates on every call, prefer the version above on hot paths.
+     *
      * @param addr The addr to a find possible entries for.
      * @return The possible entries.
      */
-    virtual std::vector<ReplaceableEntry*> getPossibleEntries(const Addr addr)
-                                                                    const = 0;
+    std::vector<ReplaceableEntry*>
+    getPossibleEntries(const Addr addr) const
+    {
+        std::vector<ReplaceableEntry*> entries;
+        getPossibleEntries(addr, entries);
+        return entries;
+    }
 
     /**
      * Regenerate an entry's address from its tag and assigned indexing bits.
@@ -69,10 +69,12 @@ SetAssociative::regenerateAddr(const Addr tag, const ReplaceableEntry* entry)
     return (tag << tagShift) | (entry->getSet() << setShift);
 }
 
-std::vector<ReplaceableEntry*>
-SetAssociative::getPossibleEntries(const Addr addr) const
+void
+SetAssociative::getPossibleEntries(const Addr addr,
+    std::vector<ReplaceableEntry*> &entries) const
 {
-    return sets[extractSet(addr)];
+    // Copy assignment reuses the storage of entries if it is large enough
+    entries = sets[extractSet(addr)];
 }
 
 } // namespace gem5
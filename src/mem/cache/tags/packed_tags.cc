@@ -0,0 +1,124 @@
+/**
+ * 2023 Feb
+ * Shiming Li
+ * shiming.li@it.uu.se
+ *
+ * Uppsala Architecture Research Team (UART)
+ * Uppsala University
+ *
+ * The kernels of PackedTags::match(). The SIMD ones are compiled for their
+ *  instruction set with a target attribute, as a default build targets
+ *  the baseline x86-64 (no -msse4.1 or -mavx2), and are only called if
+ *  the host supports it.
+ */
+
+#include "mem/cache/tags/packed_tags.hh"
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define PACKED_TAGS_SIMD 1
+#include <immintrin.h>
+
+#endif
+
+namespace gem5
+{
+
+namespace
+{
+
+uint64_t
+matchScalar(const Addr *ways, unsigned assoc, Addr k)
+{
+    uint64_t hits = 0;
+    for (unsigned way = 0; way < assoc; way++) {
+        if (ways[way] == k) {
+            hits |= 1ULL << way;
+        }
+    }
+    return hits;
+}
+
+#ifdef PACKED_TAGS_SIMD
+
+__attribute__((target("sse4.1"))) uint64_t
+matchSse41(const Addr *ways, unsigned assoc, Addr k)
+{
+    uint64_t hits = 0;
+    unsigned way = 0;
+    const __m128i k2 = _mm_set1_epi64x(k);
+    for (; way + 2 <= assoc; way += 2) {
+        const __m128i v = _mm_loadu_si128(
+            reinterpret_cast<const __m128i *>(ways + way));
+        const uint64_t eq = _mm_movemask_pd(
+            _mm_castsi128_pd(_mm_cmpeq_epi64(v, k2)));
+        hits |= eq << way;
+    }
+    // The ways left
+    for (; way < assoc; way++) {
+        if (ways[way] == k) {
+            hits |= 1ULL << way;
+        }
+    }
+    return hits;
+}
+
+__attribute__((target("avx2"))) uint64_t
+matchAvx2(const Addr *ways, unsigned assoc, Addr k)
+{
+    uint64_t hits = 0;
+    unsigned way = 0;
+    const __m256i k4 = _mm256_set1_epi64x(k);
+    for (; way + 4 <= assoc; way += 4) {
+        const __m256i v = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i *>(ways + way));
+        const uint64_t eq = _mm256_movemask_pd(
+            _mm256_castsi256_pd(_mm256_cmpeq_epi64(v, k4)));
+        hits |= eq << way;
+    }
+    for (; way < assoc; way++) {
+        if (ways[way] == k) {
+            hits |= 1ULL << way;
+        }
+    }
+    return hits;
+}
+
+#endif
+
+PackedTags::MatchFunc
+pickBest()
+{
+    PackedTags::MatchFunc func =
+        PackedTags::matchFunc(PackedTags::Simd::Avx2);
+    if (!func) {
+        func = PackedTags::matchFunc(PackedTags::Simd::Sse41);
+    }
+    return func ? func : PackedTags::matchFunc(PackedTags::Simd::None);
+}
+
+} // anonymous namespace
+
+PackedTags::MatchFunc
+PackedTags::matchFunc(Simd simd)
+{
+#ifdef PACKED_TAGS_SIMD
+    // May run before the constructors that would have done it
+    __builtin_cpu_init();
+#endif
+    switch (simd) {
+      case Simd::None:
+        return matchScalar;
+#ifdef PACKED_TAGS_SIMD
+      case Simd::Sse41:
+        return __builtin_cpu_supports("sse4.1") ? matchSse41 : nullptr;
+      case Simd::Avx2:
+        return __builtin_cpu_supports("avx2") ? matchAvx2 : nullptr;
+#endif
+      default:
+        return nullptr;
+    }
+}
+
+const PackedTags::MatchFunc PackedTags::bestMatch = pickBest();
+
+} // namespace gem5
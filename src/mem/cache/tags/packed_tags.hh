@@ -0,0 +1,101 @@
+/**
+ * 2023 Feb
+ * Shiming Li
+ * shiming.li@it.uu.se
+ *
+ * Uppsala Architecture Research Team (UART)
+ * Uppsala University
+ *
+ * A packed copy of the tags of a set associative tag store, see
+ *  BaseSetAssoc (packed_tags).
+ */
+
+#ifndef __MEM_CACHE_TAGS_PACKED_TAGS_HH__
+#define __MEM_CACHE_TAGS_PACKED_TAGS_HH__
+
+#include <cstdint>
+#include <vector>
+
+#include "base/logging.hh"
+#include "base/types.hh"
+
+namespace gem5
+{
+
+/**
+ * The tags of a set associative tag store in one array, the ways of a set
+ * next to each other, so that a lookup compares all the ways of a set
+ * without touching the blocks. Each way keeps its tag and secure bit in
+ * one word, and Invalid if its block is not valid.
+ *
+ * The ways are compared four (AVX2) or two (SSE4.1) at a time when the
+ * host supports it. The kernels are built for their instruction set
+ * whatever the compiler flags of the build, and the best one the host
+ * supports is picked once at startup (x86 hosts with GCC or clang only,
+ * others always compare one way at a time). See packed_tags.cc.
+ *
+ * The blocks stay the reference: the tag store updates this copy whenever
+ * it inserts, moves or invalidates a block.
+ */
+class PackedTags
+{
+  public:
+    /** No tag packs to this, as tags never use the top bits */
+    static constexpr Addr Invalid = MaxAddr;
+
+    /** Compares assoc ways with k, one bit per way in the result */
+    typedef uint64_t (*MatchFunc)(const Addr *ways, unsigned assoc, Addr k);
+
+    enum class Simd
+    {
+        None,
+        Sse41,
+        Avx2
+    };
+
+    /** The kernel of an instruction set, nullptr if the host lacks it */
+    static MatchFunc matchFunc(Simd simd);
+
+    static Addr
+    key(Addr tag, bool is_secure)
+    {
+        return (tag << 1) | (is_secure ? 1 : 0);
+    }
+
+    void
+    init(uint32_t num_sets, unsigned _assoc)
+    {
+        fatal_if(_assoc > 64, "Packed tags support up to 64 ways, not %d",
+                 _assoc);
+        assoc = _assoc;
+        keys.assign(num_sets * assoc, Invalid);
+    }
+
+    void
+    set(uint32_t set, uint32_t way, Addr k)
+    {
+        keys[set * assoc + way] = k;
+    }
+
+    /**
+     * Compare the ways of a set with a key.
+     *
+     * @return The ways holding k, one bit per way.
+     */
+    uint64_t
+    match(uint32_t set, Addr k) const
+    {
+        return bestMatch(&keys[set * assoc], assoc, k);
+    }
+
+  private:
+    /** The fastest kernel of the host */
+    static const MatchFunc bestMatch;
+
+    unsigned assoc = 0;
+    std::vector<Addr> keys;
+};
+
+} // namespace gem5
+
+#endif //__MEM_CACHE_TAGS_PACKED_TAGS_HH__
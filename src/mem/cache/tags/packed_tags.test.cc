@@ -0,0 +1,103 @@
+/**
+ * 2023 Feb
+ * Shiming Li
+ * shiming.li@it.uu.se
+ *
+ * Uppsala Architecture Research Team (UART)
+ * Uppsala University
+ *
+ * Every kernel of PackedTags::match() the host supports gives the ways
+ *  a one way at a time comparison gives.
+ */
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "mem/cache/tags/packed_tags.hh"
+
+using namespace gem5;
+
+namespace
+{
+
+uint64_t
+reference(const std::vector<Addr> &ways, Addr k)
+{
+    uint64_t hits = 0;
+    for (unsigned way = 0; way < ways.size(); way++) {
+        if (ways[way] == k) {
+            hits |= 1ULL << way;
+        }
+    }
+    return hits;
+}
+
+/**
+ * Ways drawn from a few keys, so that sets hold the key several times,
+ *  with invalid ways in between
+ */
+std::vector<Addr>
+randomWays(std::mt19937_64 &rng, unsigned assoc)
+{
+    std::vector<Addr> ways(assoc);
+    for (Addr &way : ways) {
+        unsigned pick = rng() % 5;
+        way = pick == 0 ? PackedTags::Invalid
+                        : PackedTags::key(0x1000 + pick, pick & 1);
+    }
+    return ways;
+}
+
+} // anonymous namespace
+
+TEST(PackedTagsTest, KernelsMatchReference)
+{
+    std::mt19937_64 rng(1);
+    for (PackedTags::Simd simd : {PackedTags::Simd::None,
+            PackedTags::Simd::Sse41, PackedTags::Simd::Avx2}) {
+        PackedTags::MatchFunc func = PackedTags::matchFunc(simd);
+        if (!func) {
+            continue;
+        }
+        // Odd associativities leave ways after the vectors
+        for (unsigned assoc = 1; assoc <= 64; assoc++) {
+            for (int i = 0; i < 50; i++) {
+                std::vector<Addr> ways = randomWays(rng, assoc);
+                Addr k = ways[rng() % assoc];
+                EXPECT_EQ(func(ways.data(), assoc, k), reference(ways, k))
+                    << "simd " << (int)simd << " assoc " << assoc;
+                Addr missing = PackedTags::key(0x2000, false);
+                EXPECT_EQ(func(ways.data(), assoc, missing), 0u);
+            }
+        }
+    }
+}
+
+TEST(PackedTagsTest, MatchSets)
+{
+    const unsigned assoc = 16;
+    const uint32_t num_sets = 8;
+    PackedTags tags;
+    tags.init(num_sets, assoc);
+    std::mt19937_64 rng(2);
+    std::vector<std::vector<Addr>> sets;
+    for (uint32_t set = 0; set < num_sets; set++) {
+        sets.push_back(randomWays(rng, assoc));
+        for (unsigned way = 0; way < assoc; way++) {
+            tags.set(set, way, sets[set][way]);
+        }
+    }
+    for (uint32_t set = 0; set < num_sets; set++) {
+        for (Addr k : sets[set]) {
+            EXPECT_EQ(tags.match(set, k), reference(sets[set], k));
+        }
+    }
+    // Ways that were never set are invalid
+    PackedTags empty;
+    empty.init(1, assoc);
+    EXPECT_EQ(empty.match(0, PackedTags::key(0x1001, true)), 0u);
+    EXPECT_EQ(empty.match(0, PackedTags::Invalid), (1ULL << assoc) - 1);
+}
@@ -0,0 +1,609 @@
+/**
+ * 2023 Feb
+ * Shiming Li
+ * shiming.li@it.uu.se
+ *
+ * Uppsala Architecture Research Team (UART)
+ * Uppsala University
+ *
+ * The chunked checkpoint format of the backing stores, see
+ *  chunked_store.hh.
+ */
+
+#include "mem/chunked_store.hh"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <random>
+#include <thread>
+
+#include "base/cprintf.hh"
+#include "base/intmath.hh"
+#include "base/logging.hh"
+
+namespace gem5
+{
+
+namespace memory
+{
+
+namespace
+{
+
+const char Magic[8] = {'g', 'e', 'm', '5', 'c', 'h', 'n', 'k'};
+const uint32_t Version = 2;
+
+/**
+ * Magic, version, depth, file and parent IDs, sizes, index offset and
+ *  parent length
+ */
+const size_t FixedHeaderBytes = 60;
+/** Offset, length, hash and kind */
+const size_t EntryBytes = 25;
+
+/** Soft-dirty bit of the /proc/self/pagemap entries */
+const uint64_t SoftDirtyBit = 1ULL << 55;
+
+/** Append an integer to a buffer, little endian */
+void
+put(std::string &buf, uint64_t value, int bytes)
+{
+    for (int i = 0; i < bytes; i++)
+        buf.push_back((char)(value >> (8 * i)));
+}
+
+/** Take a little endian integer from the front of a buffer */
+uint64_t
+get(const uint8_t *&p, int bytes)
+{
+    uint64_t value = 0;
+    for (int i = 0; i < bytes; i++)
+        value |= (uint64_t)*p++ << (8 * i);
+    return value;
+}
+
+bool
+writeAll(int fd, const void *buf, uint64_t len, uint64_t offset)
+{
+    const uint8_t *p = (const uint8_t *)buf;
+    while (len > 0) {
+        ssize_t done = pwrite(fd, p, std::min<uint64_t>(len, INT_MAX),
+                              offset);
+        if (done < 0 && errno == EINTR)
+            continue;
+        if (done <= 0)
+            return false;
+        p += done;
+        len -= done;
+        offset += done;
+    }
+    return true;
+}
+
+bool
+readAll(int fd, void *buf, uint64_t len, uint64_t offset)
+{
+    uint8_t *p = (uint8_t *)buf;
+    while (len > 0) {
+        ssize_t done = pread(fd, p, std::min<uint64_t>(len, INT_MAX),
+                             offset);
+        if (done < 0 && errno == EINTR)
+            continue;
+        if (done <= 0)
+            return false;
+        p += done;
+        len -= done;
+        offset += done;
+    }
+    return true;
+}
+
+uint64_t
+rotl(uint64_t x, int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+/**
+ * Hash of a chunk, in one pass of four lanes of multiply and rotate over
+ *  its words, and 0 if and only if it is all zero.
+ */
+uint64_t
+hashChunk(const uint8_t *data, uint64_t size)
+{
+    const uint64_t prime = 0x9e3779b97f4a7c15ULL;
+    uint64_t lane[4] = {1, 2, 3, 4};
+    uint64_t any = 0;
+    uint64_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        for (int l = 0; l < 4; l++) {
+            uint64_t word;
+            std::memcpy(&word, data + i + 8 * l, sizeof(word));
+            any |= word;
+            lane[l] = rotl(lane[l] + word * prime, 31) * prime;
+        }
+    }
+    for (; i < size; i++) {
+        any |= data[i];
+        lane[0] = rotl(lane[0] + data[i] * prime, 31) * prime;
+    }
+    if (!any)
+        return 0;
+
+    uint64_t hash = size;
+    for (int l = 0; l < 4; l++)
+        hash = rotl(hash ^ lane[l], 27) * prime;
+    hash ^= hash >> 32;
+    return hash ? hash : 1;
+}
+
+/** Copy the pages that are not all zero, the others stay untouched */
+void
+copyNonZeroPages(uint8_t *dest, const uint8_t *src, uint64_t size,
+                 uint64_t page)
+{
+    for (uint64_t p = 0; p < size; p += page) {
+        const uint64_t len = std::min(page, size - p);
+        const uint64_t *words = (const uint64_t *)(src + p);
+        bool zero = true;
+        for (uint64_t w = 0; w < len / sizeof(uint64_t) && zero; w++)
+            zero = words[w] == 0;
+        for (uint64_t b = len & ~(sizeof(uint64_t) - 1); b < len && zero;
+             b++) {
+            zero = src[p + b] == 0;
+        }
+        if (!zero)
+            std::memcpy(dest + p, src + p, len);
+    }
+}
+
+std::string
+dirName(const std::string &path)
+{
+    const size_t slash = path.rfind('/');
+    if (slash == std::string::npos)
+        return ".";
+    return slash == 0 ? "/" : path.substr(0, slash);
+}
+
+std::string
+baseName(const std::string &path)
+{
+    const size_t slash = path.rfind('/');
+    return slash == std::string::npos ? path : path.substr(slash + 1);
+}
+
+std::string
+realDir(const std::string &path)
+{
+    char *real = realpath(dirName(path).c_str(), nullptr);
+    fatal_if(!real, "Can't find the directory of '%s'", path);
+    std::string dir(real);
+    std::free(real);
+    return dir;
+}
+
+/**
+ * Path of a file as seen from the directory of another one. Checkpoint
+ *  directories usually sit side by side (m5out/cpt.*), then they can be
+ *  moved together.
+ */
+std::string
+relativePath(const std::string &target, const std::string &from)
+{
+    const std::string target_dir = realDir(target);
+    const std::string from_dir = realDir(from);
+    if (target_dir == from_dir)
+        return baseName(target);
+    if (dirName(target_dir) == dirName(from_dir))
+        return "../" + baseName(target_dir) + "/" + baseName(target);
+    return target_dir + "/" + baseName(target);
+}
+
+/** Run a job on a number of threads, the calling one included */
+template <class Job>
+void
+runThreads(unsigned threads, uint64_t chunks, Job job)
+{
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = std::min<uint64_t>(threads, std::max<uint64_t>(chunks, 1));
+
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < threads; t++)
+        pool.emplace_back(job);
+    job();
+    for (auto &t : pool)
+        t.join();
+}
+
+} // anonymous namespace
+
+ChunkedStore::Index
+ChunkedStore::readIndex(const std::string &path)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    fatal_if(fd < 0, "Can't open physical memory checkpoint file '%s'",
+             path);
+
+    uint8_t fixed[FixedHeaderBytes];
+    fatal_if(!readAll(fd, fixed, sizeof(fixed), 0) ||
+             std::memcmp(fixed, Magic, sizeof(Magic)),
+             "'%s' is not a chunked physical memory checkpoint file", path);
+
+    Index index;
+    index.path = path;
+    const uint8_t *p = fixed + sizeof(Magic);
+    const uint64_t version = get(p, 4);
+    fatal_if(version != Version, "'%s' has version %d of the chunked "
+             "format, expected %d", path, version, Version);
+    index.depth = get(p, 4);
+    index.id = get(p, 8);
+    index.parentId = get(p, 8);
+    index.storeSize = get(p, 8);
+    index.chunkSize = get(p, 8);
+    const uint64_t index_offset = get(p, 8);
+    const uint64_t parent_len = get(p, 4);
+    fatal_if(index.chunkSize == 0, "'%s' has no chunk size", path);
+
+    std::string parent(parent_len, '\0');
+    fatal_if(!readAll(fd, &parent[0], parent_len, FixedHeaderBytes),
+             "Read failed on physical memory checkpoint file '%s'", path);
+    if (!parent.empty()) {
+        index.parent = parent[0] == '/' ? parent :
+            dirName(path) + "/" + parent;
+    }
+    fatal_if(index.parent.empty() != (index.depth == 0),
+             "'%s' has depth %d and parent '%s'", path, index.depth,
+             parent);
+
+    const uint64_t chunks = divCeil(index.storeSize, index.chunkSize);
+    std::vector<uint8_t> raw(chunks * EntryBytes);
+    fatal_if(!readAll(fd, raw.data(), raw.size(), index_offset),
+             "Read failed on the index of '%s'", path);
+    close(fd);
+
+    index.entries.resize(chunks);
+    p = raw.data();
+    for (auto &e : index.entries) {
+        e.offset = get(p, 8);
+        e.length = get(p, 8);
+        e.hash = get(p, 8);
+        const uint64_t kind = get(p, 1);
+        fatal_if(kind > (uint64_t)Kind::Parent ||
+                 (kind == (uint64_t)Kind::Parent && index.depth == 0),
+                 "'%s' has a bad index entry", path);
+        e.kind = (Kind)kind;
+    }
+    return index;
+}
+
+ChunkedStore::Summary
+ChunkedStore::write(const std::string &path, const uint8_t *pmem,
+                    uint64_t size, const Config &config, const Index *parent,
+                    bool dirty_bits)
+{
+    const uint64_t page = sysconf(_SC_PAGESIZE);
+    const uint64_t chunk_size = config.chunkSize;
+    fatal_if(chunk_size == 0 || chunk_size % page, "The chunk size of the "
+             "memory checkpoints (%d) must be a multiple of the page size "
+             "(%d)", chunk_size, page);
+    panic_if(parent && (parent->storeSize != size ||
+                        parent->chunkSize != chunk_size),
+             "'%s' is not a parent for '%s'", parent->path, path);
+
+    const uint64_t chunks = divCeil(size, chunk_size);
+
+    // A new file, a restore may still have the old one mapped
+    unlink(path.c_str());
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    fatal_if(fd < 0, "Can't open physical memory checkpoint file '%s'",
+             path);
+
+    int pagemap = -1;
+    if (parent && dirty_bits) {
+        pagemap = open("/proc/self/pagemap", O_RDONLY);
+        fatal_if(pagemap < 0, "Can't open /proc/self/pagemap");
+    }
+
+    std::string header(Magic, sizeof(Magic));
+    put(header, Version, 4);
+    put(header, parent ? parent->depth + 1 : 0, 4);
+    // A file written again at the same path gets another ID, so that its
+    //  old children can tell
+    std::random_device entropy;
+    put(header, (uint64_t)entropy() << 32 | entropy(), 8);
+    put(header, parent ? parent->id : 0, 8);
+    put(header, size, 8);
+    put(header, chunk_size, 8);
+    const size_t index_field = header.size();
+    put(header, 0, 8);
+    const std::string parent_path =
+        parent ? relativePath(parent->path, path) : "";
+    put(header, parent_path.size(), 4);
+    header += parent_path;
+
+    // With level 0 the file mirrors the store, with holes for the chunks
+    //  it does not hold, so that neighbouring chunks map as one
+    const uint64_t data_start = roundUp(header.size(), page);
+    const bool mirror = config.level == 0;
+
+    std::vector<Entry> entries(chunks);
+    std::atomic<uint64_t> next(0);
+    std::mutex lock;
+    uint64_t cursor = mirror ? data_start + size : data_start;
+    std::string error;
+
+    runThreads(config.threads, chunks, [&]() {
+        std::vector<uint8_t> packed(compressBound(chunk_size));
+        for (uint64_t i = next++; i < chunks; i = next++) {
+            const uint64_t start = i * chunk_size;
+            const uint64_t len = std::min(chunk_size, size - start);
+            const uint8_t *data = pmem + start;
+            Entry &e = entries[i];
+            const Entry *old = parent ? &parent->entries[i] : nullptr;
+
+            if (old && pagemap >= 0 &&
+                !SoftDirty::dirty(pagemap, data, len)) {
+                // Not written since the parent, no need to read it
+                e.hash = old->hash;
+                e.kind = old->hash ? Kind::Parent : Kind::Zero;
+                continue;
+            }
+
+            e.hash = hashChunk(data, len);
+            if (e.hash == 0) {
+                e.kind = Kind::Zero;
+                continue;
+            }
+            if (old && old->hash == e.hash) {
+                e.kind = Kind::Parent;
+                continue;
+            }
+
+            const uint8_t *out = data;
+            e.kind = Kind::Raw;
+            e.length = len;
+            if (config.level > 0) {
+                uLongf packed_len = packed.size();
+                if (compress2(packed.data(), &packed_len, data, len,
+                              config.level) == Z_OK && packed_len < len) {
+                    out = packed.data();
+                    e.kind = Kind::Zlib;
+                    e.length = packed_len;
+                }
+            }
+
+            if (mirror) {
+                e.offset = data_start + start;
+            } else {
+                std::lock_guard<std::mutex> guard(lock);
+                if (e.kind == Kind::Raw)
+                    cursor = roundUp(cursor, page);
+                e.offset = cursor;
+                cursor += e.length;
+            }
+
+            if (!writeAll(fd, out, e.length, e.offset)) {
+                std::lock_guard<std::mutex> guard(lock);
+                error = std::strerror(errno);
+                return;
+            }
+        }
+    });
+
+    if (pagemap >= 0)
+        close(pagemap);
+    fatal_if(!error.empty(), "Write failed on physical memory checkpoint "
+             "file '%s': %s", path, error);
+
+    Summary summary;
+    std::string index;
+    index.reserve(chunks * EntryBytes);
+    for (const auto &e : entries) {
+        put(index, e.offset, 8);
+        put(index, e.length, 8);
+        put(index, e.hash, 8);
+        put(index, (uint64_t)e.kind, 1);
+        summary.chunks[(int)e.kind]++;
+        if (e.kind == Kind::Raw || e.kind == Kind::Zlib)
+            summary.bytes += e.length;
+    }
+
+    std::string index_offset;
+    put(index_offset, cursor, 8);
+    header.replace(index_field, 8, index_offset);
+
+    fatal_if(!writeAll(fd, index.data(), index.size(), cursor) ||
+             !writeAll(fd, header.data(), header.size(), 0) || close(fd),
+             "Write failed on physical memory checkpoint file '%s'", path);
+    return summary;
+}
+
+void
+ChunkedStore::restore(const std::string &path, uint8_t *pmem,
+                      uint64_t size, const Config &config, bool may_map)
+{
+    const uint64_t page = sysconf(_SC_PAGESIZE);
+
+    // The file and its parents, each chunk is in the first one that does
+    //  not point further up
+    std::vector<Index> chain;
+    chain.push_back(readIndex(path));
+    while (chain.back().depth > 0) {
+        const std::string parent = chain.back().parent;
+        const unsigned depth = chain.back().depth;
+        const uint64_t parent_id = chain.back().parentId;
+        chain.push_back(readIndex(parent));
+        fatal_if(chain.back().depth + 1 != depth ||
+                 chain.back().id != parent_id, "'%s' is not the parent of "
+                 "'%s' any more", parent, chain[chain.size() - 2].path);
+    }
+
+    const uint64_t chunk_size = chain.front().chunkSize;
+    std::vector<int> fds;
+    for (const auto &index : chain) {
+        fatal_if(index.storeSize != size, "Memory range size has changed! "
+                 "Saw %lld, expected %lld\n", index.storeSize, size);
+        fatal_if(index.chunkSize != chunk_size, "'%s' has chunks of %d "
+                 "bytes, its child '%s' of %d", index.path, index.chunkSize,
+                 path, chunk_size);
+        fds.push_back(open(index.path.c_str(), O_RDONLY));
+        fatal_if(fds.back() < 0, "Can't open physical memory checkpoint "
+                 "file '%s'", index.path);
+    }
+
+    // The chunks found up the chain must be the ones the file saved
+    const uint64_t chunks = chain.front().entries.size();
+    for (uint64_t i = 0; i < chunks; i++) {
+        size_t f = 0;
+        while (chain[f].entries[i].kind == Kind::Parent)
+            f++;
+        fatal_if(chain[f].entries[i].hash != chain.front().entries[i].hash,
+                 "Chunk %d of '%s' is not the one '%s' saved", i,
+                 chain[f].path, path);
+    }
+
+    const bool map = may_map && config.mmapRestore;
+    std::atomic<uint64_t> next(0);
+    std::atomic<uint64_t> unmapped(0);
+    std::mutex lock;
+    std::string error;
+
+    runThreads(config.threads, chunks, [&]() {
+        std::vector<uint8_t> packed;
+        std::vector<uint8_t> unpacked(chunk_size);
+        for (uint64_t i = next++; i < chunks; i = next++) {
+            size_t f = 0;
+            while (chain[f].entries[i].kind == Kind::Parent)
+                f++;
+            const Entry &e = chain[f].entries[i];
+            const uint64_t start = i * chunk_size;
+            const uint64_t len = std::min(chunk_size, size - start);
+
+            const char *failed = nullptr;
+            if (e.kind == Kind::Raw) {
+                if (map && len % page == 0) {
+                    // Copy on write, the file is only read on a fault
+                    if (mmap(pmem + start, len, PROT_READ | PROT_WRITE,
+                             MAP_PRIVATE | MAP_FIXED, fds[f], e.offset) !=
+                        MAP_FAILED) {
+                        continue;
+                    }
+                    // Most likely out of mappings (vm.max_map_count)
+                    unmapped++;
+                }
+                if (e.length != len ||
+                    !readAll(fds[f], unpacked.data(), len, e.offset)) {
+                    failed = "read";
+                }
+            } else if (e.kind == Kind::Zlib) {
+                packed.resize(e.length);
+                uLongf unpacked_len = len;
+                if (!readAll(fds[f], packed.data(), e.length, e.offset)) {
+                    failed = "read";
+                } else if (uncompress(unpacked.data(), &unpacked_len,
+                                      packed.data(), e.length) != Z_OK ||
+                           unpacked_len != len) {
+                    failed = "decompression";
+                }
+            } else {
+                continue;
+            }
+
+            if (failed) {
+                std::lock_guard<std::mutex> guard(lock);
+                error = csprintf("%s of chunk %d of '%s' failed", failed, i,
+                                 chain[f].path);
+                return;
+            }
+            copyNonZeroPages(pmem + start, unpacked.data(), len, page);
+        }
+    });
+
+    for (int fd : fds)
+        close(fd);
+    fatal_if(!error.empty(), "Restoring physical memory from '%s': %s",
+             path, error);
+    warn_if(unmapped > 0, "%d chunks of '%s' could not be mapped and were "
+            "read instead", unmapped.load(), path);
+}
+
+bool
+SoftDirty::supported()
+{
+#if defined(__linux__)
+    // Clear the bits of a page, and see them set again by a write
+    static const bool works = []() {
+        const uint64_t page = sysconf(_SC_PAGESIZE);
+        uint8_t *probe = (uint8_t *)mmap(nullptr, page,
+                                         PROT_READ | PROT_WRITE,
+                                         MAP_ANON | MAP_PRIVATE, -1, 0);
+        int pagemap = open("/proc/self/pagemap", O_RDONLY);
+        bool ok = probe != MAP_FAILED && pagemap >= 0;
+        if (ok) {
+            *(volatile uint8_t *)probe = 1;
+            ok = clear() && !dirty(pagemap, probe, page);
+            *(volatile uint8_t *)probe = 2;
+            ok = ok && dirty(pagemap, probe, page);
+        }
+        if (probe != MAP_FAILED)
+            munmap(probe, page);
+        if (pagemap >= 0)
+            close(pagemap);
+        return ok;
+    }();
+    return works;
+#else
+    return false;
+#endif
+}
+
+bool
+SoftDirty::clear()
+{
+    int fd = open("/proc/self/clear_refs", O_WRONLY);
+    if (fd < 0)
+        return false;
+    const bool ok = ::write(fd, "4", 1) == 1;
+    close(fd);
+    return ok;
+}
+
+bool
+SoftDirty::dirty(int pagemap, const uint8_t *start, uint64_t size)
+{
+    const uint64_t page = sysconf(_SC_PAGESIZE);
+    uint64_t first = (uintptr_t)start / page;
+    const uint64_t end = divCeil((uintptr_t)start + size, page);
+
+    uint64_t entries[512];
+    while (first < end) {
+        const uint64_t n = std::min<uint64_t>(end - first, 512);
+        // When in doubt, it was written
+        if (!readAll(pagemap, entries, n * sizeof(uint64_t),
+                     first * sizeof(uint64_t))) {
+            return true;
+        }
+        for (uint64_t i = 0; i < n; i++) {
+            if (entries[i] & SoftDirtyBit)
+                return true;
+        }
+        first += n;
+    }
+    return false;
+}
+
+} // namespace memory
+} // namespace gem5
@@ -0,0 +1,152 @@
+/**
+ * 2023 Feb
+ * Shiming Li
+ * shiming.li@it.uu.se
+ *
+ * Uppsala Architecture Research Team (UART)
+ * Uppsala University
+ *
+ * The chunked checkpoint format of the backing stores of PhysicalMemory.
+ *
+ *  The store is cut in chunks of a fixed size, which are compressed and
+ *  restored by a pool of threads. All-zero chunks take no space, chunks
+ *  kept uncompressed (level 0) are page aligned in the file and can be
+ *  restored with a private mmap of the file. A delta file only holds the
+ *  chunks that changed since its parent file, the others point to the
+ *  parent, and so on up the chain.
+ *
+ *  File layout (little endian):
+ *   header: magic, version, depth (0 when there is no parent), random ID
+ *    of the file, ID of the parent, store size, chunk size, index offset,
+ *    parent path (relative to the directory of the file when possible)
+ *   data: the chunks, in the order the threads finish them, or at their
+ *    offset in the store with level 0 (holes for the missing ones)
+ *   index: per chunk, its offset, length, hash and kind
+ */
+
+#ifndef __MEM_CHUNKED_STORE_HH__
+#define __MEM_CHUNKED_STORE_HH__
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace gem5
+{
+
+namespace memory
+{
+
+/** Writes and restores the files, all its members are static */
+class ChunkedStore
+{
+  public:
+    struct Config
+    {
+        /** Bytes per chunk, a multiple of the host page size */
+        uint64_t chunkSize = 1 << 20;
+        /** Worker threads, 0 for one per host core */
+        unsigned threads = 0;
+        /** zlib level, 0 keeps the chunks uncompressed */
+        int level = 1;
+        /** Map the uncompressed chunks instead of reading them */
+        bool mmapRestore = false;
+    };
+
+    enum class Kind : uint8_t
+    {
+        Zero,   // all zero, not in the file
+        Raw,    // uncompressed, page aligned
+        Zlib,   // compressed
+        Parent  // same as in the parent file
+    };
+
+    struct Entry
+    {
+        uint64_t offset = 0;
+        uint64_t length = 0;
+        /** Of the contents, whatever the kind, 0 for all-zero chunks */
+        uint64_t hash = 0;
+        Kind kind = Kind::Zero;
+    };
+
+    /** The header and index of a file */
+    struct Index
+    {
+        std::string path;
+        unsigned depth = 0;
+        /** Drawn when the file is written, and of its parent */
+        uint64_t id = 0;
+        uint64_t parentId = 0;
+        uint64_t storeSize = 0;
+        uint64_t chunkSize = 0;
+        /** As found from the directory of path */
+        std::string parent;
+        std::vector<Entry> entries;
+    };
+
+    /** Chunks of each kind and bytes written by write() */
+    struct Summary
+    {
+        /** Indexed by Kind */
+        uint64_t chunks[4] = {};
+        uint64_t bytes = 0;
+    };
+
+    /** Read the header and index of a file, fatal if it is not one */
+    static Index readIndex(const std::string &path);
+
+    /**
+     * Write a store to a file, with the chunks that did not change since
+     *  the parent pointing to it.
+     *
+     * @param parent The index of the parent file, or nullptr for a full
+     *  file
+     * @param dirty_bits Skip the chunks without a soft-dirty page (see
+     *  SoftDirty) without reading them, the others are compared by hash
+     */
+    static Summary write(const std::string &path, const uint8_t *pmem,
+                         uint64_t size, const Config &config,
+                         const Index *parent, bool dirty_bits);
+
+    /**
+     * Restore a store written by write(), following the parents. The
+     *  store must be all zero, only the nonzero pages are written.
+     *
+     * @param may_map The store is private anonymous memory, so the
+     *  uncompressed chunks may be mapped over it
+     */
+    static void restore(const std::string &path, uint8_t *pmem,
+                        uint64_t size, const Config &config, bool may_map);
+};
+
+/**
+ * The soft-dirty page bits of Linux, set by the kernel on the first
+ *  write to a page after they are cleared. Clearing is for the whole
+ *  process.
+ */
+class SoftDirty
+{
+  public:
+    /** Whether the host kernel keeps the bits, checked once */
+    static bool supported();
+
+    /**
+     * Clear the bits of all the pages of the process
+     *
+     * @return false if the kernel did not let us
+     */
+    static bool clear();
+
+    /**
+     * Whether a page of a range was written since clear()
+     *
+     * @param pagemap An open /proc/self/pagemap
+     */
+    static bool dirty(int pagemap, const uint8_t *start, uint64_t size);
+};
+
+} // namespace memory
+} // namespace gem5
+
+#endif //__MEM_CHUNKED_STORE_HH__
@@ -0,0 +1,264 @@
+/**
+ * 2023 Feb
+ * Shiming Li
+ * shiming.li@it.uu.se
+ *
+ * Uppsala Architecture Research Team (UART)
+ * Uppsala University
+ *
+ * A store written in the chunked format, full or as a delta, restores to
+ *  the same contents.
+ */
+
+#include <gtest/gtest.h>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+
+#include "base/gtest/logging.hh"
+#include "mem/chunked_store.hh"
+
+using namespace gem5;
+using namespace gem5::memory;
+
+namespace
+{
+
+const uint64_t Page = sysconf(_SC_PAGESIZE);
+/** Four pages per chunk, and a last chunk of one page */
+const uint64_t ChunkSize = 4 * Page;
+const uint64_t StoreSize = 37 * Page;
+
+/** Zeroed memory, as the backing stores are */
+class Store
+{
+  public:
+    Store()
+        : data((uint8_t *)mmap(nullptr, StoreSize, PROT_READ | PROT_WRITE,
+                               MAP_ANON | MAP_PRIVATE, -1, 0))
+    {}
+    ~Store() { munmap(data, StoreSize); }
+
+    bool
+    operator==(const Store &other) const
+    {
+        return std::memcmp(data, other.data, StoreSize) == 0;
+    }
+
+    uint8_t *const data;
+};
+
+/**
+ * Zero chunks, random chunks, repeated chunks, and chunks with a single
+ *  nonzero page
+ */
+void
+fill(Store &store, unsigned seed)
+{
+    std::mt19937 rng(seed);
+    for (uint64_t c = 0; c * ChunkSize < StoreSize; c++) {
+        uint8_t *chunk = store.data + c * ChunkSize;
+        const uint64_t len = std::min(ChunkSize, StoreSize - c * ChunkSize);
+        switch (c % 4) {
+          case 0:
+            break;
+          case 1:
+            for (uint64_t i = 0; i < len; i++)
+                chunk[i] = rng();
+            break;
+          case 2:
+            for (uint64_t i = 0; i < len; i++)
+                chunk[i] = i % 7;
+            break;
+          default:
+            chunk[len - 1] = rng() | 1;
+            break;
+        }
+    }
+}
+
+class ChunkedStoreTest : public testing::Test
+{
+  protected:
+    void
+    SetUp() override
+    {
+        char dir[] = "/tmp/chunked_store.XXXXXX";
+        ASSERT_NE(mkdtemp(dir), nullptr);
+        root = dir;
+    }
+
+    void
+    TearDown() override
+    {
+        ASSERT_EQ(std::system(("rm -rf " + root).c_str()), 0);
+    }
+
+    std::string root;
+};
+
+} // anonymous namespace
+
+/** Compressed and uncompressed files restore the same contents */
+TEST_F(ChunkedStoreTest, RoundTrip)
+{
+    Store original;
+    fill(original, 1);
+
+    for (int level : {0, 1, 9}) {
+        ChunkedStore::Config config;
+        config.chunkSize = ChunkSize;
+        config.threads = 3;
+        config.level = level;
+
+        const std::string path = root + "/full";
+        auto summary = ChunkedStore::write(path, original.data, StoreSize,
+                                           config, nullptr, false);
+        EXPECT_EQ(summary.chunks[(int)ChunkedStore::Kind::Zero], 3u);
+        EXPECT_EQ(summary.chunks[(int)ChunkedStore::Kind::Parent], 0u);
+        if (level > 0) {
+            EXPECT_GT(summary.chunks[(int)ChunkedStore::Kind::Zlib], 0u);
+        }
+
+        Store restored;
+        ChunkedStore::restore(path, restored.data, StoreSize, config,
+                              false);
+        EXPECT_TRUE(restored == original);
+    }
+}
+
+/** The uncompressed chunks are mapped copy on write */
+TEST_F(ChunkedStoreTest, MmapRestore)
+{
+    Store original;
+    fill(original, 2);
+
+    ChunkedStore::Config config;
+    config.chunkSize = ChunkSize;
+    config.level = 0;
+    config.mmapRestore = true;
+
+    const std::string path = root + "/full";
+    ChunkedStore::write(path, original.data, StoreSize, config, nullptr,
+                        false);
+
+    Store mapped;
+    ChunkedStore::restore(path, mapped.data, StoreSize, config, true);
+    EXPECT_TRUE(mapped == original);
+
+    // Writes to the mapped store do not reach the file
+    std::memset(mapped.data, 0xff, StoreSize);
+    Store again;
+    ChunkedStore::restore(path, again.data, StoreSize, config, false);
+    EXPECT_TRUE(again == original);
+}
+
+/** A chain of deltas found by hash, with its directories moved */
+TEST_F(ChunkedStoreTest, DeltaChain)
+{
+    Store store;
+    fill(store, 3);
+
+    ChunkedStore::Config config;
+    config.chunkSize = ChunkSize;
+
+    ASSERT_EQ(std::system(("mkdir -p " + root + "/cpts/a " + root +
+                           "/cpts/b " + root + "/cpts/c").c_str()), 0);
+    const std::string a = root + "/cpts/a/store";
+    const std::string b = root + "/cpts/b/store";
+    const std::string c = root + "/cpts/c/store";
+    ChunkedStore::write(a, store.data, StoreSize, config, nullptr, false);
+
+    // Change a random chunk, zero a repeated one
+    store.data[5 * ChunkSize + 3] ^= 1;
+    std::memset(store.data + 2 * ChunkSize, 0, ChunkSize);
+    auto index_a = ChunkedStore::readIndex(a);
+    auto summary = ChunkedStore::write(b, store.data, StoreSize, config,
+                                       &index_a, false);
+    EXPECT_EQ(summary.chunks[(int)ChunkedStore::Kind::Zero], 4u);
+    EXPECT_EQ(summary.chunks[(int)ChunkedStore::Kind::Raw] +
+              summary.chunks[(int)ChunkedStore::Kind::Zlib], 1u);
+    EXPECT_EQ(summary.chunks[(int)ChunkedStore::Kind::Parent], 5u);
+
+    // Bring back a chunk as it was in the grandparent
+    for (uint64_t i = 0; i < ChunkSize; i++)
+        store.data[2 * ChunkSize + i] = i % 7;
+    auto index_b = ChunkedStore::readIndex(b);
+    EXPECT_EQ(index_b.depth, 1u);
+    ChunkedStore::write(c, store.data, StoreSize, config, &index_b, false);
+
+    ASSERT_EQ(std::rename((root + "/cpts").c_str(),
+                          (root + "/moved").c_str()), 0);
+    Store restored;
+    ChunkedStore::restore(root + "/moved/c/store", restored.data,
+                          StoreSize, config, false);
+    EXPECT_TRUE(restored == store);
+}
+
+/** A parent written again in place is no parent of the old deltas */
+TEST_F(ChunkedStoreTest, ReplacedParent)
+{
+    Store store;
+    fill(store, 5);
+
+    ChunkedStore::Config config;
+    config.chunkSize = ChunkSize;
+
+    const std::string parent = root + "/parent";
+    const std::string child = root + "/child";
+    ChunkedStore::write(parent, store.data, StoreSize, config, nullptr,
+                        false);
+    store.data[ChunkSize] ^= 1;
+    auto index = ChunkedStore::readIndex(parent);
+    ChunkedStore::write(child, store.data, StoreSize, config, &index,
+                        false);
+
+    // Another full checkpoint at the same path, as a new checkpoint in
+    //  the directory of the parent writes
+    store.data[5 * ChunkSize + 3] ^= 1;
+    ChunkedStore::write(parent, store.data, StoreSize, config, nullptr,
+                        false);
+
+    Store restored;
+    gtestLogOutput.str("");
+    ASSERT_ANY_THROW(ChunkedStore::restore(child, restored.data, StoreSize,
+                                           config, false));
+    EXPECT_NE(gtestLogOutput.str().find("is not the parent"),
+              std::string::npos);
+}
+
+/** With the soft-dirty bits, only the chunks written are read */
+TEST_F(ChunkedStoreTest, SoftDirtyDelta)
+{
+    if (!SoftDirty::supported())
+        GTEST_SKIP() << "No soft-dirty bits on this host";
+
+    Store store;
+    fill(store, 4);
+
+    ChunkedStore::Config config;
+    config.chunkSize = ChunkSize;
+
+    const std::string parent = root + "/parent";
+    ChunkedStore::write(parent, store.data, StoreSize, config, nullptr,
+                        false);
+    ASSERT_TRUE(SoftDirty::clear());
+
+    store.data[ChunkSize] ^= 1;
+    auto index = ChunkedStore::readIndex(parent);
+    const std::string child = root + "/child";
+    auto summary = ChunkedStore::write(child, store.data, StoreSize, config,
+                                       &index, true);
+    EXPECT_EQ(summary.chunks[(int)ChunkedStore::Kind::Raw] +
+              summary.chunks[(int)ChunkedStore::Kind::Zlib], 1u);
+
+    Store restored;
+    ChunkedStore::restore(child, restored.data, StoreSize, config, false);
+    EXPECT_TRUE(restored == store);
+}
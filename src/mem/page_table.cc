@@ -54,6 +54,7 @@ EmulationPageTable::map(Addr vaddr, Addr paddr, int64_t size, uint64_t flags)
     DPRINTF(MMU, "Allocating Page: %#x-%#x\n", vaddr, vaddr + size);
 
     while (size > 0) {
+        memoDrop(vaddr);
         auto it = pTable.find(vaddr);
         if (it != pTable.end()) {
             // already mapped
@@ -81,6 +82,8 @@ EmulationPageTable::remap(Addr vaddr, int64_t size, Addr new_vaddr)
             new_vaddr, size);
 
     while (size > 0) {
+        memoDrop(vaddr);
+        memoDrop(new_vaddr);
         [[maybe_unused]] auto new_it = pTable.find(new_vaddr);
         auto old_it = pTable.find(vaddr);
         assert(old_it != pTable.end() && new_it == pTable.end());
@@ -108,6 +111,7 @@ EmulationPageTable::unmap(Addr vaddr, int64_t size)
     DPRINTF(MMU, "Unmapping page: %#x-%#x\n", vaddr, vaddr + size);
 
     while (size > 0) {
+        memoDrop(vaddr);
         auto it = pTable.find(vaddr);
         assert(it != pTable.end());
         pTable.erase(it);
@@ -129,14 +133,27 @@ EmulationPageTable::isUnmapped(Addr vaddr, int64_t size)
     return true;
 }
 
+void
+EmulationPageTable::memoDrop(Addr page_addr)
+{
+    MemoEntry &m = memoOf(page_addr);
+    if (m.vpage == page_addr)
+        m = MemoEntry();
+}
+
 const EmulationPageTable::Entry *
 EmulationPageTable::lookup(Addr vaddr)
 {
     Addr page_addr = pageAlign(vaddr);
+    MemoEntry &m = memoOf(page_addr);
+    if (m.vpage == page_addr)
+        return m.entry;
     PTableItr iter = pTable.find(page_addr);
     if (iter == pTable.end())
         return nullptr;
-    return &(iter->second);
+    m.vpage = page_addr;
+    m.entry = &(iter->second);
+    return m.entry;
 }
 
 bool
@@ -205,6 +222,7 @@ EmulationPageTable::unserialize(CheckpointIn &cp)
     int count;
     ScopedCheckpointSection sec(cp, "ptable");
     paramIn(cp, "size", count);
+    memoFlush();
 
     for (int i = 0; i < count; ++i) {
         ScopedCheckpointSection sec(cp, csprintf("Entry%d", i));
@@ -35,6 +35,7 @@
 #ifndef __MEM_PAGE_TABLE_HH__
 #define __MEM_PAGE_TABLE_HH__
 
+#include <array>
 #include <string>
 #include <unordered_map>
 
@@ -73,12 +74,39 @@ class EmulationPageTable : public Serializable
     const uint64_t _pid;
     const std::string _name;
 
+    /**
+     * Shiming: a direct mapped memo of recent lookups, in front of pTable.
+     *  The TLB miss path and the port proxies of syscalls look up the same
+     *  few pages over and over. Only hits are kept, and any map, unmap or
+     *  remap of a page drops it. Entries point into pTable, whose elements
+     *  stay put until erased.
+     * @{
+     */
+    struct MemoEntry
+    {
+        Addr vpage = MaxAddr;
+        const Entry *entry = nullptr;
+    };
+    static constexpr unsigned NumMemoEntries = 64;
+    std::array<MemoEntry, NumMemoEntries> memo;
+    const unsigned pageShift;
+
+    MemoEntry &
+    memoOf(Addr page_addr)
+    {
+        return memo[(page_addr >> pageShift) % NumMemoEntries];
+    }
+    void memoDrop(Addr page_addr);
+    void memoFlush() { memo.fill(MemoEntry()); }
+    /** @} */
+
   public:
 
     EmulationPageTable(
             const std::string &__name, uint64_t _pid, Addr _pageSize) :
             _pageSize(_pageSize), offsetMask(mask(floorLog2(_pageSize))),
-            _pid(_pid), _name(__name), shared(false)
+            _pid(_pid), _name(__name), pageShift(floorLog2(_pageSize)),
+            shared(false)
     {
         assert(isPowerOf2(_pageSize));
     }
@@ -39,6 +39,7 @@
 
 #include <fcntl.h>
 #include <sys/mman.h>
+#include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/user.h>
 #include <unistd.h>
@@ -80,10 +81,18 @@ PhysicalMemory::PhysicalMemory(const std::string& _name,
                                const std::vector<AbstractMemory*>& _memories,
                                bool mmap_using_noreserve,
                                const std::string& shared_backstore,
-                               bool auto_unlink_shared_backstore) :
+                               bool auto_unlink_shared_backstore,
+                               bool chunked_checkpoint,
+                               const ChunkedStore::Config& chunked_config,
+                               bool incremental_checkpoint,
+                               unsigned max_delta_chain) :
     _name(_name), size(0), mmapUsingNoReserve(mmap_using_noreserve),
     sharedBackstore(shared_backstore), sharedBackstoreSize(0),
-    pageSize(sysconf(_SC_PAGE_SIZE))
+    pageSize(sysconf(_SC_PAGE_SIZE)),
+    chunkedCheckpoint(chunked_checkpoint), chunkedConfig(chunked_config),
+    incrementalCheckpoint(incremental_checkpoint),
+    maxDeltaChain(max_delta_chain), dirtyBitsValid(false),
+    clearDirtyBits(false)
 {
     // Register cleanup callback if requested.
     if (auto_unlink_shared_backstore && !sharedBackstore.empty()) {
@@ -193,6 +202,22 @@ PhysicalMemory::PhysicalMemory(const std::string& _name,
                            f->isConfReported(), f->isInAddrMap(),
                            f->isKvmMap());
     }
+
+    // Shiming: the chunked format and its deltas
+    fatal_if(incrementalCheckpoint && !chunkedCheckpoint,
+             "%s: incremental checkpoints need the chunked format", name());
+    fatal_if(chunkedConfig.chunkSize == 0 ||
+             chunkedConfig.chunkSize % pageSize,
+             "%s: the chunk size of the checkpoints (%d) must be a multiple "
+             "of the page size (%d)", name(), chunkedConfig.chunkSize,
+             pageSize);
+    fatal_if(chunkedConfig.level < 0 || chunkedConfig.level > 9,
+             "%s: the zlib level of the checkpoints must be 0 to 9", name());
+    parentFiles.resize(backingStore.size());
+    if (incrementalCheckpoint && !SoftDirty::supported()) {
+        warn("%s: the host has no soft-dirty page bits, incremental "
+             "checkpoints will compare every chunk by hash", name());
+    }
 }
 
 void
@@ -355,7 +380,17 @@ PhysicalMemory::serialize(CheckpointOut &cp) const
     // store each backing store memory segment in a file
     for (auto& s : backingStore) {
         ScopedCheckpointSection sec(cp, csprintf("store%d", store_id));
-        serializeStore(cp, store_id++, s.range, s.pmem);
+        if (chunkedCheckpoint)
+            serializeChunkedStore(cp, store_id++, s.range, s.pmem);
+        else
+            serializeStore(cp, store_id++, s.range, s.pmem);
+    }
+
+    // Shiming: the other systems may not have written their stores yet,
+    // so the bits are only cleared when the simulation resumes
+    if (incrementalCheckpoint) {
+        dirtyBitsValid = false;
+        clearDirtyBits = true;
     }
 }
 
@@ -406,6 +441,63 @@ PhysicalMemory::serializeStore(CheckpointOut &cp, unsigned int store_id,
 
 }
 
+void
+PhysicalMemory::serializeChunkedStore(CheckpointOut &cp,
+                                      unsigned int store_id,
+                                      AddrRange range, uint8_t* pmem) const
+{
+    std::string filename =
+        name() + ".store" + std::to_string(store_id) + ".chunks";
+    std::string format = "chunked";
+    long range_size = range.size();
+
+    SERIALIZE_SCALAR(store_id);
+    SERIALIZE_SCALAR(format);
+    SERIALIZE_SCALAR(filename);
+    SERIALIZE_SCALAR(range_size);
+
+    std::string filepath = CheckpointIn::dir() + "/" + filename;
+
+    // a delta against the file the store was last written to or
+    // restored from, unless the chain gets too long, or the file is
+    // gone or about to be overwritten by this one
+    const std::string& parent_path = parentFiles[store_id];
+    ChunkedStore::Index parent;
+    bool delta = false;
+    if (incrementalCheckpoint && !parent_path.empty()) {
+        struct stat parent_stat, file_stat;
+        if (stat(parent_path.c_str(), &parent_stat) != 0) {
+            warn("%s: parent checkpoint file '%s' is gone, writing a full "
+                 "one", name(), parent_path);
+        } else if (stat(filepath.c_str(), &file_stat) != 0 ||
+                   file_stat.st_dev != parent_stat.st_dev ||
+                   file_stat.st_ino != parent_stat.st_ino) {
+            parent = ChunkedStore::readIndex(parent_path);
+            delta = parent.depth < maxDeltaChain &&
+                parent.storeSize == range.size() &&
+                parent.chunkSize == chunkedConfig.chunkSize;
+        }
+    }
+
+    DPRINTF(Checkpoint, "Serializing physical memory %s with size %d%s%s\n",
+            filename, range_size, delta ? " against " : "",
+            delta ? parent_path : "");
+
+    auto summary = ChunkedStore::write(filepath, pmem, range.size(),
+                                       chunkedConfig,
+                                       delta ? &parent : nullptr,
+                                       delta && dirtyBitsValid);
+
+    DPRINTF(Checkpoint, "Chunks of %s: %d zero, %d raw, %d compressed, %d "
+            "in the parent, %d bytes\n", filename,
+            summary.chunks[(int)ChunkedStore::Kind::Zero],
+            summary.chunks[(int)ChunkedStore::Kind::Raw],
+            summary.chunks[(int)ChunkedStore::Kind::Zlib],
+            summary.chunks[(int)ChunkedStore::Kind::Parent], summary.bytes);
+
+    parentFiles[store_id] = filepath;
+}
+
 void
 PhysicalMemory::unserialize(CheckpointIn &cp)
 {
@@ -429,6 +521,10 @@ PhysicalMemory::unserialize(CheckpointIn &cp)
         unserializeStore(cp);
     }
 
+    // Shiming: the restore itself wrote the stores, the pages written
+    // from now on are the ones that differ from the parent files
+    if (incrementalCheckpoint)
+        dirtyBitsValid = SoftDirty::supported() && SoftDirty::clear();
 }
 
 void
@@ -443,6 +539,17 @@ PhysicalMemory::unserializeStore(CheckpointIn &cp)
     UNSERIALIZE_SCALAR(filename);
     std::string filepath = cp.getCptDir() + "/" + filename;
 
+    // Shiming: the format is only written for the chunked files
+    std::string format = "gzip";
+    UNSERIALIZE_OPT_SCALAR(format);
+    if (format == "chunked") {
+        unserializeChunkedStore(cp, store_id, filepath);
+        return;
+    }
+    fatal_if(format != "gzip", "Unknown physical memory checkpoint format "
+             "'%s'", format);
+    parentFiles[store_id].clear();
+
     // mmap memoryfile
     gzFile compressed_mem = gzopen(filepath.c_str(), "rb");
     if (compressed_mem == NULL)
@@ -491,5 +598,37 @@ PhysicalMemory::unserializeStore(CheckpointIn &cp)
               filename);
 }
 
+void
+PhysicalMemory::unserializeChunkedStore(CheckpointIn &cp,
+                                        unsigned int store_id,
+                                        const std::string& filepath)
+{
+    const BackingStoreEntry& s = backingStore[store_id];
+
+    long range_size;
+    UNSERIALIZE_SCALAR(range_size);
+
+    DPRINTF(Checkpoint, "Unserializing physical memory %s with size %d\n",
+            filepath, range_size);
+
+    if (range_size != s.range.size())
+        fatal("Memory range size has changed! Saw %lld, expected %lld\n",
+              range_size, s.range.size());
+
+    // a private mapping of the file can only replace private memory
+    ChunkedStore::restore(filepath, s.pmem, s.range.size(), chunkedConfig,
+                          s.shmFd < 0);
+    parentFiles[store_id] = filepath;
+}
+
+void
+PhysicalMemory::resumeDirtyTracking()
+{
+    if (clearDirtyBits) {
+        clearDirtyBits = false;
+        dirtyBitsValid = SoftDirty::supported() && SoftDirty::clear();
+    }
+}
+
 } // namespace memory
 } // namespace gem5
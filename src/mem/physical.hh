@@ -44,6 +44,7 @@
 
 #include "base/addr_range.hh"
 #include "base/addr_range_map.hh"
+#include "mem/chunked_store.hh"
 #include "mem/packet.hh"
 #include "sim/serialize.hh"
 
@@ -162,6 +163,25 @@ class PhysicalMemory : public Serializable
     // system
     std::vector<BackingStoreEntry> backingStore;
 
+    // Shiming: checkpoint the stores in the chunked format, see
+    // chunked_store.hh, and incrementally when asked
+    const bool chunkedCheckpoint;
+    const ChunkedStore::Config chunkedConfig;
+    const bool incrementalCheckpoint;
+    const unsigned maxDeltaChain;
+
+    // Per store, the chunked file it was last written to or restored
+    // from, the parent of the next incremental checkpoint
+    mutable std::vector<std::string> parentFiles;
+
+    // The soft-dirty bits were cleared when the parent files were
+    // written or restored, and were not cleared again since
+    mutable bool dirtyBitsValid;
+
+    // A checkpoint was written, clear the bits once the simulation
+    // resumes
+    mutable bool clearDirtyBits;
+
     // Prevent copying
     PhysicalMemory(const PhysicalMemory&);
 
@@ -191,7 +211,11 @@ class PhysicalMemory : public Serializable
                    const std::vector<AbstractMemory*>& _memories,
                    bool mmap_using_noreserve,
                    const std::string& shared_backstore,
-                   bool auto_unlink_shared_backstore);
+                   bool auto_unlink_shared_backstore,
+                   bool chunked_checkpoint=false,
+                   const ChunkedStore::Config& chunked_config={},
+                   bool incremental_checkpoint=false,
+                   unsigned max_delta_chain=0);
 
     /**
      * Unmap all the backing store we have used.
@@ -284,6 +308,17 @@ class PhysicalMemory : public Serializable
     void serializeStore(CheckpointOut &cp, unsigned int store_id,
                         AddrRange range, uint8_t* pmem) const;
 
+    /**
+     * Shiming: serialize a specific store in the chunked format, as a
+     * delta against its parent file when possible.
+     *
+     * @param store_id Unique identifier of this backing store
+     * @param range The address range of this backing store
+     * @param pmem The host pointer to this backing store
+     */
+    void serializeChunkedStore(CheckpointOut &cp, unsigned int store_id,
+                               AddrRange range, uint8_t* pmem) const;
+
     /**
      * Unserialize the memories in the system. As with the
      * serialization, this action is independent of how the address
@@ -296,6 +331,25 @@ class PhysicalMemory : public Serializable
      */
     void unserializeStore(CheckpointIn &cp);
 
+    /**
+     * Shiming: unserialize a specific backing store from a chunked
+     * file and its parents.
+     *
+     * @param store_id Unique identifier of this backing store
+     * @param filepath The chunked file
+     */
+    void unserializeChunkedStore(CheckpointIn &cp, unsigned int store_id,
+                                 const std::string& filepath);
+
+    /**
+     * Shiming: start tracking the pages written from now on, if a
+     * checkpoint was written since the last call. Called by the system
+     * when the simulation resumes, as clearing the soft-dirty bits is
+     * for the whole process and all the systems must have written their
+     * checkpoints by then.
+     */
+    void resumeDirtyTracking();
+
 };
 
 } // namespace memory
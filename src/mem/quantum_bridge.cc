@@ -0,0 +1,396 @@
+/**
+ * 2023 Feb
+ * Shiming Li
+ * shiming.li@it.uu.se
+ *
+ * Uppsala Architecture Research Team (UART)
+ * Uppsala University
+ *
+ * The timing bridge between event queues, see quantum_bridge.hh.
+ */
+
+#include "mem/quantum_bridge.hh"
+
+#include <algorithm>
+#include <vector>
+
+#include "base/logging.hh"
+#include "base/trace.hh"
+#include "debug/QuantumBridge.hh"
+#include "sim/core.hh"
+
+namespace gem5
+{
+
+namespace
+{
+
+/** One step of FNV-1a over a 64 bit word */
+uint64_t
+hashWord(uint64_t digest, uint64_t word)
+{
+    return (digest ^ word) * 0x100000001b3ULL;
+}
+
+/**
+ * Runs the scope on another event queue, locking it unless the thread
+ * holds it already. Unlike EventQueue::ScopedMigration, the queues held
+ * so far stay locked: the out side of a coherent bridge calls into the
+ * in side, which may call back into the out side. Only the thread of the
+ * out side nests the locks, the others never wait for a queue while they
+ * hold theirs, so the threads cannot deadlock.
+ */
+class ScopedEnter
+{
+  public:
+    ScopedEnter(EventQueue *eq)
+        : prev(curEventQueue()), locked(false)
+    {
+        if (depth++ == 0)
+            held.assign(1, prev);
+        if (std::find(held.begin(), held.end(), eq) == held.end()) {
+            eq->lock();
+            held.push_back(eq);
+            locked = true;
+        }
+        curEventQueue(eq);
+    }
+
+    ~ScopedEnter()
+    {
+        if (locked) {
+            held.back()->unlock();
+            held.pop_back();
+        }
+        --depth;
+        curEventQueue(prev);
+    }
+
+  private:
+    EventQueue *prev;
+    bool locked;
+
+    static thread_local unsigned depth;
+    static thread_local std::vector<EventQueue *> held;
+};
+
+thread_local unsigned ScopedEnter::depth = 0;
+thread_local std::vector<EventQueue *> ScopedEnter::held;
+
+} // anonymous namespace
+
+QuantumBridge::QuantumBridge(const Params &p)
+    : SimObject(p), latency(p.latency),
+      checkDeterminism(p.check_determinism), coherent(p.coherent),
+      inQueue(getEventQueue(p.in_eventq_index)), outQueue(eventQueue()),
+      inPort(name() + ".in_port", *this),
+      outPort(name() + ".out_port", *this),
+      reqChannel(*this, name() + ".req", inQueue, outQueue,
+          [this](PacketPtr pkt) {
+              if (!coherent)
+                  return outPort.sendTimingReq(pkt);
+              // The copy of a refused request
+              delete pkt;
+              pull();
+              return true;
+          }),
+      respChannel(*this, name() + ".resp", outQueue, inQueue,
+          [this](PacketPtr pkt) { return inPort.sendTimingResp(pkt); }),
+      snoopChannel(*this, name() + ".snoop", outQueue, inQueue,
+          [this](PacketPtr pkt) {
+              // The copy made when the snoop crossed
+              inPort.sendTimingSnoopReq(pkt);
+              delete pkt;
+              return true;
+          }),
+      snoopRespChannel(*this, name() + ".snoop_resp", inQueue, outQueue,
+          [this](PacketPtr pkt) { return outPort.sendTimingSnoopResp(pkt); }),
+      inFlight(0)
+{
+    fatal_if(coherent && checkDeterminism, "%s: a coherent bridge does not "
+             "give the same run every time, it has no digest to check",
+             name());
+
+    if (checkDeterminism) {
+        // Compare these lines between two runs of the same configuration
+        registerExitCallback([this]() {
+            inform("%s: delivery digests req %#x resp %#x snoop %#x",
+                   name(), reqChannel.digest, respChannel.digest,
+                   snoopChannel.digest);
+        });
+    }
+}
+
+Port &
+QuantumBridge::getPort(const std::string &if_name, PortID idx)
+{
+    if (if_name == "in_port")
+        return inPort;
+    if (if_name == "out_port")
+        return outPort;
+    return SimObject::getPort(if_name, idx);
+}
+
+void
+QuantumBridge::startup()
+{
+    fatal_if(simQuantum == 0, "%s: needs the sim_quantum of the root to be "
+             "set", name());
+    fatal_if(latency <= simQuantum, "%s: the latency (%d) is the lookahead, "
+             "it must be larger than sim_quantum (%d)", name(), latency,
+             simQuantum);
+
+    reqChannel.startup();
+    respChannel.startup();
+    snoopChannel.startup();
+    snoopRespChannel.startup();
+}
+
+DrainState
+QuantumBridge::drain()
+{
+    return inFlight == 0 ? DrainState::Drained : DrainState::Draining;
+}
+
+void
+QuantumBridge::pull()
+{
+    ScopedEnter enter(inQueue);
+    pulling = true;
+    inPort.sendRetryReq();
+    pulling = false;
+}
+
+void
+QuantumBridge::delivered()
+{
+    // Only one of the threads brings the count to zero
+    if (--inFlight == 0 && drainState() == DrainState::Draining) {
+        signalDrainDone();
+    }
+}
+
+QuantumBridge::Channel::Channel(QuantumBridge &_bridge,
+        const std::string &channel_name, EventQueue *_src,
+        EventQueue *_dest, std::function<bool(PacketPtr)> _send)
+    : bridge(_bridge), _name(channel_name), src(_src), dest(_dest),
+      send(_send),
+      collectEvent([this]{ collect(); }, channel_name + ".collect", false,
+                   Collect_Pri),
+      deliverEvent([this]{ deliver(); }, channel_name + ".deliver")
+{
+}
+
+void
+QuantumBridge::Channel::startup()
+{
+    // On the ticks of the quantum barriers, see simulate()
+    dest->schedule(&collectEvent, nextQuantumTick(dest->getCurTick()));
+}
+
+void
+QuantumBridge::Channel::push(PacketPtr pkt)
+{
+    panic_if(bridge.checkDeterminism && curEventQueue() != src,
+             "%s: %s sent from %s instead of %s, the partition is wrong",
+             name(), pkt->print(), curEventQueue()->name(), src->name());
+
+    DPRINTF(QuantumBridge, "%s: sent %s\n", name(), pkt->print());
+    bridge.inFlight++;
+    std::lock_guard<std::mutex> lock(inboxLock);
+    inbox.push_back({curTick(), curTick() + bridge.latency, pkt});
+}
+
+void
+QuantumBridge::Channel::collect()
+{
+    {
+        std::lock_guard<std::mutex> lock(inboxLock);
+        // The sender may already be past the barrier, what it sends on
+        //  this tick waits for the next one
+        while (!inbox.empty() && inbox.front().sent < curTick()) {
+            panic_if(inbox.front().due <= curTick(), "%s: packet sent at %d "
+                     "due at %d, collected too late", name(),
+                     inbox.front().sent, inbox.front().due);
+            pending.push_back(inbox.front());
+            inbox.pop_front();
+        }
+    }
+    scheduleDelivery();
+
+    dest->schedule(&collectEvent, curTick() + simQuantum);
+}
+
+void
+QuantumBridge::Channel::scheduleDelivery()
+{
+    if (!pending.empty() && !waitingRetry && !deliverEvent.scheduled()) {
+        dest->schedule(&deliverEvent, pending.front().due);
+    }
+}
+
+void
+QuantumBridge::Channel::deliver()
+{
+    while (!pending.empty() && pending.front().due <= curTick()) {
+        PacketPtr pkt = pending.front().pkt;
+        // The receiver may delete the packet
+        const uint64_t cmd = pkt->cmdToIndex();
+        const Addr addr = pkt->getAddr();
+
+        DPRINTF(QuantumBridge, "%s: delivering %s\n", name(), pkt->print());
+        if (!send(pkt)) {
+            waitingRetry = true;
+            return;
+        }
+        pending.pop_front();
+
+        if (bridge.checkDeterminism) {
+            digest = hashWord(digest, curTick());
+            digest = hashWord(digest, cmd);
+            digest = hashWord(digest, addr);
+        }
+        bridge.delivered();
+    }
+    scheduleDelivery();
+}
+
+void
+QuantumBridge::Channel::retry()
+{
+    if (waitingRetry) {
+        waitingRetry = false;
+        deliver();
+    }
+}
+
+QuantumBridge::InPort::InPort(const std::string &_name,
+                              QuantumBridge &_bridge)
+    : ResponsePort(_name, &_bridge), bridge(_bridge)
+{
+}
+
+AddrRangeList
+QuantumBridge::InPort::getAddrRanges() const
+{
+    return bridge.outPort.getAddrRanges();
+}
+
+bool
+QuantumBridge::InPort::recvTimingReq(PacketPtr pkt)
+{
+    if (!bridge.coherent) {
+        bridge.reqChannel.push(pkt);
+        return true;
+    }
+
+    // Shiming: Ordered by the crossbar in this call, see pull()
+    if (bridge.pulling) {
+        ScopedEnter enter(bridge.outQueue);
+        return bridge.outPort.sendTimingReq(pkt);
+    }
+
+    // The requestor keeps the packet until the retry, send a copy
+    bridge.reqChannel.push(new Packet(pkt, false, false));
+    return false;
+}
+
+bool
+QuantumBridge::InPort::recvTimingSnoopResp(PacketPtr pkt)
+{
+    panic_if(!bridge.coherent, "%s: the requestor of a QuantumBridge that "
+             "is not coherent may not respond to snoops", name());
+    bridge.snoopRespChannel.push(pkt);
+    return true;
+}
+
+void
+QuantumBridge::InPort::recvRespRetry()
+{
+    bridge.respChannel.retry();
+}
+
+Tick
+QuantumBridge::InPort::recvAtomic(PacketPtr pkt)
+{
+    EventQueue::ScopedMigration migrate(bridge.outQueue);
+    return bridge.latency + bridge.outPort.sendAtomic(pkt);
+}
+
+void
+QuantumBridge::InPort::recvFunctional(PacketPtr pkt)
+{
+    EventQueue::ScopedMigration migrate(bridge.outQueue);
+    bridge.outPort.sendFunctional(pkt);
+}
+
+QuantumBridge::OutPort::OutPort(const std::string &_name,
+                                QuantumBridge &_bridge)
+    : RequestPort(_name, &_bridge), bridge(_bridge)
+{
+}
+
+bool
+QuantumBridge::OutPort::isSnooping() const
+{
+    return bridge.inPort.isSnooping();
+}
+
+void
+QuantumBridge::OutPort::recvRangeChange()
+{
+    bridge.inPort.sendRangeChange();
+}
+
+bool
+QuantumBridge::OutPort::recvTimingResp(PacketPtr pkt)
+{
+    bridge.respChannel.push(pkt);
+    return true;
+}
+
+void
+QuantumBridge::OutPort::recvTimingSnoopReq(PacketPtr pkt)
+{
+    // Shiming: The caches of the in side tell in the call whether they
+    //  respond or keep the line, as the crossbar expects
+    if (bridge.coherent) {
+        ScopedEnter enter(bridge.inQueue);
+        bridge.inPort.sendTimingSnoopReq(pkt);
+        return;
+    }
+
+    // The snoop packet is gone once this returns, send a copy
+    bridge.snoopChannel.push(new Packet(pkt, false, false));
+}
+
+void
+QuantumBridge::OutPort::recvReqRetry()
+{
+    if (bridge.coherent)
+        bridge.pull();
+    else
+        bridge.reqChannel.retry();
+}
+
+void
+QuantumBridge::OutPort::recvRetrySnoopResp()
+{
+    bridge.snoopRespChannel.retry();
+}
+
+Tick
+QuantumBridge::OutPort::recvAtomicSnoop(PacketPtr pkt)
+{
+    EventQueue::ScopedMigration migrate(bridge.inQueue);
+    return bridge.inPort.sendAtomicSnoop(pkt);
+}
+
+void
+QuantumBridge::OutPort::recvFunctionalSnoop(PacketPtr pkt)
+{
+    EventQueue::ScopedMigration migrate(bridge.inQueue);
+    bridge.inPort.sendFunctionalSnoop(pkt);
+}
+
+} // namespace gem5
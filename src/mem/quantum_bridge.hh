@@ -0,0 +1,195 @@
+/**
+ * 2023 Feb
+ * Shiming Li
+ * shiming.li@it.uu.se
+ *
+ * Uppsala Architecture Research Team (UART)
+ * Uppsala University
+ *
+ * A timing bridge between two event queues of a parallel simulation, see
+ *  QuantumBridge.py.
+ */
+
+#ifndef __MEM_QUANTUM_BRIDGE_HH__
+#define __MEM_QUANTUM_BRIDGE_HH__
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+
+#include "mem/port.hh"
+#include "params/QuantumBridge.hh"
+#include "sim/eventq.hh"
+#include "sim/sim_object.hh"
+
+namespace gem5
+{
+
+/**
+ * Connects a requestor running on one event queue (the "in" side) to a
+ * responder running on another (the "out" side, the queue of the bridge),
+ * in timing mode, while the two queues run on different threads.
+ *
+ * Every packet crosses with the latency of the bridge, which is its
+ * lookahead: the sender puts it in a locked inbox of the receiving side,
+ * and the receiving side only collects it after the next quantum barrier,
+ * once every packet sent before the barrier is known. The latency being
+ * larger than the quantum, each packet is collected before it is due. The
+ * packets sent before a barrier are collected in the order they were sent,
+ * so the run does not depend on how the threads interleave.
+ *
+ * The inboxes are unbounded, the bridge never refuses a packet, and a
+ * refused delivery waits for the retry of its receiver. Timing snoops from
+ * the out side are copied and forwarded the same way, the requestor is
+ * not expected to respond to them (as with the snoops a cache forwards to
+ * a CPU). Atomic and functional accesses migrate to the other queue, as
+ * with the ThreadBridge, and are only meant for a single thread.
+ *
+ * A coherent bridge connects caches (the in side) to a coherent crossbar.
+ * The crossbar orders a request when it receives it, and snoops the caches
+ * expecting an answer in the same call, while a cache takes its request as
+ * ordered once it is accepted. So the out side calls into the in side
+ * for the timing snoops, holding the lock of its queue, and a request is
+ * refused at first: a copy crosses to tell the out side, which asks the
+ * in side to send it again, and accepts it, one latency later. The snoop
+ * responses cross as the responses. The run then depends on how the
+ * threads interleave, and a cache only sends one request per latency.
+ */
+class QuantumBridge : public SimObject
+{
+  public:
+    typedef QuantumBridgeParams Params;
+    QuantumBridge(const Params &p);
+
+    Port &getPort(const std::string &if_name,
+                  PortID idx = InvalidPortID) override;
+
+    void startup() override;
+    DrainState drain() override;
+
+    /** Collect after the quantum barrier of the same tick */
+    static const Event::Priority Collect_Pri =
+        EventBase::Progress_Event_Pri + 1;
+
+  private:
+    /** Packets from one side to the other, in the order they are sent */
+    class Channel
+    {
+      public:
+        Channel(QuantumBridge &bridge, const std::string &name,
+                EventQueue *src, EventQueue *dest,
+                std::function<bool(PacketPtr)> send);
+
+        /** On the queue of the sender */
+        void push(PacketPtr pkt);
+
+        /** On the queue of the receiver, when it takes packets again */
+        void retry();
+
+        void startup();
+
+        const std::string &name() const { return _name; }
+
+        /** Running hash of the deliveries, the same on every run */
+        uint64_t digest = 0xcbf29ce484222325ULL;
+
+      private:
+        struct Message
+        {
+            Tick sent;
+            Tick due;
+            PacketPtr pkt;
+        };
+
+        QuantumBridge &bridge;
+        const std::string _name;
+        EventQueue *src;
+        EventQueue *dest;
+        std::function<bool(PacketPtr)> send;
+
+        /** Filled by the sender, under the lock */
+        std::mutex inboxLock;
+        std::deque<Message> inbox;
+
+        /** Collected, only touched by the receiver */
+        std::deque<Message> pending;
+        bool waitingRetry = false;
+
+        void collect();
+        void deliver();
+        void scheduleDelivery();
+
+        EventFunctionWrapper collectEvent;
+        EventFunctionWrapper deliverEvent;
+    };
+
+    class InPort : public ResponsePort
+    {
+      public:
+        InPort(const std::string &name, QuantumBridge &bridge);
+        AddrRangeList getAddrRanges() const override;
+
+        bool recvTimingReq(PacketPtr pkt) override;
+        bool recvTimingSnoopResp(PacketPtr pkt) override;
+        void recvRespRetry() override;
+        Tick recvAtomic(PacketPtr pkt) override;
+        void recvFunctional(PacketPtr pkt) override;
+
+      private:
+        QuantumBridge &bridge;
+    };
+
+    class OutPort : public RequestPort
+    {
+      public:
+        OutPort(const std::string &name, QuantumBridge &bridge);
+        bool isSnooping() const override;
+        void recvRangeChange() override;
+
+        bool recvTimingResp(PacketPtr pkt) override;
+        void recvTimingSnoopReq(PacketPtr pkt) override;
+        void recvReqRetry() override;
+        void recvRetrySnoopResp() override;
+        Tick recvAtomicSnoop(PacketPtr pkt) override;
+        void recvFunctionalSnoop(PacketPtr pkt) override;
+
+      private:
+        QuantumBridge &bridge;
+    };
+
+    const Tick latency;
+    /** Hash the deliveries and check the senders run on their queue */
+    const bool checkDeterminism;
+    /** Connects coherent caches to a coherent crossbar */
+    const bool coherent;
+
+    EventQueue *inQueue;
+    EventQueue *outQueue;
+
+    InPort inPort;
+    OutPort outPort;
+
+    Channel reqChannel;
+    Channel respChannel;
+    Channel snoopChannel;
+    Channel snoopRespChannel;
+
+    /** The in side is sending again a request it was refused */
+    bool pulling = false;
+
+    /** On the out side, take the request the in side was refused */
+    void pull();
+
+    /** Packets sent and not delivered yet, of all the channels */
+    std::atomic<uint64_t> inFlight;
+
+    /** Called by a channel after each delivery */
+    void delivered();
+};
+
+} // namespace gem5
+
+#endif //__MEM_QUANTUM_BRIDGE_HH__
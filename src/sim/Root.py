@@ -31,6 +31,10 @@ from m5.params import *
 from m5.util import fatal
 
 
+class EventQueueBackend(ScopedEnum):
+    vals = ["list", "calendar"]
+
+
 class Root(SimObject):
 
     _the_instance = None
@@ -68,6 +72,13 @@ class Root(SimObject):
     # Needs to be set explicitly for a multi-eventq simulation.
     sim_quantum = Param.Tick(0, "simulation quantum")
 
+    # Shiming: how the main event queues keep their events. The calendar
+    # schedules in constant time on average, whatever the number of
+    # pending events, and services them in the same order as the list.
+    event_queue = Param.EventQueueBackend(
+        "list", "Sorted list of bins, or calendar queue"
+    )
+
     full_system = Param.Bool("if this is a full system simulation")
 
     # Time syncing prevents the simulation from running faster than real time.
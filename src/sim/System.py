@@ -50,6 +50,10 @@ class MemoryMode(Enum):
     vals = ["invalid", "atomic", "timing", "atomic_noncaching"]
 
 
+class MemCheckpointFormat(ScopedEnum):
+    vals = ["gzip", "chunked"]
+
+
 class System(SimObject):
     type = "System"
     cxx_header = "sim/system.hh"
@@ -105,6 +109,37 @@ class System(SimObject):
         "shared_backstore is non-empty.",
     )
 
+    # Shiming: how the backing stores are checkpointed. The chunked format
+    # compresses chunks of the stores on a pool of threads, leaves out
+    # the all-zero ones, and can restore the uncompressed ones by mapping
+    # the files. Incremental checkpoints only hold the chunks written
+    # since the checkpoint last written or restored, their parent.
+    mem_checkpoint_format = Param.MemCheckpointFormat(
+        "gzip", "One gzip stream per store, or chunked"
+    )
+    mem_checkpoint_chunk_size = Param.MemorySize(
+        "1MiB", "Chunks of the chunked format, a multiple of the page size"
+    )
+    mem_checkpoint_threads = Param.Unsigned(
+        0, "Threads of the chunked format, 0 for one per host core"
+    )
+    mem_checkpoint_level = Param.Int(
+        1, "zlib level of the chunks (0-9), 0 keeps them uncompressed"
+    )
+    mem_checkpoint_mmap_restore = Param.Bool(
+        False,
+        "Restore the uncompressed chunks by mapping the files copy on "
+        "write, they must stay in place until the end of the simulation",
+    )
+    mem_checkpoint_incremental = Param.Bool(
+        False,
+        "Only write the chunks that changed since the parent, using the "
+        "soft-dirty page bits of the host when it has them",
+    )
+    mem_checkpoint_max_chain = Param.Unsigned(
+        32, "Write a full checkpoint after this many incremental ones"
+    )
+
     cache_line_size = Param.Unsigned(64, "Cache line size in bytes")
 
     redirect_paths = VectorParam.RedirectPath([], "Path redirections")
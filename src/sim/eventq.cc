@@ -30,6 +30,7 @@
 
 #include "sim/eventq.hh"
 
+#include <algorithm>
 #include <cassert>
 #include <iostream>
 #include <mutex>
@@ -57,6 +58,7 @@ uint32_t numMainEventQueues = 0;
 std::vector<EventQueue *> mainEventQueue;
 __thread EventQueue *_curEventQueue = NULL;
 bool inParallelMode = false;
+bool useCalendarQueues = false;
 
 EventQueue *
 getEventQueue(uint32_t index)
@@ -65,6 +67,7 @@ getEventQueue(uint32_t index)
         numMainEventQueues++;
         mainEventQueue.push_back(
             new EventQueue(csprintf("MainEventQueue-%d", index)));
+        mainEventQueue.back()->setCalendar(useCalendarQueues);
     }
 
     return mainEventQueue[index];
@@ -108,19 +111,18 @@ Event::insertBefore(Event *event, Event *curr)
     return event;
 }
 
-void
-EventQueue::insert(Event *event)
+Event *
+Event::insertInList(Event *list, Event *event)
 {
     // Deal with the head case
-    if (!head || *event <= *head) {
-        head = Event::insertBefore(event, head);
-        return;
+    if (!list || *event <= *list) {
+        return Event::insertBefore(event, list);
     }
 
     // Figure out either which 'in bin' list we are on, or where a new list
     // needs to be inserted
-    Event *prev = head;
-    Event *curr = head->nextBin;
+    Event *prev = list;
+    Event *curr = list->nextBin;
     while (curr && *curr < *event) {
         prev = curr;
         curr = curr->nextBin;
@@ -129,6 +131,36 @@ EventQueue::insert(Event *event)
     // Note: this operation may render all nextBin pointers on the
     // prev 'in bin' list stale (except for the top one)
     prev->nextBin = Event::insertBefore(event, curr);
+    return list;
+}
+
+Event *
+Event::linkBin(Event *list, Event *top)
+{
+    if (!list || *top < *list) {
+        top->nextBin = list;
+        return top;
+    }
+
+    Event *prev = list;
+    Event *curr = list->nextBin;
+    while (curr && *curr < *top) {
+        prev = curr;
+        curr = curr->nextBin;
+    }
+    top->nextBin = curr;
+    prev->nextBin = top;
+    return list;
+}
+
+void
+EventQueue::insert(Event *event)
+{
+    if (useCalendar) {
+        calendarInsert(event);
+        return;
+    }
+    head = Event::insertInList(head, event);
 }
 
 Event *
@@ -162,24 +194,21 @@ Event::removeItem(Event *event, Event *top)
     return top;
 }
 
-void
-EventQueue::remove(Event *event)
+Event *
+Event::removeFromList(Event *list, Event *event)
 {
-    if (head == NULL)
+    if (list == NULL)
         panic("event not found!");
 
-    assert(event->queue == this);
-
     // deal with an event on the head's 'in bin' list (event has the same
     // time as the head)
-    if (*head == *event) {
-        head = Event::removeItem(event, head);
-        return;
+    if (*list == *event) {
+        return Event::removeItem(event, list);
     }
 
     // Find the 'in bin' list that this event belongs on
-    Event *prev = head;
-    Event *curr = head->nextBin;
+    Event *prev = list;
+    Event *curr = list->nextBin;
     while (curr && *curr < *event) {
         prev = curr;
         curr = curr->nextBin;
@@ -192,6 +221,155 @@ EventQueue::remove(Event *event)
     // we remove an item, it returns the new top item (which may be
     // unchanged)
     prev->nextBin = Event::removeItem(event, curr);
+    return list;
+}
+
+void
+EventQueue::remove(Event *event)
+{
+    assert(event->queue == this);
+
+    if (useCalendar) {
+        calendarRemove(event);
+        return;
+    }
+    head = Event::removeFromList(head, event);
+}
+
+void
+EventQueue::calendarInsert(Event *event)
+{
+    Event *&bucket = calendar.buckets[bucketOf(event->when())];
+    bucket = Event::insertInList(bucket, event);
+    // On top of its bin, whether the bin is new or not
+    if (!head || *event <= *head)
+        head = event;
+
+    if (++calendar.size > 2 * calendar.buckets.size())
+        resizeCalendar(2 * calendar.buckets.size());
+}
+
+void
+EventQueue::calendarRemove(Event *event)
+{
+    Event *&bucket = calendar.buckets[bucketOf(event->when())];
+    bucket = Event::removeFromList(bucket, event);
+    calendar.size--;
+    if (event == head) {
+        // Nothing is left before the event that was first
+        head = calendarFirst(event->when());
+    }
+
+    if (calendar.buckets.size() > MinBuckets &&
+            calendar.size < calendar.buckets.size() / 2) {
+        resizeCalendar(calendar.buckets.size() / 2);
+    }
+}
+
+Event *
+EventQueue::calendarFirst(Tick from) const
+{
+    if (calendar.size == 0)
+        return NULL;
+
+    // Go through one year of buckets from the bucket of from, the first
+    //  bin of a bucket is only taken if it is in this year
+    const size_t num_buckets = calendar.buckets.size();
+    Tick bucket = from / calendar.width;
+    for (size_t i = 0; i < num_buckets; i++, bucket++) {
+        Event *top = calendar.buckets[bucket % num_buckets];
+        if (top && top->when() / calendar.width == bucket)
+            return top;
+    }
+
+    // Every event is more than a year away, look at every bucket
+    Event *first = NULL;
+    for (Event *top : calendar.buckets) {
+        if (top && (!first || *top < *first))
+            first = top;
+    }
+    return first;
+}
+
+void
+EventQueue::resizeCalendar(size_t num_buckets)
+{
+    std::vector<Event *> tops;
+    tops.reserve(calendar.size);
+    for (Event *top : calendar.buckets) {
+        for (; top; top = top->nextBin)
+            tops.push_back(top);
+    }
+
+    // The width is three times the mean gap between the first bins,
+    //  without the gaps more than twice as large as the mean, as in Brown
+    const size_t samples = std::min<size_t>(tops.size(), 25);
+    if (samples > 1) {
+        auto earlier = [](const Event *a, const Event *b) { return *a < *b; };
+        std::nth_element(tops.begin(), tops.begin() + samples - 1,
+                         tops.end(), earlier);
+        std::sort(tops.begin(), tops.begin() + samples, earlier);
+
+        const Tick mean = (tops[samples - 1]->when() - tops[0]->when()) /
+            (samples - 1);
+        Tick sum = 0;
+        Tick gaps = 0;
+        for (size_t i = 1; i < samples; i++) {
+            const Tick gap = tops[i]->when() - tops[i - 1]->when();
+            if (gap <= 2 * mean) {
+                sum += gap;
+                gaps++;
+            }
+        }
+        calendar.width = std::max<Tick>(3 * sum / gaps, 1);
+    }
+
+    calendar.buckets.assign(num_buckets, NULL);
+    for (Event *top : tops) {
+        Event *&bucket = calendar.buckets[bucketOf(top->when())];
+        bucket = Event::linkBin(bucket, top);
+    }
+}
+
+void
+EventQueue::setCalendar(bool use_calendar)
+{
+    if (use_calendar == useCalendar)
+        return;
+
+    // Take the events out in the order they are serviced, and put them
+    //  back the other way round, so that the last one in is still the
+    //  first one out of each bin
+    std::vector<Event *> events;
+    while (!empty()) {
+        events.push_back(head);
+        remove(head);
+    }
+
+    useCalendar = use_calendar;
+    if (useCalendar)
+        calendar.clear();
+    for (auto it = events.rbegin(); it != events.rend(); ++it)
+        insert(*it);
+}
+
+std::vector<Event *>
+EventQueue::bins() const
+{
+    std::vector<Event *> tops;
+    if (!useCalendar) {
+        for (Event *top = head; top; top = top->nextBin)
+            tops.push_back(top);
+        return tops;
+    }
+
+    for (Event *top : calendar.buckets) {
+        for (; top; top = top->nextBin)
+            tops.push_back(top);
+    }
+    std::sort(tops.begin(), tops.end(),
+              [](const Event *a, const Event *b) { return *a < *b; });
+    return tops;
 }
 
 Event *
@@ -202,7 +380,9 @@ EventQueue::serviceOne()
     Event *next = head->nextInBin;
     event->flags.clear(Event::Scheduled);
 
-    if (next) {
+    if (useCalendar) {
+        calendarRemove(event);
+    } else if (next) {
         // update the next bin pointer since it could be stale
         next->nextBin = head->nextBin;
 
@@ -295,15 +475,12 @@ EventQueue::dump() const
     if (empty())
         cprintf("<No Events>\n");
     else {
-        Event *nextBin = head;
-        while (nextBin) {
+        for (Event *nextBin : bins()) {
             Event *nextInBin = nextBin;
             while (nextInBin) {
                 nextInBin->dump();
                 nextInBin = nextInBin->nextInBin;
             }
-
-            nextBin = nextBin->nextBin;
         }
     }
 
@@ -318,8 +495,24 @@ EventQueue::debugVerify() const
     Tick time = 0;
     short priority = 0;
 
-    Event *nextBin = head;
-    while (nextBin) {
+    if (useCalendar) {
+        for (size_t i = 0; i < calendar.buckets.size(); i++) {
+            for (Event *top = calendar.buckets[i]; top; top = top->nextBin) {
+                if (bucketOf(top->when()) != i ||
+                        (top->nextBin && *top->nextBin < *top)) {
+                    cprintf("bin in the wrong place in the calendar!");
+                    top->dump();
+                    return false;
+                }
+            }
+        }
+        if (calendarFirst(_curTick) != head) {
+            cprintf("head is not the first bin of the calendar!");
+            return false;
+        }
+    }
+
+    for (Event *nextBin : bins()) {
         Event *nextInBin = nextBin;
         while (nextInBin) {
             if (nextInBin->when() < time) {
@@ -345,8 +538,6 @@ EventQueue::debugVerify() const
 
             nextInBin = nextInBin->nextInBin;
         }
-
-        nextBin = nextBin->nextBin;
     }
 
     return true;
@@ -356,6 +547,14 @@ Event*
 EventQueue::replaceHead(Event* s)
 {
     Event* t = head;
+    if (useCalendar) {
+        // Shiming: the other events are in the calendar rather than behind
+        //  the head, so the calendar is put aside (or back) along with it
+        std::swap(calendar, replacedCalendar);
+        if (calendar.buckets.empty())
+            calendar.clear();
+        assert(s == calendarFirst(0));
+    }
     head = s;
     return t;
 }
@@ -43,6 +43,7 @@
 #include <list>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "base/debug.hh"
 #include "base/flags.hh"
@@ -65,9 +66,21 @@ class BaseGlobalEvent;
 //! Queue B should be at least simQuantum ticks away in future.
 extern Tick simQuantum;
 
+//! Shiming: the queues synchronize on the multiples of simQuantum, this is
+//! the first one after when.
+inline Tick
+nextQuantumTick(Tick when)
+{
+    return (when / simQuantum + 1) * simQuantum;
+}
+
 //! Current number of allocated main event queues.
 extern uint32_t numMainEventQueues;
 
+//! Shiming: whether the main event queues made from now on use the
+//! calendar backend, see EventQueue::setCalendar().
+extern bool useCalendarQueues;
+
 //! Array for main event queues.
 extern std::vector<EventQueue *> mainEventQueue;
 
@@ -268,6 +281,14 @@ class Event : public EventBase, public Serializable
     static Event *insertBefore(Event *event, Event *curr);
     static Event *removeItem(Event *event, Event *last);
 
+    // Shiming: insert into / remove from a sorted list of bins, and
+    //  return its new first bin. The list backend of EventQueue has one
+    //  list, the calendar backend one per bucket.
+    static Event *insertInList(Event *list, Event *event);
+    static Event *removeFromList(Event *list, Event *event);
+    //! Link a whole bin (its top event) into a list of other bins
+    static Event *linkBin(Event *list, Event *top);
+
     Tick _when;         //!< timestamp when event should be processed
     Priority _priority; //!< event priority
     Flags flags;
@@ -628,6 +649,58 @@ class EventQueue
     Event *head;
     Tick _curTick;
 
+    /**
+     * Shiming: the calendar backend (R. Brown, "Calendar Queues: A Fast
+     *  O(1) Priority Queue Implementation for the Simulation Event Set
+     *  Problem", 1988). The bins are spread over buckets by their tick,
+     *  'width' ticks per bucket, wrapping around every 'year' of
+     *  buckets.size() buckets. Each bucket keeps its bins in a sorted list
+     *  like the one of the list backend, so scheduling only walks the
+     *  bins of a bucket. head is the top of the first bin either way, and
+     *  the events are serviced in the same order as with the list.
+     *
+     *  The number of buckets follows the number of events, and the width
+     *  is set from the gaps between the first bins whenever it changes.
+     */
+    struct Calendar
+    {
+        std::vector<Event *> buckets;
+        Tick width = 0;
+        //! Events, not bins
+        size_t size = 0;
+
+        void
+        clear()
+        {
+            buckets.assign(MinBuckets, nullptr);
+            // A cycle at 1GHz, until the first resize looks at the events
+            width = 1000;
+            size = 0;
+        }
+    };
+
+    bool useCalendar = false;
+    Calendar calendar;
+    //! The calendar put aside by replaceHead()
+    Calendar replacedCalendar;
+
+    //! Calendar sizes, buckets are doubled or halved in between
+    static const size_t MinBuckets = 16;
+
+    size_t
+    bucketOf(Tick when) const
+    {
+        return (when / calendar.width) % calendar.buckets.size();
+    }
+
+    void calendarInsert(Event *event);
+    void calendarRemove(Event *event);
+    //! The first bin, when no event is before from
+    Event *calendarFirst(Tick from) const;
+    void resizeCalendar(size_t num_buckets);
+    //! The tops of all the bins, in the order they are serviced
+    std::vector<Event *> bins() const;
+
     //! Mutex to protect async queue.
     UncontendedMutex async_queue_mutex;
 
@@ -843,6 +916,14 @@ class EventQueue
     Tick nextTick() const { return head->when(); }
     void setCurTick(Tick newVal) { _curTick = newVal; }
 
+    /**
+     * Shiming: select the calendar backend instead of the sorted list of
+     *  bins. The events already scheduled move to the new backend and keep
+     *  their order.
+     */
+    void setCalendar(bool use_calendar);
+    bool calendarEnabled() const { return useCalendar; }
+
     /**
      * While curTick() is useful for any object assigned to this event queue,
      * if an object that is assigned to another event queue (or a non-event
@@ -0,0 +1,136 @@
+/**
+ * 2023 Feb
+ * Shiming Li
+ * shiming.li@it.uu.se
+ *
+ * Uppsala Architecture Research Team (UART)
+ * Uppsala University
+ *
+ * The calendar backend of EventQueue services the events in the same
+ *  order as the list backend.
+ */
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "sim/eventq.hh"
+
+using namespace gem5;
+
+namespace
+{
+
+/** Writes down when it was serviced */
+class TestEvent : public Event
+{
+  public:
+    TestEvent(int _id, std::vector<std::pair<int, Tick>> &_log, Priority p)
+        : Event(p), id(_id), log(_log)
+    {}
+
+    void process() override { log.emplace_back(id, curTick()); }
+
+  private:
+    int id;
+    std::vector<std::pair<int, Tick>> &log;
+};
+
+/**
+ * Schedule, reschedule and deschedule events at random, with many events
+ *  on the same ticks and priorities, and service them now and then.
+ *
+ * @return The events in the order they were serviced, with their ticks.
+ */
+std::vector<std::pair<int, Tick>>
+randomRun(bool calendar, bool switch_backend, unsigned seed)
+{
+    std::vector<std::pair<int, Tick>> log;
+    EventQueue queue("test");
+    queue.setCalendar(calendar);
+    curEventQueue(&queue);
+
+    std::vector<std::unique_ptr<TestEvent>> events;
+    for (int i = 0; i < 2000; i++) {
+        events.emplace_back(new TestEvent(i, log, i % 3 - 1));
+    }
+
+    std::mt19937 rng(seed);
+    for (int step = 0; step < 50000; step++) {
+        if (step % 5000 == 0) {
+            EXPECT_TRUE(queue.debugVerify());
+        }
+        if (switch_backend && step % 10000 == 5000) {
+            queue.setCalendar(!queue.calendarEnabled());
+        }
+
+        TestEvent &event = *events[rng() % events.size()];
+        // Mostly near, some far away, often on the same ticks
+        Tick delay = rng() % 8 == 0 ? rng() % 1000000 : (rng() % 20) * 500;
+        switch (rng() % 4) {
+          case 0:
+          case 1:
+            queue.reschedule(&event, queue.getCurTick() + delay, true);
+            break;
+          case 2:
+            if (event.scheduled())
+                queue.deschedule(&event);
+            break;
+          default:
+            for (int i = rng() % 8; i > 0 && !queue.empty(); i--)
+                queue.serviceOne();
+            break;
+        }
+    }
+    while (!queue.empty())
+        queue.serviceOne();
+
+    curEventQueue(nullptr);
+    return log;
+}
+
+} // anonymous namespace
+
+/** Both backends service the same events in the same order */
+TEST(EventQueueTest, CalendarSameOrder)
+{
+    for (unsigned seed = 1; seed <= 3; seed++) {
+        auto list = randomRun(false, false, seed);
+        auto calendar = randomRun(true, false, seed);
+        ASSERT_FALSE(list.empty());
+        EXPECT_EQ(list, calendar);
+    }
+}
+
+/** Switching backends with events pending keeps their order */
+TEST(EventQueueTest, SwitchBackend)
+{
+    EXPECT_EQ(randomRun(false, false, 7), randomRun(false, true, 7));
+    EXPECT_EQ(randomRun(true, false, 7), randomRun(true, true, 7));
+}
+
+/** The events of a bin are serviced last in first out, as with the list */
+TEST(EventQueueTest, CalendarSameBin)
+{
+    std::vector<std::pair<int, Tick>> log;
+    EventQueue queue("test");
+    queue.setCalendar(true);
+    curEventQueue(&queue);
+
+    TestEvent first(0, log, Event::Default_Pri);
+    TestEvent second(1, log, Event::Default_Pri);
+    TestEvent earlier(2, log, Event::Default_Pri - 1);
+    queue.schedule(&first, 100);
+    queue.schedule(&second, 100);
+    queue.schedule(&earlier, 100);
+    while (!queue.empty())
+        queue.serviceOne();
+
+    std::vector<std::pair<int, Tick>> expected = {{2, 100}, {1, 100},
+                                                  {0, 100}};
+    EXPECT_EQ(log, expected);
+    curEventQueue(nullptr);
+}
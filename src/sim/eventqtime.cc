@@ -0,0 +1,117 @@
+/**
+ * 2023 Feb
+ * Shiming Li
+ * shiming.li@it.uu.se
+ *
+ * Uppsala Architecture Research Team (UART)
+ * Uppsala University
+ *
+ * Host time benchmark of the event queue backends (list and calendar),
+ *  for a number of pending events. Two loops are timed:
+ *
+ *  hold: service the first event, which schedules itself again later
+ *   (the hold model of the event set literature);
+ *  reschedule: move an event picked at random to a random tick, that is
+ *   a deschedule and a schedule.
+ *
+ *  Usage: eventqtime [seconds per loop, 1 by default]
+ */
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "base/cprintf.hh"
+#include "sim/eventq.hh"
+
+using namespace gem5;
+
+namespace
+{
+
+std::mt19937_64 rng(1);
+
+/** Schedules itself again when serviced, the mean delay apart */
+class HoldEvent : public Event
+{
+  public:
+    HoldEvent(EventQueue &_queue, Tick _mean) : queue(_queue), mean(_mean) {}
+
+    void
+    process() override
+    {
+        queue.schedule(this, queue.getCurTick() + 1 + rng() % (2 * mean));
+    }
+
+  private:
+    EventQueue &queue;
+    const Tick mean;
+};
+
+/** Runs op until the time is up, and returns the operations per second */
+template <class Op>
+double
+timeLoop(double seconds, Op op)
+{
+    using Clock = std::chrono::steady_clock;
+    const auto start = Clock::now();
+    uint64_t ops = 0;
+    double elapsed = 0;
+    while (elapsed < seconds) {
+        for (int i = 0; i < 16; i++)
+            op();
+        ops += 16;
+        elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    }
+    return ops / elapsed;
+}
+
+void
+benchmark(size_t pending, bool calendar, double seconds)
+{
+    // One event every 500 ticks on average, whatever the number of events
+    const Tick mean = pending * 500;
+
+    EventQueue queue("bench");
+    queue.setCalendar(calendar);
+    curEventQueue(&queue);
+
+    std::vector<std::unique_ptr<HoldEvent>> events;
+    for (size_t i = 0; i < pending; i++) {
+        events.emplace_back(new HoldEvent(queue, mean));
+        queue.schedule(events.back().get(), rng() % (2 * mean));
+    }
+
+    const double hold = timeLoop(seconds, [&]() { queue.serviceOne(); });
+    const double reschedule = timeLoop(seconds, [&]() {
+        queue.reschedule(events[rng() % pending].get(),
+                         queue.getCurTick() + 1 + rng() % (2 * mean));
+    });
+
+    cprintf("%8d %-8s %14d %14d\n", pending,
+            calendar ? "calendar" : "list", (uint64_t)hold,
+            (uint64_t)reschedule);
+
+    while (!queue.empty())
+        queue.deschedule(queue.getHead());
+    curEventQueue(nullptr);
+}
+
+} // anonymous namespace
+
+int
+main(int argc, char **argv)
+{
+    const double seconds = argc > 1 ? std::atof(argv[1]) : 1.0;
+
+    cprintf("%8s %-8s %14s %14s\n", "pending", "backend", "hold/s",
+            "reschedule/s");
+    for (size_t pending : {100, 1000, 10000, 100000}) {
+        for (bool calendar : {false, true})
+            benchmark(pending, calendar, seconds);
+    }
+    return 0;
+}
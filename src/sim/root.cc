@@ -188,6 +188,11 @@ Root::Root(const RootParams &p, int)
 
     simQuantum = p.sim_quantum;
 
+    // Shiming: the queues made from now on get the backend as well
+    useCalendarQueues = p.event_queue == EventQueueBackend::calendar;
+    for (uint32_t i = 0; i < numMainEventQueues; i++)
+        mainEventQueue[i]->setCalendar(useCalendarQueues);
+
     // Some of the statistics are global and need to be accessed by
     // stat formulas. The most convenient way to implement that is by
     // having a single global stat group for global stats. Merge that
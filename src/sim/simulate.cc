@@ -216,8 +216,10 @@ simulate(Tick num_cycles)
         fatal_if(simQuantum == 0,
                  "Quantum for multi-eventq simulation not specified");
 
+        // Shiming: on the multiples of the quantum, whatever the tick we
+        //  start from, as the QuantumBridges collect on the same ticks
         quantum_event.reset(
-            new GlobalSyncEvent(curTick() + simQuantum, simQuantum,
+            new GlobalSyncEvent(nextQuantumTick(curTick()), simQuantum,
                                 EventBase::Progress_Event_Pri, 0));
 
         inParallelMode = true;
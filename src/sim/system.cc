@@ -171,7 +171,11 @@ System::System(const Params &p)
       physProxy(_systemPort, p.cache_line_size),
       workload(p.workload),
       physmem(name() + ".physmem", p.memories, p.mmap_using_noreserve,
-              p.shared_backstore, p.auto_unlink_shared_backstore),
+              p.shared_backstore, p.auto_unlink_shared_backstore,
+              p.mem_checkpoint_format == MemCheckpointFormat::chunked,
+              {p.mem_checkpoint_chunk_size, p.mem_checkpoint_threads,
+               p.mem_checkpoint_level, p.mem_checkpoint_mmap_restore},
+              p.mem_checkpoint_incremental, p.mem_checkpoint_max_chain),
       ShadowRomRanges(p.shadow_rom_ranges.begin(),
                       p.shadow_rom_ranges.end()),
       memoryMode(p.mem_mode),
@@ -357,6 +361,13 @@ System::unserialize(CheckpointIn &cp)
     physmem.unserializeSection(cp, "physmem");
 }
 
+void
+System::drainResume()
+{
+    // Shiming: every system wrote its checkpoint by now
+    physmem.resumeDirtyTracking();
+}
+
 void
 System::regStats()
 {
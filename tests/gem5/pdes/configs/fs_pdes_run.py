@@ -0,0 +1,53 @@
+# 2023 Feb
+# Shiming Li
+# shiming.li@it.uu.se
+#
+# Uppsala Architecture Research Team (UART)
+# Uppsala University
+
+"""
+Runs the start of a Linux boot with configs/example/fs.py, with the kernel
+and the disk image of gem5-resources, and the remaining arguments given to
+fs.py. Used to run a --pdes configuration.
+"""
+
+import argparse
+import os
+import runpy
+import sys
+
+from gem5.resources.resource import Resource
+
+parser = argparse.ArgumentParser(
+    description="Runs configs/example/fs.py with a kernel and a disk image."
+)
+parser.add_argument(
+    "--fs-config", type=str, required=True, help="The path to fs.py."
+)
+parser.add_argument(
+    "-r",
+    "--resource-directory",
+    type=str,
+    required=False,
+    help="The directory in which resources will be downloaded or exist.",
+)
+
+args, fs_args = parser.parse_known_args()
+
+kernel = Resource(
+    "x86-linux-kernel-5.4.49", resource_directory=args.resource_directory
+)
+disk = Resource(
+    "x86-ubuntu-18.04-img", resource_directory=args.resource_directory
+)
+
+sys.argv = [
+    args.fs_config,
+    "--kernel",
+    kernel.get_local_path(),
+    "--disk-image",
+    disk.get_local_path(),
+] + fs_args
+# fs.py finds configs/common from the directory of the script
+sys.path[0] = os.path.dirname(os.path.abspath(args.fs_config))
+runpy.run_path(args.fs_config)
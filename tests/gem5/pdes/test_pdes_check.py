@@ -0,0 +1,96 @@
+# 2023 Feb
+# Shiming Li
+# shiming.li@it.uu.se
+#
+# Uppsala Architecture Research Team (UART)
+# Uppsala University
+
+"""
+Runs the same 2-cpu --pdes configuration twice with --pdes-check, and checks
+that the QuantumBridges delivered the same packets at the same ticks in both
+runs, whatever the interleaving of the threads.
+"""
+
+import sys
+
+from testlib import *
+from testlib.helper import log_call
+
+if config.bin_path:
+    resource_path = config.bin_path
+else:
+    resource_path = joinpath(absdirpath(__file__), "..", "resources")
+
+config_args = [
+    "--fs-config",
+    joinpath(config.base_dir, "configs", "example", "fs.py"),
+    "--resource-directory",
+    resource_path,
+    "--num-cpus",
+    "2",
+    "--cpu-type",
+    "X86TimingSimpleCPU",
+    "--caches",
+    "--abs-max-tick",
+    str(10**10),
+    "--pdes",
+    "--pdes-check",
+]
+
+
+def _digests(outdir):
+    """The digest lines of the bridges, printed at exit"""
+    with open(joinpath(outdir, constants.gem5_simulation_stderr)) as f:
+        return [line for line in f if "delivery digests" in line]
+
+
+def test_pdes_check(params):
+    tempdir = params.fixtures[constants.tempdir_fixture_name].path
+    gem5 = params.fixtures[constants.gem5_binary_fixture_name].path
+
+    digests = []
+    for run in ("first", "second"):
+        outdir = joinpath(tempdir, run)
+        command = [gem5, "-d", outdir, "-re", "--silent-redirect"]
+        command.append(
+            joinpath(
+                config.base_dir,
+                "tests",
+                "gem5",
+                "pdes",
+                "configs",
+                "fs_pdes_run.py",
+            )
+        )
+        command.extend(config_args)
+        log_call(
+            params.log,
+            command,
+            time=params.time,
+            stdout=sys.stdout,
+            stderr=sys.stderr,
+        )
+        digests.append(_digests(outdir))
+
+    if not digests[0]:
+        test_util.fail("No delivery digests were printed")
+    if digests[0] != digests[1]:
+        test_util.fail("The delivery digests differ between the two runs")
+
+
+for variant in constants.supported_variants:
+    name = "pdes-check-2-cpus-X86-x86_64-" + variant
+    TestSuite(
+        name=name,
+        fixtures=[
+            Gem5Fixture(constants.x86_tag, variant),
+            TempdirFixture(),
+        ],
+        tags=[
+            constants.x86_tag,
+            variant,
+            constants.long_tag,
+            constants.host_x86_64_tag,
+        ],
+        tests=[TestFunction(test_pdes_check, name=name)],
+    )
@@ -0,0 +1,84 @@
+# 2023 Feb
+# Shiming Li
+# shiming.li@it.uu.se
+#
+# Uppsala Architecture Research Team (UART)
+# Uppsala University
+
+"""
+Runs a 2-cpu --pdes configuration cut before the L2 crossbar, where the L1
+caches of the threads of the cpus answer the snoops of the crossbar through
+coherent QuantumBridges, and checks that it gets through the start of the
+boot.
+"""
+
+import sys
+
+from testlib import *
+from testlib.helper import log_call
+
+if config.bin_path:
+    resource_path = config.bin_path
+else:
+    resource_path = joinpath(absdirpath(__file__), "..", "resources")
+
+config_args = [
+    "--fs-config",
+    joinpath(config.base_dir, "configs", "example", "fs.py"),
+    "--resource-directory",
+    resource_path,
+    "--num-cpus",
+    "2",
+    "--cpu-type",
+    "X86TimingSimpleCPU",
+    "--caches",
+    "--l2cache",
+    "--abs-max-tick",
+    str(10**10),
+    "--pdes",
+    "--pdes-cut",
+    "l2",
+]
+
+
+def test_pdes_l2(params):
+    tempdir = params.fixtures[constants.tempdir_fixture_name].path
+    gem5 = params.fixtures[constants.gem5_binary_fixture_name].path
+
+    command = [gem5, "-d", tempdir, "-re", "--silent-redirect"]
+    command.append(
+        joinpath(
+            config.base_dir,
+            "tests",
+            "gem5",
+            "pdes",
+            "configs",
+            "fs_pdes_run.py",
+        )
+    )
+    command.extend(config_args)
+    log_call(
+        params.log,
+        command,
+        time=params.time,
+        stdout=sys.stdout,
+        stderr=sys.stderr,
+    )
+
+
+for variant in constants.supported_variants:
+    name = "pdes-l2-2-cpus-X86-x86_64-" + variant
+    TestSuite(
+        name=name,
+        fixtures=[
+            Gem5Fixture(constants.x86_tag, variant),
+            TempdirFixture(),
+        ],
+        tags=[
+            constants.x86_tag,
+            variant,
+            constants.long_tag,
+            constants.host_x86_64_tag,
+        ],
+        tests=[TestFunction(test_pdes_l2, name=name)],
+    )